@@ -94,6 +94,16 @@
 // This file has an implicit dependency on ei_run_dsp.h, so must come after that include!
 #include "model-parameters/model_variables.h"
 
+// Continuous MFE straight to int8: the MFE front end (fixed point or float)
+// quantizes each slice's levels for the compiled model's input tensor, no
+// float feature window
+#if (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && \
+    (EI_CLASSIFIER_INFERENCING_ENGINE == EI_CLASSIFIER_TFLITE) && (EI_CLASSIFIER_COMPILED == 1)
+#define EI_CLASSIFIER_CONTINUOUS_QUANTIZED 1
+#else
+#define EI_CLASSIFIER_CONTINUOUS_QUANTIZED 0
+#endif
+
 #ifdef __cplusplus
 namespace {
 #endif // __cplusplus
@@ -405,6 +415,120 @@ extern "C" EI_IMPULSE_ERROR init_impulse(ei_impulse_handle_t *handle) {
     return EI_IMPULSE_OK;
 }
 
+#if EI_CLASSIFIER_CONTINUOUS_QUANTIZED
+/**
+ * Check if the impulse can run continuous inference on int8 features
+ * (process_impulse_continuous_quantized): one MFE block (implementation
+ * version 3 or 4) feeding one compiled, int8 quantized model.
+ */
+static EI_IMPULSE_ERROR can_run_classifier_continuous_quantized(const ei_impulse_t *impulse) {
+    if (impulse->has_anomaly || impulse->learning_blocks_size != 1 || impulse->dsp_blocks_size != 1) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+
+    ei_learning_block_t block = impulse->learning_blocks[0];
+    if (block.infer_fn != run_nn_inference) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)block.config;
+    if (block_config->quantized != 1) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+
+    ei_model_dsp_t dsp_block = impulse->dsp_blocks[0];
+    if (dsp_block.extract_fn != extract_mfe_features ||
+        ((ei_dsp_config_mfe_t*)dsp_block.config)->implementation_version < 3 ||
+        dsp_block.n_output_features != impulse->nn_input_frame_size) {
+        return EI_IMPULSE_UNSUPPORTED_INFERENCING_ENGINE;
+    }
+
+    float scale;
+    int32_t zero_point;
+    return ei_tflite_eon_input_quantization(block_config, &scale, &zero_point);
+}
+
+/**
+ * Continuous inference where the rolling feature window is int8: each slice's
+ * MFE rows are quantized for the input tensor as they are computed, and a full
+ * window is copied into the tensor as is. Replaces the float window and the
+ * per-inference float copy of process_impulse_continuous (MFE normalization is
+ * per element for these versions, so it is done on the new rows only).
+ */
+static EI_IMPULSE_ERROR process_impulse_continuous_quantized(ei_impulse_handle_t *handle,
+                                                             signal_t *signal,
+                                                             ei_impulse_result_t *result,
+                                                             bool debug)
+{
+    auto impulse = handle->impulse;
+    ei_model_dsp_t block = impulse->dsp_blocks[0];
+    ei_learning_block_config_tflite_graph_t *block_config =
+        (ei_learning_block_config_tflite_graph_t*)impulse->learning_blocks[0].config;
+
+    static ei::matrix_i8_t static_features_matrix_i8(1, impulse->nn_input_frame_size);
+    if (!static_features_matrix_i8.buffer) {
+        return EI_IMPULSE_ALLOC_FAILED;
+    }
+
+    float scale;
+    int32_t zero_point;
+    EI_IMPULSE_ERROR ei_impulse_error = ei_tflite_eon_input_quantization(block_config, &scale, &zero_point);
+    if (ei_impulse_error != EI_IMPULSE_OK) {
+        return ei_impulse_error;
+    }
+
+    uint64_t dsp_start_us = ei_read_timer_us();
+
+    matrix_size_t features_written;
+
+#if EIDSP_SIGNAL_C_FN_POINTER
+    if (block.axes_size != impulse->raw_samples_per_frame) {
+        ei_printf("ERR: EIDSP_SIGNAL_C_FN_POINTER can only be used when all axes are selected for DSP blocks\n");
+        return EI_IMPULSE_DSP_ERROR;
+    }
+    signal_t *slice_signal = signal;
+#else
+    SignalWithAxes swa(signal, block.axes, block.axes_size, impulse);
+    signal_t *slice_signal = swa.get_signal();
+#endif
+#if EIDSP_MFE_Q15
+    int ret = extract_mfe_per_slice_features_q15_i8(slice_signal, &static_features_matrix_i8, block.config,
+        scale, zero_point, impulse->frequency, &features_written);
+#else
+    int ret = extract_mfe_per_slice_features_i8(slice_signal, &static_features_matrix_i8, block.config,
+        scale, zero_point, impulse->frequency, &features_written);
+#endif
+
+    if (ret != EIDSP_OK) {
+        ei_printf("ERR: Failed to run DSP process (%d)\n", ret);
+        return EI_IMPULSE_DSP_ERROR;
+    }
+
+    if (ei_run_impulse_check_canceled() == EI_IMPULSE_CANCELED) {
+        return EI_IMPULSE_CANCELED;
+    }
+
+    classifier_continuous_features_written += (features_written.rows * features_written.cols);
+
+    result->timing.dsp_us = ei_read_timer_us() - dsp_start_us;
+    result->timing.dsp = (int)(result->timing.dsp_us / 1000);
+
+    if (classifier_continuous_features_written >= impulse->nn_input_frame_size) {
+        if (debug) {
+            ei_printf("Running impulse...\n");
+        }
+
+        ei_impulse_error = run_nn_inference_quantized_input(impulse, static_features_matrix_i8.buffer,
+            impulse->nn_input_frame_size, 0, result, block_config, debug);
+        if (ei_impulse_error != EI_IMPULSE_OK) {
+            return ei_impulse_error;
+        }
+        ei_impulse_error = run_postprocessing(handle, result);
+    }
+
+    return ei_impulse_error;
+}
+#endif // EI_CLASSIFIER_CONTINUOUS_QUANTIZED
+
 /**
  * @brief      Process a complete impulse for continuous inference
  *
@@ -467,6 +591,13 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
     result->_raw_outputs = raw_results_ptr.get();
     memset(result->_raw_outputs, 0, sizeof(ei_feature_t) * handle->impulse->learning_blocks_size);
 
+#if EI_CLASSIFIER_CONTINUOUS_QUANTIZED
+    // checked every call: the float window below is only allocated when it is needed
+    if (can_run_classifier_continuous_quantized(handle->impulse) == EI_IMPULSE_OK) {
+        return process_impulse_continuous_quantized(handle, signal, result, debug);
+    }
+#endif
+
     auto impulse = handle->impulse;
     static ei::matrix_t static_features_matrix(1, impulse->nn_input_frame_size);
     if (!static_features_matrix.buffer) {
@@ -500,7 +631,11 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
             extract_fn_slice = &extract_spectrogram_per_slice_features;
         }
         else if (block.extract_fn == extract_mfe_features) {
+#if EIDSP_MFE_Q15
+            extract_fn_slice = &extract_mfe_per_slice_features_q15;
+#else
             extract_fn_slice = &extract_mfe_per_slice_features;
+#endif
         }
         else {
             ei_printf("ERR: Unknown extract function, only MFCC, MFE and spectrogram supported\n");
@@ -590,7 +725,14 @@ extern "C" EI_IMPULSE_ERROR process_impulse_continuous(ei_impulse_handle_t *hand
                 calc_cepstral_mean_and_var_normalization_spectrogram(features[ix].matrix, block.config);
             }
             else if (block.extract_fn == extract_mfe_features) {
+#if EIDSP_MFE_Q15
+                // versions 3 and 4 come out of the fixed-point front end already normalized
+                if (((ei_dsp_config_mfe_t*)block.config)->implementation_version < 3) {
+                    calc_cepstral_mean_and_var_normalization_mfe(features[ix].matrix, block.config);
+                }
+#else
                 calc_cepstral_mean_and_var_normalization_mfe(features[ix].matrix, block.config);
+#endif
             }
             out_features_index += block.n_output_features;
         }
@@ -949,6 +1091,43 @@ extern "C" EI_IMPULSE_ERROR run_classifier_continuous(
     return process_impulse_continuous(&impulse, signal, result, debug);
 }
 
+#if EIDSP_MFE_Q15
+/**
+ * @brief Same as `run_classifier_continuous()`, for a slice of int16 audio.
+ *
+ * The fixed-point MFE front end reads the samples directly, without the
+ * int16 -> float conversion of a `signal_t` callback.
+ *
+ * @param[in] samples Slice of raw audio (e.g. `EI_CLASSIFIER_SLICE_SIZE` samples)
+ * @param[in] length  Number of samples
+ * @param[out] result Pointer to an `ei_impulse_result_t` struct
+ * @param[in]  debug Print internal preprocessing and inference debugging information
+ *
+ * @return Error code as defined by `EI_IMPULSE_ERROR` enum
+ */
+extern "C" EI_IMPULSE_ERROR run_classifier_continuous_i16(
+    const int16_t *samples,
+    size_t length,
+    ei_impulse_result_t *result,
+    bool debug = false)
+{
+    // other blocks (if any) still read floats through the signal
+    signal_t signal;
+    signal.total_length = length;
+    signal.get_data = [samples](size_t offset, size_t length, float *out_ptr) {
+        for (size_t ix = 0; ix < length; ix++) {
+            out_ptr[ix] = (float)samples[offset + ix];
+        }
+        return EIDSP_OK;
+    };
+
+    ei_dsp_cont_i16_samples = samples;
+    EI_IMPULSE_ERROR res = process_impulse_continuous(&ei_default_impulse, &signal, result, debug);
+    ei_dsp_cont_i16_samples = nullptr;
+    return res;
+}
+#endif // EIDSP_MFE_Q15
+
 /**
  * @brief Run preprocessing (DSP) on new slice of raw features. Add output features
  *  to rolling matrix and run inference on full sample.
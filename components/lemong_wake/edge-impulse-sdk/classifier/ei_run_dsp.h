@@ -38,6 +38,12 @@
 #include "edge-impulse-sdk/classifier/ei_model_types.h"
 #include "edge-impulse-sdk/dsp/spectral/spectral.hpp"
 #include "edge-impulse-sdk/dsp/speechpy/speechpy.hpp"
+#if EIDSP_MFE_Q15
+#include "edge-impulse-sdk/dsp/speechpy/feature_q15.hpp"
+#endif
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+#include "edge-impulse-sdk/classifier/ei_quantize.h"
+#endif
 #include "edge-impulse-sdk/classifier/ei_signal_with_range.h"
 #include "edge-impulse-sdk/dsp/ei_flatten.h"
 #include "model-parameters/model_metadata.h"
@@ -89,6 +95,11 @@ static float *ei_dsp_cont_current_frame = nullptr;
 static size_t ei_dsp_cont_current_frame_size = 0;
 static int ei_dsp_cont_current_frame_ix = 0;
 
+#if EIDSP_MFE_Q15
+// int16 samples of the current slice, set by run_classifier_continuous_i16()
+static const int16_t *ei_dsp_cont_i16_samples = nullptr;
+#endif
+
 __attribute__((unused)) int extract_hr_features(
     signal_t *signal,
     matrix_t *output_matrix,
@@ -1400,6 +1411,227 @@ __attribute__((unused)) int extract_image_features_quantized(signal_t *signal, m
 }
 #endif // (EI_CLASSIFIER_QUANTIZATION_ENABLED == 1) && (EI_CLASSIFIER_INFERENCING_ENGINE != EI_CLASSIFIER_DRPAI)
 
+#if EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+// normalized MFE features sit on a 1/256 grid (mfe_normalization)
+#define EIDSP_MFE_NORMALIZED_LEVELS     256
+
+/**
+ * Maps every normalized MFE level (0..256) to the int8 value the float path
+ * produces through fill_input_tensor_from_matrix, for the input tensor's
+ * scale and zero point. Rebuilt only when the quantization changes.
+ */
+static const int8_t *mfe_level_to_i8_table(float scale, int32_t zero_point) {
+    static int8_t level_to_i8[EIDSP_MFE_NORMALIZED_LEVELS + 1];
+    static float table_scale = 0.0f;
+    static int32_t table_zero_point = 0;
+    if (scale != table_scale || zero_point != table_zero_point) {
+        for (int level = 0; level <= EIDSP_MFE_NORMALIZED_LEVELS; level++) {
+            level_to_i8[level] = static_cast<int8_t>(
+                pre_cast_quantize((float)level / EIDSP_MFE_NORMALIZED_LEVELS, scale, zero_point, true));
+        }
+        table_scale = scale;
+        table_zero_point = zero_point;
+    }
+    return level_to_i8;
+}
+
+/**
+ * Continuous MFE (float front end), quantized for an int8 model input.
+ * The slice's new frames go through extract_mfe_per_slice_features into a
+ * scratch matrix that only holds one slice, are normalized there, and are
+ * written into the int8 window through the level table. Only implementation
+ * versions 3 and 4, whose normalization is per element.
+ */
+__attribute__((unused)) int extract_mfe_per_slice_features_i8(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, int32_t zero_point, const float sampling_frequency, matrix_size_t *matrix_size_out) {
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)config_ptr;
+
+    if (config->axes != 1) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    if ((config->implementation_version < 3) || (config->implementation_version > 4)) {
+        EIDSP_ERR(EIDSP_BLOCK_VERSION_INCORRECT);
+    }
+
+    // one frame per stride, plus the frame completed from the previous slice's tail
+    const size_t cols = config->num_filters;
+    const size_t stride_values = (size_t)(sampling_frequency * config->frame_stride);
+    const size_t max_rows = (stride_values > 0 ? signal->total_length / stride_values : 0) + 2;
+
+    static float *scratch = nullptr;
+    static size_t scratch_size = 0;
+    if (scratch_size < max_rows * cols) {
+        ei_free(scratch);
+        scratch = (float*)ei_malloc(max_rows * cols * sizeof(float));
+        scratch_size = scratch ? max_rows * cols : 0;
+        if (!scratch) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+    }
+
+    // the extractor rolls the matrix and appends, so the new rows end up at its end
+    matrix_t slice_matrix(max_rows, cols, scratch);
+    int x = extract_mfe_per_slice_features(signal, &slice_matrix, config_ptr, sampling_frequency, matrix_size_out);
+    if (x != EIDSP_OK) {
+        EIDSP_ERR(x);
+    }
+
+    const size_t rows = matrix_size_out->rows;
+    const size_t written = rows * cols;
+    const size_t window_size = output_matrix->rows * output_matrix->cols;
+    if (rows > max_rows || written > window_size) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+    if (rows == 0) {
+        return EIDSP_OK;
+    }
+
+    matrix_t new_rows(rows, cols, scratch + (max_rows - rows) * cols);
+    x = speechpy::processing::mfe_normalization(&new_rows, config->noise_floor_db);
+    if (x != EIDSP_OK) {
+        EIDSP_ERR(x);
+    }
+
+    const int8_t *level_to_i8 = mfe_level_to_i8_table(scale, zero_point);
+    memmove(output_matrix->buffer, output_matrix->buffer + written, (window_size - written) * sizeof(int8_t));
+    int8_t *out = output_matrix->buffer + window_size - written;
+    for (size_t ix = 0; ix < written; ix++) {
+        // exact: mfe_normalization leaves k / 256 with k in 0..256
+        out[ix] = level_to_i8[(int)lrintf(new_rows.buffer[ix] * EIDSP_MFE_NORMALIZED_LEVELS)];
+    }
+
+    return EIDSP_OK;
+}
+#endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
+
+#if EIDSP_MFE_Q15
+/**
+ * Shared body of the fixed-point MFE slice extractors. Runs the slice through
+ * the Q15 front end, moves the window back by the number of new features and
+ * writes one row per new frame at its end, converting every level (0..256, the
+ * 1/256 grid of mfe_normalization) with `convert`.
+ */
+template<typename T, typename LevelConvert>
+static int extract_mfe_q15_slice_into(signal_t *signal, T *window, size_t window_size, ei_dsp_config_mfe_t *config, const float sampling_frequency, matrix_size_t *matrix_size_out, LevelConvert convert) {
+    if (signal->total_length == 0) {
+        EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+    }
+
+    speechpy::mfe_q15_state_t *st = speechpy::feature_q15::get(
+        static_cast<uint32_t>(sampling_frequency), config->frame_length, config->frame_stride,
+        config->num_filters, config->fft_length, config->low_frequency, config->high_frequency,
+        config->implementation_version, config->noise_floor_db);
+    if (!st) {
+        EIDSP_ERR(EIDSP_OUT_OF_MEM);
+    }
+
+    const size_t length = signal->total_length;
+
+    // int16 samples straight from run_classifier_continuous_i16(), otherwise
+    // read them through the signal
+    const int16_t *samples = ei_dsp_cont_i16_samples;
+    ei_unique_ptr_t converted(nullptr, ei_free);
+    if (!samples) {
+        int16_t *buffer = (int16_t*)ei_malloc(length * sizeof(int16_t));
+        if (!buffer) {
+            EIDSP_ERR(EIDSP_OUT_OF_MEM);
+        }
+        converted.reset(buffer);
+
+        float chunk[64];
+        for (size_t offset = 0; offset < length; offset += 64) {
+            const size_t n = (length - offset < 64) ? length - offset : 64;
+            int x = signal->get_data(offset, n, chunk);
+            if (x != EIDSP_OK) {
+                EIDSP_ERR(x);
+            }
+            for (size_t ix = 0; ix < n; ix++) {
+                long v = lrintf(chunk[ix]);
+                buffer[offset + ix] = (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+            }
+        }
+        samples = buffer;
+    }
+
+    const size_t cols = config->num_filters;
+    const size_t rows = speechpy::feature_q15::frames_in_slice(st, length);
+    const size_t written = rows * cols;
+    if (written > window_size) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    // the oldest rows are overwritten, so a plain move is enough (numpy::roll
+    // would allocate a scratch buffer to rotate them to the end)
+    memmove(window, window + written, (window_size - written) * sizeof(T));
+    T *out = window + window_size - written;
+
+    int x = speechpy::feature_q15::slice(st, samples, length, [out, cols, &convert](size_t row, const uint16_t *levels) {
+        T *dst = out + row * cols;
+        for (size_t ix = 0; ix < cols; ix++) {
+            dst[ix] = convert(levels[ix]);
+        }
+    });
+    if (x != EIDSP_OK) {
+        EIDSP_ERR(x);
+    }
+
+    matrix_size_out->rows = rows;
+    matrix_size_out->cols = rows > 0 ? cols : 0;
+
+    return EIDSP_OK;
+}
+
+/**
+ * Continuous MFE in fixed point. Writes the normalized features directly (on
+ * the 1/256 grid of mfe_normalization, which is skipped for this block).
+ * Implementation versions without preemphasis use the float path.
+ */
+__attribute__((unused)) int extract_mfe_per_slice_features_q15(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float sampling_frequency, matrix_size_t *matrix_size_out) {
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)config_ptr;
+
+    if (config->axes != 1) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    if ((config->implementation_version == 0) || (config->implementation_version > 4)) {
+        EIDSP_ERR(EIDSP_BLOCK_VERSION_INCORRECT);
+    }
+
+    if (config->implementation_version < 3) {
+        return extract_mfe_per_slice_features(signal, output_matrix, config_ptr, sampling_frequency, matrix_size_out);
+    }
+
+    return extract_mfe_q15_slice_into(signal, output_matrix->buffer, output_matrix->rows * output_matrix->cols,
+        config, sampling_frequency, matrix_size_out, [](uint16_t level) {
+            return (float)level * (1.0f / 256.0f);
+        });
+}
+
+/**
+ * Continuous MFE in fixed point, quantized for an int8 model input, through
+ * the same level table as the float front end (mfe_level_to_i8_table).
+ * Only implementation versions 3 and 4.
+ */
+__attribute__((unused)) int extract_mfe_per_slice_features_q15_i8(signal_t *signal, matrix_i8_t *output_matrix, void *config_ptr, float scale, int32_t zero_point, const float sampling_frequency, matrix_size_t *matrix_size_out) {
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)config_ptr;
+
+    if (config->axes != 1) {
+        EIDSP_ERR(EIDSP_MATRIX_SIZE_MISMATCH);
+    }
+
+    if ((config->implementation_version < 3) || (config->implementation_version > 4)) {
+        EIDSP_ERR(EIDSP_BLOCK_VERSION_INCORRECT);
+    }
+
+    const int8_t *level_to_i8 = mfe_level_to_i8_table(scale, zero_point);
+
+    return extract_mfe_q15_slice_into(signal, output_matrix->buffer, output_matrix->rows * output_matrix->cols,
+        config, sampling_frequency, matrix_size_out, [level_to_i8](uint16_t level) {
+            return level_to_i8[level];
+        });
+}
+#endif // EIDSP_MFE_Q15
+
 /**
  * Clear all state regarding continuous audio. Invoke this function after continuous audio loop ends.
  */
@@ -1412,6 +1644,10 @@ __attribute__((unused)) int ei_dsp_clear_continuous_audio_state() {
     ei_dsp_cont_current_frame_size = 0;
     ei_dsp_cont_current_frame_ix = 0;
 
+#if EIDSP_MFE_Q15
+    speechpy::feature_q15::reset_stream();
+#endif
+
     return EIDSP_OK;
 }
 
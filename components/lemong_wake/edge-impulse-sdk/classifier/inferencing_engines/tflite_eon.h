@@ -44,6 +44,44 @@
 #include "edge-impulse-sdk/classifier/inferencing_engines/tflite_helper.h"
 #include "edge-impulse-sdk/classifier/ei_run_dsp.h"
 
+/**
+ * Graph that is kept initialised between inferences (persistent session).
+ * When set, the tensor arena and the prepared op state survive across invocations
+ * and model_init / model_reset are only called by the session open / close functions.
+ */
+static ei_config_tflite_eon_graph_t *eon_persistent_graph = nullptr;
+
+static bool eon_session_is_open(ei_config_tflite_eon_graph_t *graph_config) {
+    return (eon_persistent_graph != nullptr) && (eon_persistent_graph == graph_config);
+}
+
+/**
+ * Per-inference time spent around model_invoke, accumulated since boot:
+ * setup is model_init (without a session) plus the tensor lookups,
+ * teardown is model_reset (without a session).
+ */
+typedef struct {
+    uint32_t inferences;
+    uint64_t setup_us;
+    uint64_t teardown_us;
+} ei_tflite_eon_overhead_t;
+
+static ei_tflite_eon_overhead_t eon_overhead = { 0, 0, 0 };
+
+/**
+ * Release the arena after an inference, unless a persistent session owns it
+ */
+static TfLiteStatus inference_tflite_teardown(ei_config_tflite_eon_graph_t *graph_config) {
+    eon_overhead.inferences++;
+    if (eon_session_is_open(graph_config)) {
+        return kTfLiteOk;
+    }
+    uint64_t start_us = ei_read_timer_us();
+    TfLiteStatus status = graph_config->model_reset(ei_aligned_free);
+    eon_overhead.teardown_us += ei_read_timer_us() - start_us;
+    return status;
+}
+
 /**
  * Setup the TFLite runtime
  *
@@ -66,10 +104,12 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
     TfLiteTensor *outputs = *output_arg;
     ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
 
-    TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
-    if (init_status != kTfLiteOk) {
-        ei_printf("Failed to initialize the model (error code %d)\n", init_status);
-        return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+    if (!eon_session_is_open(graph_config)) {
+        TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+        if (init_status != kTfLiteOk) {
+            ei_printf("Failed to initialize the model (error code %d)\n", init_status);
+            return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+        }
     }
 
     TfLiteStatus status;
@@ -86,6 +126,7 @@ static EI_IMPULSE_ERROR inference_tflite_setup(
         }
     }
 
+    eon_overhead.setup_us += ei_read_timer_us() - *ctx_start_us;
     return EI_IMPULSE_OK;
 }
 
@@ -130,6 +171,64 @@ static EI_IMPULSE_ERROR inference_tflite_run(
     return EI_IMPULSE_OK;
 }
 
+/**
+ * Copy (or dequantize) the output tensors into result->_raw_outputs
+ *
+ * @return  EI_IMPULSE_OK if successful
+ */
+static EI_IMPULSE_ERROR inference_tflite_fill_outputs(
+    ei_learning_block_config_tflite_graph_t *block_config,
+    TfLiteTensor *outputs,
+    uint32_t learn_block_index,
+    ei_impulse_result_t *result) {
+
+    for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
+        TfLiteTensor* output = &outputs[output_ix];
+        // calculate the size of the output by iterating through dims
+        size_t output_size = 1;
+        for (int dim_num = 0; dim_num < output->dims->size; dim_num++) {
+            output_size *= output->dims->data[dim_num];
+        }
+        switch (output->type) {
+            case kTfLiteFloat32: {
+                result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
+                memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix->buffer, output->data.f, output->bytes);
+                break;
+            }
+            case kTfLiteInt8: {
+                if (block_config->dequantize_output) {
+                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
+                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
+                }
+                else {
+                    result->_raw_outputs[learn_block_index + output_ix].matrix_i8 = new matrix_i8_t(1, output_size);
+                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_i8->buffer, output->data.int8, output->bytes);
+                }
+                break;
+            }
+            case kTfLiteUInt8: {
+                if (block_config->dequantize_output) {
+                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
+                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
+                }
+                else {
+                    result->_raw_outputs[learn_block_index + output_ix].matrix_u8 = new matrix_u8_t(1, output_size);
+                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_u8->buffer, output->data.uint8, output->bytes);
+                }
+                break;
+            }
+            default: {
+                ei_printf("ERR: Cannot handle output type (%d)\n", output->type);
+                return EI_IMPULSE_OUTPUT_TENSOR_WAS_NULL;
+            }
+        }
+
+        result->_raw_outputs[learn_block_index].blockId = block_config->block_id;
+    }
+
+    return EI_IMPULSE_OK;
+}
+
 /**
  * @brief      Do neural network inferencing over a signal (from the DSP)
  *
@@ -180,7 +279,7 @@ EI_IMPULSE_ERROR run_nn_inference_from_dsp(
         return output_res;
     }
 
-    if (graph_config->model_reset(ei_aligned_free) != kTfLiteOk) {
+    if (inference_tflite_teardown(graph_config) != kTfLiteOk) {
         return EI_IMPULSE_TFLITE_ERROR;
     }
     ei_free(outputs);
@@ -251,51 +350,12 @@ EI_IMPULSE_ERROR run_nn_inference(
         &outputs,
         tensor_arena, result, debug);
 
-    for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
-        TfLiteTensor* output = &outputs[output_ix];
-        // calculate the size of the output by iterating through dims
-        size_t output_size = 1;
-        for (int dim_num = 0; dim_num < output->dims->size; dim_num++) {
-            output_size *= output->dims->data[dim_num];
-        }
-        switch (output->type) {
-            case kTfLiteFloat32: {
-                result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix->buffer, output->data.f, output->bytes);
-                break;
-            }
-            case kTfLiteInt8: {
-                if (block_config->dequantize_output) {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
-                }
-                else {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix_i8 = new matrix_i8_t(1, output_size);
-                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_i8->buffer, output->data.int8, output->bytes);
-                }
-                break;
-            }
-            case kTfLiteUInt8: {
-                if (block_config->dequantize_output) {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
-                }
-                else {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix_u8 = new matrix_u8_t(1, output_size);
-                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_u8->buffer, output->data.uint8, output->bytes);
-                }
-                break;
-            }
-            default: {
-                ei_printf("ERR: Cannot handle output type (%d)\n", output->type);
-                return EI_IMPULSE_OUTPUT_TENSOR_WAS_NULL;
-            }
-        }
-
-        result->_raw_outputs[learn_block_index].blockId = block_config->block_id;
+    EI_IMPULSE_ERROR output_res = inference_tflite_fill_outputs(block_config, outputs, learn_block_index, result);
+    if (output_res != EI_IMPULSE_OK) {
+        return output_res;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    inference_tflite_teardown(graph_config);
     ei_free(outputs);
 
     if (run_res != EI_IMPULSE_OK) {
@@ -387,52 +447,157 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
         result,
         debug);
 
-    for (uint32_t output_ix = 0; output_ix < block_config->output_tensors_size; output_ix++) {
-        TfLiteTensor* output = &outputs[output_ix];
-        // calculate the size of the output by iterating through dims
-        size_t output_size = 1;
-        for (int dim_num = 0; dim_num < output->dims->size; dim_num++) {
-            output_size *= output->dims->data[dim_num];
-        }
+    EI_IMPULSE_ERROR output_res = inference_tflite_fill_outputs(block_config, outputs, learn_block_index, result);
+    if (output_res != EI_IMPULSE_OK) {
+        return output_res;
+    }
 
-        switch (output->type) {
-            case kTfLiteFloat32: {
-                result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix->buffer, output->data.f, output->bytes);
-                break;
-            }
-            case kTfLiteInt8: {
-                if (block_config->dequantize_output) {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
-                }
-                else {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix_i8 = new matrix_i8_t(1, output_size);
-                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_i8->buffer, output->data.int8, output->bytes);
-                }
-                break;
-            }
-            case kTfLiteUInt8: {
-                if (block_config->dequantize_output) {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix = new matrix_t(1, output_size);
-                    fill_output_matrix_from_tensor(output, result->_raw_outputs[learn_block_index + output_ix].matrix);
-                }
-                else {
-                    result->_raw_outputs[learn_block_index + output_ix].matrix_u8 = new matrix_u8_t(1, output_size);
-                    memcpy(result->_raw_outputs[learn_block_index + output_ix].matrix_u8->buffer, output->data.uint8, output->bytes);
-                }
-                break;
-            }
-            default: {
-                ei_printf("ERR: Cannot handle output type (%d)\n", output->type);
-                return EI_IMPULSE_OUTPUT_TENSOR_WAS_NULL;
-            }
+    inference_tflite_teardown(graph_config);
+    ei_free(outputs);
+
+    if (run_res != EI_IMPULSE_OK) {
+        return run_res;
+    }
+
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Quantization parameters of the (int8) input tensor
+ *
+ * Reads the tensor description only, so the model does not need to be initialised.
+ *
+ * @return     EI_IMPULSE_OK if the input tensor is int8
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_tflite_eon_input_quantization(
+    ei_learning_block_config_tflite_graph_t *block_config,
+    float *scale,
+    int32_t *zero_point) {
+
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    TfLiteTensor input;
+    if (graph_config->model_input(0, &input) != kTfLiteOk) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    if (input.type != kTfLiteInt8) {
+        return EI_IMPULSE_INPUT_TENSOR_WAS_NULL;
+    }
+
+    *scale = input.params.scale;
+    *zero_point = input.params.zero_point;
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Quantization parameters of an (int8) output tensor
+ *
+ * Reads the tensor description only, so the model does not need to be initialised.
+ *
+ * @return     EI_IMPULSE_OK if the output tensor is int8
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_tflite_eon_output_quantization(
+    ei_learning_block_config_tflite_graph_t *block_config,
+    size_t index,
+    float *scale,
+    int32_t *zero_point) {
+
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    TfLiteTensor output;
+    if (graph_config->model_output(index, &output) != kTfLiteOk) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    if (output.type != kTfLiteInt8) {
+        return EI_IMPULSE_OUTPUT_TENSOR_WAS_NULL;
+    }
+
+    *scale = output.params.scale;
+    *zero_point = output.params.zero_point;
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Do neural network inferencing over features that are already quantized
+ *
+ * The features are copied into the int8 input tensor as they are; there is no
+ * float feature matrix and no quantization pass. Used by continuous inference,
+ * whose feature window has to outlive the invoke (the arena planner reuses the
+ * input tensor's memory for later tensors).
+ *
+ * @param      features       int8 features, quantized with ei_tflite_eon_input_quantization()
+ * @param      features_size  Number of features, must match the input tensor
+ *
+ * @return     The ei impulse error.
+ */
+EI_IMPULSE_ERROR run_nn_inference_quantized_input(
+    const ei_impulse_t *impulse,
+    const int8_t *features,
+    size_t features_size,
+    uint32_t learn_block_index,
+    ei_impulse_result_t *result,
+    void *config_ptr,
+    bool debug = false) {
+
+    ei_learning_block_config_tflite_graph_t *block_config = (ei_learning_block_config_tflite_graph_t*)config_ptr;
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    uint64_t ctx_start_us;
+    TfLiteTensor input;
+    TfLiteTensor *outputs;
+
+    // allocate outputs
+    outputs = (TfLiteTensor*)ei_malloc(block_config->output_tensors_size * sizeof(TfLiteTensor));
+
+    ei_unique_ptr_t p_tensor_arena(nullptr, ei_aligned_free);
+
+    EI_IMPULSE_ERROR init_res = inference_tflite_setup(
+        block_config,
+        &ctx_start_us,
+        &input,
+        &outputs,
+        p_tensor_arena);
+
+    if (init_res != EI_IMPULSE_OK) {
+        return init_res;
+    }
+
+    if (input.type != kTfLiteInt8) {
+        return EI_IMPULSE_INPUT_TENSOR_WAS_NULL;
+    }
+
+    if (input.bytes != features_size) {
+        ei_printf("ERR: input tensor has size %d bytes, but input matrix has has size %d bytes\n",
+            (int)input.bytes, (int)features_size);
+        return EI_IMPULSE_INVALID_SIZE;
+    }
+
+    memcpy(input.data.int8, features, features_size);
+
+    if (debug) {
+        ei_printf("Features: ");
+        for (size_t ix = 0; ix < features_size; ix++) {
+            ei_printf_float((features[ix] - input.params.zero_point) * input.params.scale);
+            ei_printf(" ");
         }
+        ei_printf("\n");
+    }
 
-        result->_raw_outputs[learn_block_index].blockId = block_config->block_id;
+    EI_IMPULSE_ERROR run_res = inference_tflite_run(
+        impulse,
+        block_config,
+        ctx_start_us,
+        &outputs,
+        static_cast<uint8_t*>(p_tensor_arena.get()),
+        result,
+        debug);
+
+    EI_IMPULSE_ERROR output_res = inference_tflite_fill_outputs(block_config, outputs, learn_block_index, result);
+    if (output_res != EI_IMPULSE_OK) {
+        return output_res;
     }
 
-    graph_config->model_reset(ei_aligned_free);
+    inference_tflite_teardown(graph_config);
     ei_free(outputs);
 
     if (run_res != EI_IMPULSE_OK) {
@@ -443,6 +608,90 @@ EI_IMPULSE_ERROR run_nn_inference_image_quantized(
 }
 #endif // EI_CLASSIFIER_QUANTIZATION_ENABLED == 1
 
+/**
+ * @brief      Keep a compiled model initialised across inferences
+ *
+ * Runs model_init once: the tensor arena stays allocated (or, with
+ * EI_CLASSIFIER_ALLOCATION_STATIC, stays in place) and every op keeps its
+ * prepared state, so subsequent run_nn_inference calls only fill the input
+ * tensor and invoke. Only one graph can hold a session at a time.
+ *
+ * @param      block_config  Learning block config of the compiled graph
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_tflite_eon_session_open(ei_learning_block_config_tflite_graph_t *block_config) {
+    ei_config_tflite_eon_graph_t *graph_config = (ei_config_tflite_eon_graph_t*)block_config->graph_config;
+
+    if (eon_session_is_open(graph_config)) {
+        return EI_IMPULSE_OK;
+    }
+    if (eon_persistent_graph != nullptr) {
+        ei_printf("ERR: another compiled model already holds a persistent session\n");
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+
+    TfLiteStatus init_status = graph_config->model_init(ei_aligned_calloc);
+    if (init_status != kTfLiteOk) {
+        ei_printf("Failed to initialize the model (error code %d)\n", init_status);
+        return EI_IMPULSE_TFLITE_ARENA_ALLOC_FAILED;
+    }
+
+    eon_persistent_graph = graph_config;
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Release the arena held by ei_tflite_eon_session_open()
+ *
+ * @return     EI_IMPULSE_OK if successful
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_tflite_eon_session_close(void) {
+    if (eon_persistent_graph == nullptr) {
+        return EI_IMPULSE_OK;
+    }
+
+    ei_config_tflite_eon_graph_t *graph_config = eon_persistent_graph;
+    eon_persistent_graph = nullptr;
+
+    if (graph_config->model_reset(ei_aligned_free) != kTfLiteOk) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Output tensor of the model held by ei_tflite_eon_session_open()
+ *
+ * The tensor data lives in the arena and is valid until the next inference,
+ * so the raw (quantized) scores can be read without going through the
+ * dequantized classification results.
+ *
+ * @param      index   Output tensor index
+ * @param      output  Filled with the tensor description and data pointer
+ *
+ * @return     EI_IMPULSE_OK if a session is open
+ */
+__attribute__((unused)) EI_IMPULSE_ERROR ei_tflite_eon_session_output(size_t index, TfLiteTensor *output) {
+    if (eon_persistent_graph == nullptr) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    if (eon_persistent_graph->model_output(index, output) != kTfLiteOk) {
+        return EI_IMPULSE_TFLITE_ERROR;
+    }
+    return EI_IMPULSE_OK;
+}
+
+/**
+ * @brief      Time spent in setup / teardown around each model_invoke
+ *
+ * With a persistent session this is only the tensor lookups; without one it
+ * also includes model_init (arena allocation and op prepare) and model_reset.
+ */
+__attribute__((unused)) void ei_tflite_eon_get_overhead(ei_tflite_eon_overhead_t *overhead) {
+    *overhead = eon_overhead;
+}
+
 __attribute__((unused)) int extract_tflite_eon_features(signal_t *signal, matrix_t *output_matrix, void *config_ptr, const float frequency) {
     ei_dsp_config_tflite_eon_t *dsp_config = (ei_dsp_config_tflite_eon_t*)config_ptr;
 
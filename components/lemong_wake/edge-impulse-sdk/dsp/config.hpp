@@ -102,6 +102,12 @@
 #define EIDSP_SIGNAL_C_FN_POINTER    0
 #endif // EIDSP_SIGNAL_C_FN_POINTER
 
+// The cached MFE filterbank is applied with one dot product per filter. Set to 1 to
+// sum in the same order as the reference filterbank instead (bit-identical output)
+#ifndef EIDSP_MFE_EXACT_SUM_ORDER
+#define EIDSP_MFE_EXACT_SUM_ORDER    0
+#endif // EIDSP_MFE_EXACT_SUM_ORDER
+
 #ifndef EIDSP_USE_ESP_DSP
 #if defined(ESP32) || defined(CONFIG_IDF_TARGET_ESP32) || defined(CONFIG_IDF_TARGET_ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32P4) || defined(CONFIG_IDF_TARGET_ESP32C3)
 #define EIDSP_USE_ESP_DSP 1
@@ -109,5 +115,15 @@
 #define EIDSP_USE_ESP_DSP 0
 #endif
 #endif
+
+// Continuous MFE (implementation version 3 and 4) in fixed point: Q15 FFT, power
+// spectrum and filterbank, LUT log (see speechpy/feature_q15.hpp)
+#ifndef EIDSP_MFE_Q15
+#define EIDSP_MFE_Q15                0
+#endif // EIDSP_MFE_Q15
+
+#if EIDSP_MFE_Q15 == 1 && EIDSP_USE_ESP_DSP == 0
+#error "EIDSP_MFE_Q15 requires EIDSP_USE_ESP_DSP (the sc16 FFT)"
+#endif
 // clang-format on
 #endif // _EIDSP_CPP_CONFIG_H_
@@ -7,8 +7,11 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <math.h>
 #include "edge-impulse-sdk/porting/espressif/esp-dsp/modules/fft/include/dsps_fft2r.h"
 #include "edge-impulse-sdk/porting/ei_logging.h"
+#include "edge-impulse-sdk/classifier/ei_aligned_malloc.h"
 
 namespace ei {
 namespace fft {
@@ -18,6 +21,16 @@ constexpr int MAX_FFT_SIZE = 4096;
 
 static bool init_done = false;
 
+/**
+ * Persistent state for the packed real FFT.
+ * A real n_fft-point FFT is computed as an n_fft/2-point complex FFT of the
+ * even/odd samples packed as re/im, followed by a split step. The workspace and
+ * the split twiddles are allocated once per FFT size, not per frame.
+ */
+static size_t rfft_size = 0;
+static float *rfft_workspace = nullptr;     // n_fft floats (n_fft/2 complex), 16-byte aligned
+static float *rfft_split_w = nullptr;       // cos/sin(2*pi*k/n_fft), k = 0..n_fft/4
+
 static bool can_do_fft(size_t n_fft) {
     // if power of 2 and within range
     if (n_fft < MIN_FFT_SIZE || n_fft > MAX_FFT_SIZE)
@@ -42,6 +55,43 @@ static bool init_fft(size_t n_fft) {
     return true;
 }
 
+static bool init_rfft(size_t n_fft) {
+    if (rfft_size == n_fft) {
+        return true;
+    }
+
+    if (rfft_workspace) {
+        ei_aligned_free(rfft_workspace);
+        rfft_workspace = nullptr;
+    }
+    if (rfft_split_w) {
+        ei_free(rfft_split_w);
+        rfft_split_w = nullptr;
+    }
+    rfft_size = 0;
+
+    // the aes3 radix-2 kernel needs 16-byte aligned data
+    rfft_workspace = (float*)ei_aligned_calloc(16, n_fft * sizeof(float));
+    rfft_split_w = (float*)ei_malloc((n_fft / 4 + 1) * 2 * sizeof(float));
+    if (rfft_workspace == nullptr || rfft_split_w == nullptr) {
+        EI_LOGE("Failed to allocate real FFT workspace\n");
+        return false;
+    }
+
+    const float e = 2.0f * (float)M_PI / (float)n_fft;
+    for (size_t k = 0; k <= n_fft / 4; k++) {
+        rfft_split_w[k * 2 + 0] = cosf(k * e);
+        rfft_split_w[k * 2 + 1] = sinf(k * e);
+    }
+
+    rfft_size = n_fft;
+    return true;
+}
+
+/**
+ * Real-input FFT, output is n_fft / 2 + 1 complex bins (same as numpy.fft.rfft).
+ * The input is not modified.
+ */
 static int hw_r2c_fft(const float *input, ei::fft_complex_t *output_as_complex, size_t n_fft) {
     if (!init_done) {
         if (!init_fft(n_fft)) {
@@ -50,38 +100,58 @@ static int hw_r2c_fft(const float *input, ei::fft_complex_t *output_as_complex,
         }
         init_done = true;
     }
-    // ESP-DSP expects input/output as float arrays, length must be power of 2
-    float *in = const_cast<float *>(input);
-    float *output = (float*)output_as_complex;
-    int err = 0;
-
-    // Prepare input as complex numbers (real part, imaginary part)
-    float *complex_input = (float*)ei_malloc(n_fft * sizeof(float) * 2);
-    if (complex_input == nullptr) {
-        EI_LOGE("Failed to allocate memory for complex input\n");
-        goto out;
+    if (!init_rfft(n_fft)) {
         return -1; // EIDSP_MEMORY_ALLOC_FAILED
     }
 
-    for (size_t i = 0; i < n_fft; i++) {
-        complex_input[i * 2 + 0] = in[i]; // Real part
-        complex_input[i * 2 + 1] = 0.0f; // Imaginary part
-    }
+    const int half = (int)(n_fft / 2);
+    float *z = rfft_workspace;
+    float *output = (float*)output_as_complex;
 
-    err = dsps_fft2r_fc32(complex_input, n_fft);
+    // z[n] = x[2n] + j * x[2n + 1] is exactly the real input in memory order
+    memcpy(z, input, n_fft * sizeof(float));
+
+    int err = dsps_fft2r_fc32(z, half);
     if (err != 0) {
         EI_LOGE("Error in dsps_fft2r_fc32: %d\n", err);
         return err;
     }
-    // Rearrange output if needed (ESP-DSP uses bit-reversed order)
-    dsps_bit_rev_fc32(complex_input, n_fft);
+    // table based bit reversal (aes3 lookup kernel on ESP32-S3)
+    dsps_bit_rev2r_fc32(z, half);
+
+    // Split step: with Z[k] the n_fft/2-point FFT of z,
+    //   Fe[k] = (Z[k] + conj(Z[N/2 - k])) / 2       (FFT of the even samples)
+    //   Fo[k] = (Z[k] - conj(Z[N/2 - k])) / (2j)    (FFT of the odd samples)
+    //   X[k]       = Fe[k] + W^k * Fo[k]
+    //   X[N/2 - k] = conj(Fe[k] - W^k * Fo[k])
+    // with W = exp(-2j * pi / N)
+    output[0] = z[0] + z[1];
+    output[1] = 0.0f;
+    output[n_fft] = z[0] - z[1];
+    output[n_fft + 1] = 0.0f;
+
+    for (int k = 1; k <= half / 2; k++) {
+        const float ar = z[2 * k];
+        const float ai = z[2 * k + 1];
+        const float br = z[2 * (half - k)];
+        const float bi = z[2 * (half - k) + 1];
 
-    // Copy result to output
-    for (size_t i = 0; i < n_fft + 2; i++) {
-        output[i] = complex_input[i];
+        const float fe_r = 0.5f * (ar + br);
+        const float fe_i = 0.5f * (ai - bi);
+        const float fo_r = 0.5f * (ai + bi);
+        const float fo_i = 0.5f * (br - ar);
+
+        const float c = rfft_split_w[2 * k];
+        const float s = rfft_split_w[2 * k + 1];
+        const float t_r = c * fo_r + s * fo_i;
+        const float t_i = c * fo_i - s * fo_r;
+
+        output[2 * k] = fe_r + t_r;
+        output[2 * k + 1] = fe_i + t_i;
+        output[2 * (half - k)] = fe_r - t_r;
+        output[2 * (half - k) + 1] = t_i - fe_i;
     }
-out:
-    ei_free(complex_input);
+
     return 0;
 }
 
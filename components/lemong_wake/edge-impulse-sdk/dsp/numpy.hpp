@@ -1356,6 +1356,18 @@ public:
             src_size = n_fft;
         }
 
+#if EIDSP_USE_ESP_DSP
+        // The ESP-DSP real FFT copies the input into its own workspace and leaves
+        // it untouched, so a full-length frame needs no intermediate copy
+        if (src_size == n_fft) {
+            auto res = ei::fft::hw_r2c_fft(src, output, n_fft);
+            if (handle_fft_hw_failure(res, n_fft)) {
+                return software_rfft(const_cast<float*>(src), output, n_fft, n_fft_out_features);
+            }
+            return EIDSP_OK;
+        }
+#endif
+
         // Unfortunately, arm fft (at least) modifies the input buffer AND does not work in place
         // So we have to copy the input to a new buffer
         EI_DSP_MATRIX(fft_input, 1, n_fft);
@@ -39,6 +39,11 @@
 #include "../memory.hpp"
 #include "../returntypes.hpp"
 #include "../ei_vector.h"
+#include "../config.hpp"
+
+#if EIDSP_USE_ESP_DSP
+#include "dsps_dotprod.h"
+#endif
 
 namespace ei {
 namespace speechpy {
@@ -193,6 +198,198 @@ public:
         return static_cast<int>(floor((fft_size + 1) * hertz / sampling_freq));
     }
 
+    /**
+     * Sparse mel filterbank used by `mfe`: every filter is a contiguous run of
+     * power spectrum bins with its weights. Runs start on a multiple of 4 bins and
+     * are zero padded to a multiple of 4, so a 16-byte aligned spectrum can be fed
+     * to the SIMD dot product as is.
+     */
+    typedef struct {
+        uint32_t sampling_frequency;
+        uint32_t low_frequency;
+        uint32_t high_frequency;
+        uint16_t fft_length;
+        uint16_t num_filters;
+        uint16_t version;
+        uint16_t *bins;     // num_filters + 2 band edges (fft bin index)
+        uint16_t *start;    // first spectrum bin of each filter
+        uint16_t *length;   // number of weights of each filter
+        uint16_t *offset;   // offset of each filter in weights
+        float *weights;     // 16-byte aligned
+    } mel_filterbank_t;
+
+    /**
+     * Single entry cache, the filterbank only changes with the DSP block parameters
+     */
+    static mel_filterbank_t *mel_filterbank_cache() {
+        static mel_filterbank_t filterbank = { 0 };
+        return &filterbank;
+    }
+
+    static void free_mel_filterbank(mel_filterbank_t *fb) {
+        if (fb->bins) {
+            ei_free(fb->bins);
+        }
+        if (fb->weights) {
+            ei_aligned_free(fb->weights);
+        }
+        memset(fb, 0, sizeof(mel_filterbank_t));
+    }
+
+    /**
+     * Get the mel filterbank for these parameters, computing it on the first call.
+     * Band edges and weights are computed exactly as the speechpy reference does
+     * (including its bin quirks), so the weights are bit-identical.
+     * @returns nullptr if out of memory
+     */
+    static const mel_filterbank_t *get_mel_filterbank(
+        uint32_t sampling_frequency, uint16_t num_filters, uint16_t fft_length,
+        uint32_t low_frequency, uint32_t high_frequency, uint16_t version)
+    {
+        mel_filterbank_t *fb = mel_filterbank_cache();
+        if (fb->weights &&
+            fb->sampling_frequency == sampling_frequency && fb->num_filters == num_filters &&
+            fb->fft_length == fft_length && fb->low_frequency == low_frequency &&
+            fb->high_frequency == high_frequency && fb->version == version) {
+            return fb;
+        }
+        free_mel_filterbank(fb);
+
+        const size_t power_spectrum_frame_size = (fft_length / 2 + 1);
+        // Computing the Mel filterbank
+        // converting the upper and lower frequencies to Mels.
+        // num_filter + 2 is because for num_filter filterbanks we need
+        // num_filter+2 point.
+        const int MELS_SIZE = num_filters + 2;
+        float *mels = (float*)ei_calloc(MELS_SIZE, sizeof(float));
+        if (!mels) {
+            return nullptr;
+        }
+        fb->bins = (uint16_t*)ei_calloc(MELS_SIZE + 3 * num_filters, sizeof(uint16_t));
+        if (!fb->bins) {
+            ei_free(mels);
+            return nullptr;
+        }
+        fb->start = fb->bins + MELS_SIZE;
+        fb->length = fb->start + num_filters;
+        fb->offset = fb->length + num_filters;
+        uint16_t *bins = fb->bins;
+
+        numpy::linspace(
+            functions::frequency_to_mel(static_cast<float>(low_frequency)),
+            functions::frequency_to_mel(static_cast<float>(high_frequency)),
+            num_filters + 2,
+            mels);
+
+        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
+        // go to -1 size b/c special handling, see after
+        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
+            mels[ix] = functions::mel_to_frequency(mels[ix]);
+            if (mels[ix] < low_frequency) {
+                mels[ix] = low_frequency;
+            }
+            if (mels[ix] > high_frequency) {
+                mels[ix] = high_frequency;
+            }
+            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
+        }
+
+        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
+        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
+        // thus calculating the bucket to 64, not 65.
+        // we're adjusting this here a tiny bit to ensure we have the same result
+        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
+        if (mels[MELS_SIZE-1] > high_frequency) {
+            mels[MELS_SIZE-1] = high_frequency;
+        }
+        mels[MELS_SIZE-1] -= 0.001;
+        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
+        ei_free(mels);
+
+        // lay out the runs: left and right have zero weight, middle always 1.0
+        size_t total = 0;
+        for (size_t i = 0; i < num_filters; i++) {
+            size_t left = bins[i];
+            size_t middle = bins[i+1];
+            size_t right = bins[i+2];
+            assert(right < power_spectrum_frame_size);
+
+            size_t first = (left + 1 < middle) ? left + 1 : middle;
+            size_t last = (right > middle + 1) ? right - 1 : middle;
+            size_t start = first & ~((size_t)3);
+            size_t end = (last + 1 + 3) & ~((size_t)3);
+
+            fb->start[i] = start;
+            fb->length[i] = end - start;
+            fb->offset[i] = total;
+            total += end - start;
+        }
+
+        fb->weights = (float*)ei_aligned_calloc(16, total * sizeof(float));
+        if (!fb->weights) {
+            free_mel_filterbank(fb);
+            return nullptr;
+        }
+
+        for (size_t i = 0; i < num_filters; i++) {
+            size_t left = bins[i];
+            size_t middle = bins[i+1];
+            size_t right = bins[i+2];
+            float *w = fb->weights + fb->offset[i];
+            size_t start = fb->start[i];
+
+            w[middle - start] = 1.0f;
+            for (size_t bin = left+1; bin < right; bin++) {
+                if (bin < middle) {
+                    w[bin - start] = ((static_cast<float>(bin) - left) / (middle - left));
+                }
+                if (bin > middle) {
+                    w[bin - start] = ((right - static_cast<float>(bin)) / (right - middle));
+                }
+            }
+        }
+
+        fb->sampling_frequency = sampling_frequency;
+        fb->low_frequency = low_frequency;
+        fb->high_frequency = high_frequency;
+        fb->fft_length = fft_length;
+        fb->num_filters = num_filters;
+        fb->version = version;
+        return fb;
+    }
+
+    /**
+     * Apply the filterbank to one power spectrum frame.
+     * @param power_spectrum Spectrum, zero padded to a multiple of 4 bins
+     */
+    static void apply_mel_filterbank(const mel_filterbank_t *fb, const float *power_spectrum, float *out)
+    {
+        for (size_t i = 0; i < fb->num_filters; i++) {
+            const float *w = fb->weights + fb->offset[i];
+            const size_t start = fb->start[i];
+#if EIDSP_MFE_EXACT_SUM_ORDER
+            // same summation order as the reference filterbank: bit-identical output
+            size_t left = fb->bins[i];
+            size_t middle = fb->bins[i+1];
+            size_t right = fb->bins[i+2];
+            out[i] = power_spectrum[middle];
+            for (size_t bin = left+1; bin < right; bin++) {
+                if (bin != middle) {
+                    out[i] += w[bin - start] * power_spectrum[bin];
+                }
+            }
+#elif EIDSP_USE_ESP_DSP
+            dsps_dotprod_f32(w, power_spectrum + start, &out[i], fb->length[i]);
+#else
+            float sum = 0.0f;
+            for (size_t k = 0; k < fb->length[i]; k++) {
+                sum += w[k] * power_spectrum[start + k];
+            }
+            out[i] = sum;
+#endif
+        }
+    }
+
     /**
      * Compute Mel-filterbank energy features from an audio signal.
      * @param out_features Use `calculate_mfe_buffer_size` to allocate the right matrix.
@@ -267,52 +464,16 @@ public:
         }
 
         const size_t power_spectrum_frame_size = (fft_length / 2 + 1);
-        // Computing the Mel filterbank
-        // converting the upper and lower frequencies to Mels.
-        // num_filter + 2 is because for num_filter filterbanks we need
-        // num_filter+2 point.
-        float *mels;
-        const int MELS_SIZE = num_filters + 2;
-        const size_t mem_size = MELS_SIZE * sizeof(float);
-        mels = (float*)ei_dsp_calloc(MELS_SIZE, sizeof(float));
-        EI_ERR_AND_RETURN_ON_NULL(mels, EIDSP_OUT_OF_MEM);
-        ei_unique_ptr_t __ptr__(mels,[mem_size](void* ptr){ei::ei_dsp_free_func(ptr, mem_size);});
-        uint16_t* bins = reinterpret_cast<uint16_t*>(mels); // alias the mels array so we can reuse the space
-
-        numpy::linspace(
-            functions::frequency_to_mel(static_cast<float>(low_frequency)),
-            functions::frequency_to_mel(static_cast<float>(high_frequency)),
-            num_filters + 2,
-            mels);
-
-        uint16_t max_bin = version >= 4 ? fft_length : power_spectrum_frame_size; // preserve a bug in v<4
-        // go to -1 size b/c special handling, see after
-        for (uint16_t ix = 0; ix < MELS_SIZE-1; ix++) {
-            mels[ix] = functions::mel_to_frequency(mels[ix]);
-            if (mels[ix] < low_frequency) {
-                mels[ix] = low_frequency;
-            }
-            if (mels[ix] > high_frequency) {
-                mels[ix] = high_frequency;
-            }
-            bins[ix] = get_fft_bin_from_hertz(max_bin, mels[ix], sampling_frequency);
-        }
-
-        // here is a really annoying bug in Speechpy which calculates the frequency index wrong for the last bucket
-        // the last 'hertz' value is not 8,000 (with sampling rate 16,000) but 7,999.999999
-        // thus calculating the bucket to 64, not 65.
-        // we're adjusting this here a tiny bit to ensure we have the same result
-        mels[MELS_SIZE-1] = functions::mel_to_frequency(mels[MELS_SIZE-1]);
-        if (mels[MELS_SIZE-1] > high_frequency) {
-            mels[MELS_SIZE-1] = high_frequency;
-        }
-        mels[MELS_SIZE-1] -= 0.001;
-        bins[MELS_SIZE-1] = get_fft_bin_from_hertz(max_bin, mels[MELS_SIZE-1], sampling_frequency);
+        const mel_filterbank_t *filterbank = get_mel_filterbank(
+            sampling_frequency, num_filters, fft_length, low_frequency, high_frequency, version);
+        EI_ERR_AND_RETURN_ON_NULL(filterbank, EIDSP_OUT_OF_MEM);
 
-        EI_DSP_MATRIX(power_spectrum_frame, 1, power_spectrum_frame_size);
-        if (!power_spectrum_frame.buffer) {
-            EIDSP_ERR(EIDSP_OUT_OF_MEM);
-        }
+        // 16-byte aligned and zero padded to a multiple of 4 bins (calloc), so the
+        // filterbank runs can be fed to the SIMD dot product directly
+        const size_t power_spectrum_padded_size = (power_spectrum_frame_size + 3) & ~((size_t)3);
+        float *power_spectrum_frame = (float*)ei_aligned_calloc(16, power_spectrum_padded_size * sizeof(float));
+        EI_ERR_AND_RETURN_ON_NULL(power_spectrum_frame, EIDSP_OUT_OF_MEM);
+        ei_unique_ptr_t __ptr__(power_spectrum_frame, [](void* ptr){ ei_aligned_free(ptr); });
 
         // get signal data from the audio file
         EI_DSP_MATRIX(signal_frame, 1, stack_frame_info.frame_length);
@@ -338,7 +499,7 @@ public:
             ret = numpy::power_spectrum(
                 signal_frame.buffer,
                 stack_frame_info.frame_length,
-                power_spectrum_frame.buffer,
+                power_spectrum_frame,
                 power_spectrum_frame_size,
                 fft_length
             );
@@ -347,7 +508,7 @@ public:
                 EIDSP_ERR(ret);
             }
 
-            float energy = numpy::sum(power_spectrum_frame.buffer, power_spectrum_frame_size);
+            float energy = numpy::sum(power_spectrum_frame, power_spectrum_frame_size);
             if (energy == 0) {
                 energy = 1e-10;
             }
@@ -356,34 +517,7 @@ public:
                 out_energies->buffer[ix] = energy;
             }
 
-            auto row_ptr = out_features->get_row_ptr(ix);
-            for (size_t i = 0; i < num_filters; i++) {
-                size_t left = bins[i];
-                size_t middle = bins[i+1];
-                size_t right = bins[i+2];
-
-                assert(right < power_spectrum_frame_size);
-                // now we have weights and locations to move from fft to mel sgram
-                // both left and right become zero weights, so skip them
-
-                // middle always has weight of 1.0
-                // since we skip left and right, if left = middle we need to handle that
-                row_ptr[i] = power_spectrum_frame.buffer[middle];
-
-                for (size_t bin = left+1; bin < right; bin++) {
-                    if (bin < middle) {
-                        row_ptr[i] +=
-                            ((static_cast<float>(bin) - left) / (middle - left)) * // weight *
-                            power_spectrum_frame.buffer[bin];
-                    }
-                    // intentionally skip middle, handled above
-                    if (bin > middle) {
-                        row_ptr[i] +=
-                            ((right - static_cast<float>(bin)) / (right - middle)) * // weight *
-                            power_spectrum_frame.buffer[bin];
-                    }
-                }
-            }
+            apply_mel_filterbank(filterbank, power_spectrum_frame, out_features->get_row_ptr(ix));
 
             if (ret != 0) {
                 EIDSP_ERR(ret);
@@ -0,0 +1,434 @@
+/*
+ * Fixed-point MFE front end (implementation version 3 and 4, continuous audio).
+ *
+ * Computes the same features as `feature::mfe` followed by
+ * `processing::mfe_normalization`, but from int16 samples and in integer
+ * arithmetic only:
+ *
+ *   int16 -> preemphasis (Q4) -> block scaled Q15 frame -> packed real FFT
+ *   (dsps_fft2r_sc16, aes3 kernel on ESP32-S3) -> Q15 power spectrum ->
+ *   Q15 mel filterbank (uint64 accumulators) -> LUT log2 -> normalized level
+ *
+ * The output of a frame is one level per filter in 0..256, the quantization
+ * grid of mfe_normalization (`round(f * 256) / 256`, clipped to [0, 1]), so a
+ * level maps to exactly one int8 model input.
+ */
+
+#ifndef _EIDSP_SPEECHPY_FEATURE_Q15_H_
+#define _EIDSP_SPEECHPY_FEATURE_Q15_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "../config.hpp"
+#include "../returntypes.hpp"
+#include "feature.hpp"
+
+#if EIDSP_USE_ESP_DSP
+#include "edge-impulse-sdk/porting/espressif/esp-dsp/modules/fft/include/dsps_fft2r.h"
+#include "edge-impulse-sdk/classifier/ei_aligned_malloc.h"
+
+namespace ei {
+namespace speechpy {
+
+// 0.98 in Q15, the preemphasis coefficient of implementation version 3 and 4
+#define EIDSP_MFE_Q15_PREEMPHASIS_COF   32113
+// preemphasized samples are kept with 4 fractional bits
+#define EIDSP_MFE_Q15_PREEMPHASIS_FRAC  4
+// frames are scaled to 14 bits: the 7 halving stages of the sc16 FFT cannot overflow then
+#define EIDSP_MFE_Q15_FRAME_BITS        14
+// output levels: 0..256, i.e. the 1/256 grid of mfe_normalization
+#define EIDSP_MFE_Q15_LEVELS            256
+// log2 table: 256 mantissa steps, Q16, linear interpolation in between
+#define EIDSP_MFE_Q15_LOG2_STEPS        256
+
+typedef struct {
+    // parameters the state was built for
+    uint32_t sampling_frequency;
+    uint16_t frame_length;          // samples per frame
+    uint16_t frame_stride;          // samples between frames
+    uint16_t fft_length;
+    uint16_t num_filters;
+    int noise_floor_db;
+
+    const feature::mel_filterbank_t *filterbank;
+    uint16_t *weights;              // Q15 copy of filterbank->weights (1.0 = 32768)
+    int16_t *fft_buffer;            // fft_length / 2 complex sc16, 16-byte aligned
+    int16_t *split_twiddles;        // cos / sin(2 * pi * k / fft_length) in Q15, k = 0..fft_length / 4
+    uint32_t *power;                // fft_length / 2 + 1 bins
+    uint16_t *levels;               // one frame of output levels
+
+    // level = ((log2(E) - energy_exp) * level_scale + level_offset) >> 32, see get()
+    int64_t level_scale;            // Q16
+    int64_t level_offset;           // Q32, for log2 in Q16 including the fixed point exponents
+
+    // stream state: preemphasized samples from the start of the next frame (Q4)
+    int32_t *pending;
+    size_t pending_count;
+} mfe_q15_state_t;
+
+class feature_q15 {
+public:
+    /**
+     * Single entry cache, like the float filterbank
+     */
+    static mfe_q15_state_t *state() {
+        static mfe_q15_state_t st = { 0 };
+        return &st;
+    }
+
+    static void free_state(mfe_q15_state_t *st) {
+        ei_free(st->weights);
+        if (st->fft_buffer) {
+            ei_aligned_free(st->fft_buffer);
+        }
+        ei_free(st->split_twiddles);
+        ei_free(st->power);
+        ei_free(st->levels);
+        ei_free(st->pending);
+        memset(st, 0, sizeof(mfe_q15_state_t));
+    }
+
+    /**
+     * Drop the samples carried over between slices (stream interrupted)
+     */
+    static void reset_stream() {
+        state()->pending_count = 0;
+    }
+
+    /**
+     * Get the state for these parameters, allocating it on the first call.
+     * @returns nullptr if out of memory or the parameters are not supported
+     */
+    static mfe_q15_state_t *get(
+        uint32_t sampling_frequency, float frame_length, float frame_stride,
+        uint16_t num_filters, uint16_t fft_length, uint32_t low_frequency,
+        uint32_t high_frequency, uint16_t version, int noise_floor_db)
+    {
+        if (high_frequency == 0) {
+            high_frequency = sampling_frequency / 2;
+        }
+
+        const uint16_t frame_length_values = (uint16_t)(sampling_frequency * frame_length);
+        const uint16_t frame_stride_values = (uint16_t)(sampling_frequency * frame_stride);
+
+        mfe_q15_state_t *st = state();
+        if (st->weights &&
+            st->sampling_frequency == sampling_frequency && st->frame_length == frame_length_values &&
+            st->frame_stride == frame_stride_values && st->fft_length == fft_length &&
+            st->num_filters == num_filters && st->noise_floor_db == noise_floor_db &&
+            st->filterbank == feature::get_mel_filterbank(
+                sampling_frequency, num_filters, fft_length, low_frequency, high_frequency, version)) {
+            return st;
+        }
+        free_state(st);
+
+        // the packed real FFT needs at least a 4 point complex FFT, the frame
+        // must fill the FFT (it is truncated to fft_length, never zero padded)
+        if (version < 3 || fft_length < 8 || fft_length > CONFIG_DSP_MAX_FFT_SIZE ||
+            (fft_length & (fft_length - 1)) != 0 || frame_length_values < fft_length ||
+            frame_stride_values == 0 || frame_stride_values > frame_length_values) {
+            ei_printf("ERR: Fixed-point MFE does not support these parameters\n");
+            return nullptr;
+        }
+
+        const feature::mel_filterbank_t *fb = feature::get_mel_filterbank(
+            sampling_frequency, num_filters, fft_length, low_frequency, high_frequency, version);
+        if (!fb) {
+            return nullptr;
+        }
+
+        const size_t half = fft_length / 2;
+        size_t total_weights = 0;
+        for (size_t i = 0; i < num_filters; i++) {
+            total_weights += fb->length[i];
+        }
+
+        st->weights = (uint16_t*)ei_malloc(total_weights * sizeof(uint16_t));
+        st->fft_buffer = (int16_t*)ei_aligned_calloc(16, fft_length * sizeof(int16_t));
+        st->split_twiddles = (int16_t*)ei_malloc((fft_length / 4 + 1) * 2 * sizeof(int16_t));
+        st->power = (uint32_t*)ei_malloc((half + 1) * sizeof(uint32_t));
+        st->levels = (uint16_t*)ei_malloc(num_filters * sizeof(uint16_t));
+        st->pending = (int32_t*)ei_malloc(frame_length_values * sizeof(int32_t));
+        if (!st->weights || !st->fft_buffer || !st->split_twiddles ||
+            !st->power || !st->levels || !st->pending) {
+            free_state(st);
+            return nullptr;
+        }
+
+        for (size_t i = 0; i < total_weights; i++) {
+            st->weights[i] = (uint16_t)lrintf(fb->weights[i] * 32768.0f);
+        }
+
+        if (!init_fft(half)) {
+            ei_printf("ERR: Failed to initialize the sc16 FFT\n");
+            free_state(st);
+            return nullptr;
+        }
+
+        const float e = 2.0f * (float)M_PI / (float)fft_length;
+        for (size_t k = 0; k <= fft_length / 4; k++) {
+            st->split_twiddles[k * 2 + 0] = (int16_t)lrintf(32767.0f * cosf(k * e));
+            st->split_twiddles[k * 2 + 1] = (int16_t)lrintf(32767.0f * sinf(k * e));
+        }
+
+        // mfe_normalization: f = (10 * log10(e) - noise_floor_db) / (12 - noise_floor_db)
+        // level = round(f * 256) = log2(e) * a + b, with e = E * 2^-energy_exp
+        // the fixed point mel energy E (see frame_levels())
+        const double range = 12.0 - (double)noise_floor_db;
+        const double a = 10.0 * log10(2.0) * 256.0 / range;
+        const double b = -(double)noise_floor_db * 256.0 / range;
+        st->level_scale = (int64_t)llround(a * 65536.0);
+        st->level_offset = (int64_t)llround(b * 4294967296.0);
+
+        st->sampling_frequency = sampling_frequency;
+        st->frame_length = frame_length_values;
+        st->frame_stride = frame_stride_values;
+        st->fft_length = fft_length;
+        st->num_filters = num_filters;
+        st->noise_floor_db = noise_floor_db;
+        st->filterbank = fb;
+        st->pending_count = 0;
+        return st;
+    }
+
+    /**
+     * Number of frames the next `length` samples complete
+     */
+    static size_t frames_in_slice(const mfe_q15_state_t *st, size_t length) {
+        const size_t available = st->pending_count + length;
+        if (available < st->frame_length) {
+            return 0;
+        }
+        return (available - st->frame_length) / st->frame_stride + 1;
+    }
+
+    /**
+     * Preemphasize and frame one slice of audio, continuing the frames of the
+     * previous slice. Calls write_row(row, levels) for every completed frame,
+     * levels holds num_filters values in 0..256.
+     *
+     * Like the float continuous path, the first sample of every slice is
+     * preemphasized against the last sample of the same slice.
+     */
+    template<typename RowWriter>
+    static int slice(mfe_q15_state_t *st, const int16_t *samples, size_t length, RowWriter write_row) {
+        if (length == 0) {
+            EIDSP_ERR(EIDSP_PARAMETER_INVALID);
+        }
+
+        const size_t frame_length = st->frame_length;
+        const size_t stride = st->frame_stride;
+        const size_t n_fft = st->fft_length;
+        const size_t pending_count = st->pending_count;
+        const size_t available = pending_count + length;
+        const int32_t *pending = st->pending;
+
+        // preemphasized sample at stream position ix (relative to the pending samples), Q4
+        auto preemphasized = [&](size_t ix) -> int32_t {
+            if (ix < pending_count) {
+                return pending[ix];
+            }
+            ix -= pending_count;
+            const int32_t prev = samples[ix > 0 ? ix - 1 : length - 1];
+            return (((int32_t)samples[ix] << 15) - EIDSP_MFE_Q15_PREEMPHASIS_COF * prev) >>
+                (15 - EIDSP_MFE_Q15_PREEMPHASIS_FRAC);
+        };
+
+        size_t row = 0;
+        size_t start = 0;
+        for (; start + frame_length <= available; start += stride) {
+            int16_t *frame = st->fft_buffer;
+
+            // the FFT only sees the first n_fft samples of the frame (truncated, as in rfft)
+            int32_t peak = 0;
+            for (size_t n = 0; n < n_fft; n++) {
+                int32_t v = preemphasized(start + n);
+                int32_t a = v < 0 ? -v : v;
+                if (a > peak) {
+                    peak = a;
+                }
+            }
+
+            if (peak == 0) {
+                // silent frame: energy 0 maps below the noise floor
+                memset(st->levels, 0, st->num_filters * sizeof(uint16_t));
+            }
+            else {
+                // block floating point: scale the frame to EIDSP_MFE_Q15_FRAME_BITS bits
+                const int peak_bits = 32 - __builtin_clz((uint32_t)peak);
+                const int shift = peak_bits - EIDSP_MFE_Q15_FRAME_BITS;
+                for (size_t n = 0; n < n_fft; n++) {
+                    int32_t v = preemphasized(start + n);
+                    if (shift > 0) {
+                        v = (v + (1 << (shift - 1))) >> shift;
+                        if (v > 32767) {
+                            v = 32767;
+                        }
+                    }
+                    else {
+                        v <<= -shift;
+                    }
+                    frame[n] = (int16_t)v;
+                }
+                // frame = samples * 2^s
+                frame_levels(st, EIDSP_MFE_Q15_PREEMPHASIS_FRAC - shift);
+            }
+
+            write_row(row++, (const uint16_t*)st->levels);
+        }
+
+        // keep what the next frame needs
+        size_t keep = available - start;
+        if (start < pending_count) {
+            memmove(st->pending, st->pending + start, (pending_count - start) * sizeof(int32_t));
+            for (size_t ix = pending_count - start; ix < keep; ix++) {
+                st->pending[ix] = preemphasized(start + ix);
+            }
+        }
+        else {
+            for (size_t ix = 0; ix < keep; ix++) {
+                st->pending[ix] = preemphasized(start + ix);
+            }
+        }
+        st->pending_count = keep;
+
+        return EIDSP_OK;
+    }
+
+private:
+    /**
+     * The sc16 FFT uses one global twiddle table. Size it for this FFT instead of
+     * the default CONFIG_DSP_MAX_FFT_SIZE (8 KB); esp-dsp keeps the pointer, so
+     * the table is never freed.
+     */
+    static bool init_fft(size_t n_complex) {
+        if (dsps_fft2r_sc16_initialized) {
+            return dsps_fft_w_table_sc16_size >= (int)n_complex;
+        }
+        int16_t *table = (int16_t*)ei_aligned_calloc(16, n_complex * sizeof(int16_t));
+        if (!table) {
+            return false;
+        }
+        if (dsps_fft2r_init_sc16(table, n_complex) != ESP_OK) {
+            ei_aligned_free(table);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * log2(x) in Q16 for x > 0
+     */
+    static int32_t log2_q16(uint64_t x) {
+        static uint32_t table[EIDSP_MFE_Q15_LOG2_STEPS + 1] = { 0 };
+        if (table[EIDSP_MFE_Q15_LOG2_STEPS] == 0) {
+            for (int i = 0; i <= EIDSP_MFE_Q15_LOG2_STEPS; i++) {
+                table[i] = (uint32_t)lrint(log2(1.0 + (double)i / EIDSP_MFE_Q15_LOG2_STEPS) * 65536.0);
+            }
+        }
+
+        const int msb = 63 - __builtin_clzll(x);
+        // 32 bit mantissa with the leading one at bit 31
+        const uint32_t m = (uint32_t)(msb >= 31 ? x >> (msb - 31) : x << (31 - msb));
+        const uint32_t ix = (m >> 23) & (EIDSP_MFE_Q15_LOG2_STEPS - 1);
+        const uint32_t frac = (m >> 7) & 0xffff;
+        const uint32_t lo = table[ix];
+        const uint32_t hi = table[ix + 1];
+        return (int32_t)(((uint32_t)msb << 16) + lo + (((hi - lo) * frac) >> 16));
+    }
+
+    /**
+     * Levels of the frame in fft_buffer, which holds the first fft_length
+     * samples of the frame scaled by 2^frame_exp (sample units, 1.0 = 1 LSB).
+     *
+     * Scaling: the n/2 point sc16 FFT halves every stage, so Z = FFT(z) / (n/2),
+     * and the split step below yields X = FFT(frame) / n. With the frame holding
+     * the samples times 2^s, the float path's values are
+     *   spectrum   X_f = FFT(samples / 32768) = X * n * 2^(-15 - s)
+     *   power      P_f = |X_f|^2 / n = P * 2^(log2(n) - 30 - 2s)
+     *   mel energy e_f = sum(w_f * P_f) = E * 2^(log2(n) - 45 - 2s)   (w = w_f * 2^15)
+     */
+    static void frame_levels(mfe_q15_state_t *st, int frame_exp) {
+        const int half = st->fft_length / 2;
+        int16_t *z = st->fft_buffer;
+
+        // z[n] = x[2n] + j * x[2n + 1] is exactly the real frame in memory order
+        dsps_fft2r_sc16(z, half);
+        dsps_bit_rev_sc16_ansi(z, half);
+
+        // Split step, as in ei::fft::hw_r2c_fft:
+        //   2 * Fe[k] = Z[k] + conj(Z[N/2 - k])
+        //   2 * Fo[k] = (Z[k] - conj(Z[N/2 - k])) / j
+        //   X[k] = Fe[k] + W^k * Fo[k], X[N/2 - k] = conj(Fe[k] - W^k * Fo[k])
+        // computed as X / 2 (of the halved Z), that is X[k] / n of the frame
+        uint32_t *power = st->power;
+        {
+            const int32_t r0 = z[0];
+            const int32_t i0 = z[1];
+            const int32_t dc = (r0 + i0 + 1) >> 1;
+            const int32_t nyq = (r0 - i0 + 1) >> 1;
+            power[0] = (uint32_t)(dc * dc);
+            power[half] = (uint32_t)(nyq * nyq);
+        }
+        const int16_t *w = st->split_twiddles;
+        for (int k = 1; k <= half / 2; k++) {
+            const int32_t ar = z[2 * k];
+            const int32_t ai = z[2 * k + 1];
+            const int32_t br = z[2 * (half - k)];
+            const int32_t bi = z[2 * (half - k) + 1];
+
+            const int32_t fe_r = ar + br;
+            const int32_t fe_i = ai - bi;
+            const int32_t fo_r = ai + bi;
+            const int32_t fo_i = br - ar;
+
+            const int64_t c = w[2 * k];
+            const int64_t s = w[2 * k + 1];
+            const int32_t t_r = (int32_t)((c * fo_r + s * fo_i + (1 << 14)) >> 15);
+            const int32_t t_i = (int32_t)((c * fo_i - s * fo_r + (1 << 14)) >> 15);
+
+            const int32_t xr_lo = (fe_r + t_r + 2) >> 2;
+            const int32_t xi_lo = (fe_i + t_i + 2) >> 2;
+            const int32_t xr_hi = (fe_r - t_r + 2) >> 2;
+            const int32_t xi_hi = (t_i - fe_i + 2) >> 2;
+
+            power[k] = (uint32_t)(xr_lo * xr_lo) + (uint32_t)(xi_lo * xi_lo);
+            power[half - k] = (uint32_t)(xr_hi * xr_hi) + (uint32_t)(xi_hi * xi_hi);
+        }
+
+        // e_f = E * 2^-energy_exp
+        const int log2_n = 31 - __builtin_clz((uint32_t)st->fft_length);
+        const int32_t energy_exp = 45 - log2_n + 2 * frame_exp;
+        const int64_t offset = st->level_offset - (int64_t)energy_exp * 65536 * st->level_scale;
+
+        const feature::mel_filterbank_t *fb = st->filterbank;
+        for (size_t i = 0; i < st->num_filters; i++) {
+            const uint16_t *wq = st->weights + fb->offset[i];
+            const uint32_t *p = power + fb->start[i];
+            uint64_t energy = 0;
+            for (size_t k = 0; k < fb->length[i]; k++) {
+                energy += (uint64_t)wq[k] * p[k];
+            }
+
+            int64_t level = 0;
+            if (energy > 0) {
+                level = ((int64_t)log2_q16(energy) * st->level_scale + offset + ((int64_t)1 << 31)) >> 32;
+                if (level < 0) {
+                    level = 0;
+                }
+                else if (level > EIDSP_MFE_Q15_LEVELS) {
+                    level = EIDSP_MFE_Q15_LEVELS;
+                }
+            }
+            st->levels[i] = (uint16_t)level;
+        }
+    }
+};
+
+} // namespace speechpy
+} // namespace ei
+
+#endif // EIDSP_USE_ESP_DSP
+
+#endif // _EIDSP_SPEECHPY_FEATURE_Q15_H_
@@ -19,7 +19,7 @@
 #ifdef CONFIG_IDF_TARGET_ESP32P4
 #define ARCH_ESP32_P4 1
 #endif
-#ifdef CONFIG_IDF_TARGET_ESP32S3
+#if defined(CONFIG_IDF_TARGET_ESP32S3) || EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3
 #define ARCH_ESP32_S3 1
 #endif
 #ifdef CONFIG_IDF_TARGET_ESP32
@@ -34,7 +34,8 @@ extern "C" {
 /* reference kernels included by default */
 #include "esp_nn_ansi_headers.h"
 
-#if defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN)
+/* EI_CLASSIFIER_TFLITE_ESP_NN_ANSI keeps the ESP-NN kernels but forces the ANSI C versions (for comparison) */
+#if defined(EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN) && !EI_CLASSIFIER_TFLITE_ESP_NN_ANSI
 #if defined(ARCH_ESP32_P4)
 #include "esp_nn_esp32p4.h"
 #elif defined(ARCH_ESP32_S3)
@@ -176,6 +176,26 @@ void esp_nn_avg_pool_s8_ansi(const int8_t *input,
                              const int32_t activation_max,
                              const uint16_t channels);
 
+/**
+ * @brief       mean over height and width (global average pool), per channel
+ *
+ * @note        inputs type: int8_t, output: int8_t, one value per channel
+ *              input offset: although int32_t, it is contained in 8 bits [-128, 127]
+ *              out_scale: input_scale / output_scale. Each channel is requantized once,
+ *              with the same float expression as the TFLM reference mean, so the
+ *              output is bit-identical to it.
+ *              sums: scratch of `channels` int32_t. input_wd * input_ht must be > 0.
+ */
+void esp_nn_mean_hw_s8_ansi(const int8_t *input,
+                            const uint16_t input_wd,
+                            const uint16_t input_ht,
+                            const uint16_t channels,
+                            const int32_t input_offset,
+                            const float out_scale,
+                            const int32_t out_offset,
+                            int32_t *sums,
+                            int8_t *output);
+
 
 /************************** Fully connected functions ***********************/
 
@@ -307,3 +327,18 @@ void esp_nn_softmax_s8_opt(const int8_t *input_data,
                            const int32_t shift,
                            const int32_t diff_min,
                            int8_t *output_data);
+
+/**
+ * @brief       optimised version of mean over height and width
+ *
+ * @note        same parameters and output as esp_nn_mean_hw_s8_ansi
+ */
+void esp_nn_mean_hw_s8_opt(const int8_t *input,
+                           const uint16_t input_wd,
+                           const uint16_t input_ht,
+                           const uint16_t channels,
+                           const int32_t input_offset,
+                           const float out_scale,
+                           const int32_t out_offset,
+                           int32_t *sums,
+                           int8_t *output);
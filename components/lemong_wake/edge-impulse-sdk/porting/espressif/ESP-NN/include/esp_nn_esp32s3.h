@@ -223,6 +223,7 @@ void esp_nn_relu6_s8_esp32s3(int8_t *data, uint16_t size);
 
 #define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_esp32s3
 #define esp_nn_max_pool_s8 esp_nn_max_pool_s8_esp32s3
+#define esp_nn_mean_hw_s8 esp_nn_mean_hw_s8_opt
 
 #define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_esp32s3
 
@@ -39,6 +39,7 @@
 
 #define esp_nn_avg_pool_s8 esp_nn_avg_pool_s8_ansi
 #define esp_nn_max_pool_s8 esp_nn_max_pool_s8_ansi
+#define esp_nn_mean_hw_s8 esp_nn_mean_hw_s8_opt
 
 #define esp_nn_fully_connected_s8 esp_nn_fully_connected_s8_ansi
 
@@ -0,0 +1,52 @@
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN
+// Copyright 2020-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <math.h>
+
+void esp_nn_mean_hw_s8_ansi(const int8_t *input,
+                            const uint16_t input_wd,
+                            const uint16_t input_ht,
+                            const uint16_t channels,
+                            const int32_t input_offset,
+                            const float out_scale,
+                            const int32_t out_offset,
+                            int32_t *sums,
+                            int8_t *output)
+{
+    const int32_t num_elements = input_wd * input_ht;
+
+    for (int32_t ch_idx = 0; ch_idx < channels; ch_idx++) {
+        sums[ch_idx] = 0;
+    }
+    for (int32_t i = 0; i < num_elements; i++) {
+        for (int32_t ch_idx = 0; ch_idx < channels; ch_idx++) {
+            sums[ch_idx] += input[i * channels + ch_idx];
+        }
+    }
+
+    /* Same float requantization as the TFLM reference (QuantizedMeanOrSum) */
+    const float bias = input_offset * out_scale;
+    for (int32_t ch_idx = 0; ch_idx < channels; ch_idx++) {
+        float mean = (float) sums[ch_idx] / (float) num_elements;
+        float result = roundf(mean * out_scale + bias) + out_offset;
+        result = result < -128.0f ? -128.0f : result;
+        result = result > 127.0f ? 127.0f : result;
+        output[ch_idx] = (int8_t) result;
+    }
+}
+
+#endif // EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN
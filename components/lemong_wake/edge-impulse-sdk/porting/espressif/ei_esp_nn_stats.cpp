@@ -0,0 +1,95 @@
+#include "../ei_classifier_porting.h"
+#if EI_PORTING_ESPRESSIF == 1
+
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
+#include "ei_esp_nn_stats.h"
+
+#include <string.h>
+
+static ei_esp_nn_op_stats_t esp_nn_stats[EI_ESP_NN_OP_COUNT];
+
+static int8_t *verify_buffer = nullptr;
+static size_t verify_buffer_size = 0;
+
+void ei_esp_nn_stats_add_time(ei_esp_nn_op_t op, int64_t time_us)
+{
+    esp_nn_stats[op].calls++;
+    esp_nn_stats[op].total_us += time_us;
+}
+
+void ei_esp_nn_stats_verify(ei_esp_nn_op_t op, const int8_t *expected, const int8_t *actual, size_t len)
+{
+    ei_esp_nn_op_stats_t *stats = &esp_nn_stats[op];
+    stats->verified++;
+
+    if (memcmp(expected, actual, len) == 0) {
+        return;
+    }
+
+    size_t first = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (expected[i] != actual[i]) {
+            if (count == 0) {
+                first = i;
+            }
+            count++;
+        }
+    }
+
+    // only report the first mismatching call per op, the counter keeps the rest
+    if (stats->mismatches == 0) {
+        ei_printf("ESP-NN %s (call %u): %u of %u outputs differ from reference, first at %u (ref %d, esp-nn %d)\n",
+            ei_esp_nn_op_name(op), (unsigned)stats->calls, (unsigned)count, (unsigned)len,
+            (unsigned)first, expected[first], actual[first]);
+    }
+    stats->mismatches++;
+}
+
+int8_t *ei_esp_nn_verify_buffer(size_t len)
+{
+    if (len > verify_buffer_size) {
+        ei_free(verify_buffer);
+        verify_buffer = (int8_t *)ei_malloc(len);
+        verify_buffer_size = verify_buffer ? len : 0;
+    }
+    return verify_buffer;
+}
+
+const ei_esp_nn_op_stats_t *ei_esp_nn_get_stats(ei_esp_nn_op_t op)
+{
+    return &esp_nn_stats[op];
+}
+
+const char *ei_esp_nn_op_name(ei_esp_nn_op_t op)
+{
+    switch (op) {
+        case EI_ESP_NN_OP_CONV_2D: return "CONV_2D";
+        case EI_ESP_NN_OP_DEPTHWISE_CONV_2D: return "DEPTHWISE_CONV_2D";
+        case EI_ESP_NN_OP_FULLY_CONNECTED: return "FULLY_CONNECTED";
+        case EI_ESP_NN_OP_MEAN: return "MEAN";
+        default: return "UNKNOWN";
+    }
+}
+
+const char *ei_esp_nn_kernel_name(void)
+{
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1
+#if EI_CLASSIFIER_TFLITE_ESP_NN_ANSI
+    return "ansi";
+#elif EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN_S3
+    return "esp32s3";
+#else
+    return "generic";
+#endif
+#else
+    return "reference";
+#endif
+}
+
+void ei_esp_nn_reset_stats(void)
+{
+    memset(esp_nn_stats, 0, sizeof(esp_nn_stats));
+}
+
+#endif // EI_PORTING_ESPRESSIF == 1
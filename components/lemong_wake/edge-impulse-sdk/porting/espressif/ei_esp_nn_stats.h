@@ -0,0 +1,67 @@
+/*
+ * Per-op timing and bit-exactness counters for the ESP-NN int8 kernels
+ * (CONV_2D, DEPTHWISE_CONV_2D, FULLY_CONNECTED, MEAN).
+ *
+ * The kernels in tensorflow/lite/micro/kernels record their Eval() time here
+ * when built with EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN=1. When additionally built
+ * with EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY=1, every call is recomputed with the
+ * TFLM reference kernel and the two outputs are compared byte by byte.
+ */
+
+#ifndef EI_ESP_NN_STATS_H
+#define EI_ESP_NN_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    EI_ESP_NN_OP_CONV_2D = 0,
+    EI_ESP_NN_OP_DEPTHWISE_CONV_2D,
+    EI_ESP_NN_OP_FULLY_CONNECTED,
+    EI_ESP_NN_OP_MEAN,
+    EI_ESP_NN_OP_COUNT
+} ei_esp_nn_op_t;
+
+typedef struct {
+    uint32_t calls;       // number of Eval() calls
+    int64_t total_us;     // accumulated Eval() time, verification excluded
+    uint32_t verified;    // calls compared against the reference kernel
+    uint32_t mismatches;  // calls whose output differed from the reference
+} ei_esp_nn_op_stats_t;
+
+/**
+ * Record one Eval() call of an op
+ */
+void ei_esp_nn_stats_add_time(ei_esp_nn_op_t op, int64_t time_us);
+
+/**
+ * Compare the ESP-NN output of one Eval() call with the reference output
+ */
+void ei_esp_nn_stats_verify(ei_esp_nn_op_t op, const int8_t *expected, const int8_t *actual, size_t len);
+
+/**
+ * Scratch output for the reference kernel in verify builds.
+ * Grows to the largest op output and is kept, so there is no malloc per op.
+ */
+int8_t *ei_esp_nn_verify_buffer(size_t len);
+
+const ei_esp_nn_op_stats_t *ei_esp_nn_get_stats(ei_esp_nn_op_t op);
+
+const char *ei_esp_nn_op_name(ei_esp_nn_op_t op);
+
+/**
+ * Kernel set compiled into this build: "esp32s3", "ansi" or "reference"
+ */
+const char *ei_esp_nn_kernel_name(void);
+
+void ei_esp_nn_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EI_ESP_NN_STATS_H
@@ -0,0 +1,108 @@
+#include "../ei_classifier_porting.h"
+#if EI_PORTING_ESPRESSIF == 1 && EI_CLASSIFIER_OP_PROFILE == 1
+
+#include "ei_op_profile.h"
+#include "esp_cpu.h"
+
+#include <string.h>
+
+static ei_op_profile_t running;
+static ei_op_profile_t completed;
+static bool have_completed = false;
+static uint32_t windows = 0;
+
+// cycles of the inference in progress, merged into the window only when it completes
+static uint32_t pending_cycles[EI_OP_PROFILE_MAX_OPS];
+static size_t pending_count = 0;
+
+static uint8_t copy_shape(uint16_t *shape, const int *dims, int count)
+{
+    if (count > EI_OP_PROFILE_MAX_DIMS) {
+        count = EI_OP_PROFILE_MAX_DIMS;
+    }
+    for (int i = 0; i < count; i++) {
+        shape[i] = (uint16_t)dims[i];
+    }
+    return (uint8_t)count;
+}
+
+uint32_t ei_op_profile_now(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+
+void ei_op_profile_record(size_t index, const char *op,
+                          const int *input_dims, int input_count,
+                          const int *output_dims, int output_count,
+                          uint32_t cycles)
+{
+    if (index >= EI_OP_PROFILE_MAX_OPS) {
+        return;
+    }
+    if (index == 0) {
+        pending_count = 0;
+    }
+
+    // op type and shapes are fixed for a compiled model, take them on the first inference
+    ei_op_profile_entry_t *entry = &running.ops[index];
+    if (running.inferences == 0) {
+        entry->op = op;
+        entry->input_dims = copy_shape(entry->input_shape, input_dims, input_count);
+        entry->output_dims = copy_shape(entry->output_shape, output_dims, output_count);
+    }
+    pending_cycles[index] = cycles;
+    pending_count = index + 1;
+}
+
+void ei_op_profile_end_inference(void)
+{
+    if (pending_count == 0) {
+        return;
+    }
+
+    uint32_t total = 0;
+    bool first = running.inferences == 0;
+    for (size_t i = 0; i < pending_count; i++) {
+        ei_op_profile_entry_t *entry = &running.ops[i];
+        uint32_t cycles = pending_cycles[i];
+        if (first || cycles < entry->min_cycles) {
+            entry->min_cycles = cycles;
+        }
+        if (first || cycles > entry->max_cycles) {
+            entry->max_cycles = cycles;
+        }
+        entry->total_cycles += cycles;
+        total += cycles;
+    }
+    if (first || total < running.min_cycles) {
+        running.min_cycles = total;
+    }
+    if (first || total > running.max_cycles) {
+        running.max_cycles = total;
+    }
+    running.total_cycles += total;
+    running.op_count = pending_count;
+    running.inferences++;
+    pending_count = 0;
+
+    if (running.inferences >= EI_CLASSIFIER_OP_PROFILE_WINDOW) {
+        completed = running;
+        completed.window = ++windows;
+        have_completed = true;
+        memset(&running, 0, sizeof(running));
+    }
+}
+
+const ei_op_profile_t *ei_op_profile_get(void)
+{
+    return have_completed ? &completed : nullptr;
+}
+
+void ei_op_profile_reset(void)
+{
+    memset(&running, 0, sizeof(running));
+    have_completed = false;
+    pending_count = 0;
+}
+
+#endif // EI_PORTING_ESPRESSIF == 1 && EI_CLASSIFIER_OP_PROFILE == 1
@@ -0,0 +1,88 @@
+/*
+ * Per-operator CPU cycle profile of the compiled (EON) model.
+ *
+ * When built with EI_CLASSIFIER_OP_PROFILE=1 the invoke loop of the compiled
+ * model reads the CPU cycle counter around every op and records it here by
+ * op index, together with the op type and the shapes of its first input and
+ * output. Cycles are aggregated (min / avg / max) over a window of
+ * EI_CLASSIFIER_OP_PROFILE_WINDOW inferences; each completed window replaces
+ * the previous one, so a query always sees a full window.
+ *
+ * Cycles are counted on the core running the inference and include any
+ * preemption by higher priority tasks on that core: min is the best estimate
+ * of the kernel cost, max shows interference.
+ */
+
+#ifndef EI_OP_PROFILE_H
+#define EI_OP_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef EI_CLASSIFIER_OP_PROFILE_WINDOW
+#define EI_CLASSIFIER_OP_PROFILE_WINDOW 100
+#endif
+
+#define EI_OP_PROFILE_MAX_OPS   64
+#define EI_OP_PROFILE_MAX_DIMS  4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *op;                                 // builtin op name, e.g. "CONV_2D"
+    uint8_t input_dims;
+    uint8_t output_dims;
+    uint16_t input_shape[EI_OP_PROFILE_MAX_DIMS];   // first input tensor
+    uint16_t output_shape[EI_OP_PROFILE_MAX_DIMS];  // first output tensor
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+} ei_op_profile_entry_t;
+
+typedef struct {
+    uint32_t window;                                // sequence number of the window, from 1
+    uint32_t inferences;                            // inferences in the window
+    size_t op_count;                                // ops per inference
+    uint32_t min_cycles;                            // whole invoke, sum of the op cycles
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    ei_op_profile_entry_t ops[EI_OP_PROFILE_MAX_OPS];
+} ei_op_profile_t;
+
+/**
+ * CPU cycle counter of the calling core
+ */
+uint32_t ei_op_profile_now(void);
+
+/**
+ * Record one op of the running inference. Ops past EI_OP_PROFILE_MAX_OPS are not profiled.
+ * dims are TfLiteIntArray::data of the op's first input / output tensor.
+ */
+void ei_op_profile_record(size_t index, const char *op,
+                          const int *input_dims, int input_count,
+                          const int *output_dims, int output_count,
+                          uint32_t cycles);
+
+/**
+ * Close the running inference (call after the last op succeeded)
+ */
+void ei_op_profile_end_inference(void);
+
+/**
+ * Last completed window, or NULL before the first window completes.
+ * Must be called from the task that runs the inference.
+ */
+const ei_op_profile_t *ei_op_profile_get(void);
+
+/**
+ * Drop the running and the completed window (e.g. after a model reload)
+ */
+void ei_op_profile_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EI_OP_PROFILE_H
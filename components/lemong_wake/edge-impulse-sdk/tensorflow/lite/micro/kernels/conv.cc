@@ -1703,6 +1703,7 @@ limitations under the License.
 
 #if ESP_NN
 #include "edge-impulse-sdk/porting/espressif/ESP-NN/include/esp_nn.h"
+#include "edge-impulse-sdk/porting/espressif/ei_esp_nn_stats.h"
 #endif
 
 
@@ -1927,6 +1928,40 @@ inline void EvalQuantizedPerChannel(
         tflite::micro::GetTensorData<int8_t>(output));
   }
 }
+
+#if EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY
+// Recompute the op with the TFLM reference kernel and compare it byte by byte
+// with the ESP-NN output. Returns the time spent, so it can be excluded from
+// the op timing.
+long long VerifyQuantizedPerChannel(const TfLiteConvParams& params,
+                                    const NodeData& data,
+                                    const TfLiteEvalTensor* input,
+                                    const TfLiteEvalTensor* filter,
+                                    const TfLiteEvalTensor* bias,
+                                    const TfLiteEvalTensor* output) {
+  long long start_time = esp_timer_get_time();
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const size_t output_size = output_shape.FlatSize();
+  int8_t* expected = ei_esp_nn_verify_buffer(output_size);
+  if (expected != nullptr) {
+    reference_integer_ops::ConvPerChannel(
+        ConvParamsQuantized(params, data.op_data),
+        data.op_data.per_channel_output_multiplier,
+        data.op_data.per_channel_output_shift,
+        tflite::micro::GetTensorShape(input),
+        tflite::micro::GetTensorData<int8_t>(input),
+        tflite::micro::GetTensorShape(filter),
+        tflite::micro::GetTensorData<int8_t>(filter),
+        tflite::micro::GetTensorShape(bias),
+        tflite::micro::GetTensorData<int32_t>(bias),
+        output_shape, expected);
+    ei_esp_nn_stats_verify(EI_ESP_NN_OP_CONV_2D, expected,
+                           tflite::micro::GetTensorData<int8_t>(output),
+                           output_size);
+  }
+  return esp_timer_get_time() - start_time;
+}
+#endif
 #endif
 
 TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
@@ -1981,6 +2016,10 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
 #if ESP_NN
       EvalQuantizedPerChannel(context, node, params, data, input, filter,
                               bias, output);
+#if EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY
+      start_time += VerifyQuantizedPerChannel(params, data, input, filter,
+                                              bias, output);
+#endif
 #else
       reference_integer_ops::ConvPerChannel(
           ConvParamsQuantized(params, data.op_data),
@@ -2024,6 +2063,9 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   }
   long long time_this_instance = esp_timer_get_time() - start_time;
   conv_total_time += time_this_instance;
+#if ESP_NN
+  ei_esp_nn_stats_add_time(EI_ESP_NN_OP_CONV_2D, time_this_instance);
+#endif
   //printf("time this instance: %llu\n", time_this_instance / 1000);
   return kTfLiteOk;
 }
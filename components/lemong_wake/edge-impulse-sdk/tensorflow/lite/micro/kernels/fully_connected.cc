@@ -1420,6 +1420,7 @@ limitations under the License.
 
 #if ESP_NN
 #include "edge-impulse-sdk/porting/espressif/ESP-NN/include/esp_nn.h"
+#include "edge-impulse-sdk/porting/espressif/ei_esp_nn_stats.h"
 #endif
 
 #include <esp_timer.h>
@@ -1548,6 +1549,28 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
         input_data += accum_depth;
         output_data += output_depth;
       }
+#if EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY
+      {
+        // Recompute with the TFLM reference kernel and compare byte by byte,
+        // the time spent is excluded from the op timing
+        long long verify_start = esp_timer_get_time();
+        const size_t output_size = output_shape.FlatSize();
+        int8_t* expected = ei_esp_nn_verify_buffer(output_size);
+        if (expected != nullptr) {
+          tflite::reference_integer_ops::FullyConnected(
+              FullyConnectedParamsQuantized(data),
+              tflite::micro::GetTensorShape(input),
+              tflite::micro::GetTensorData<int8_t>(input),
+              filter_shape, filter_data,
+              tflite::micro::GetTensorShape(bias), bias_data,
+              output_shape, expected);
+          ei_esp_nn_stats_verify(EI_ESP_NN_OP_FULLY_CONNECTED, expected,
+                                 tflite::micro::GetTensorData<int8_t>(output),
+                                 output_size);
+        }
+        start_time += esp_timer_get_time() - verify_start;
+      }
+#endif
 #else
       tflite::reference_integer_ops::FullyConnected(
           FullyConnectedParamsQuantized(data),
@@ -1586,7 +1609,11 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
       return kTfLiteError;
     }
   }
-  fc_total_time += esp_timer_get_time() - start_time;
+  long long time_this_instance = esp_timer_get_time() - start_time;
+  fc_total_time += time_this_instance;
+#if ESP_NN
+  ei_esp_nn_stats_add_time(EI_ESP_NN_OP_FULLY_CONNECTED, time_this_instance);
+#endif
   return kTfLiteOk;
 }
 
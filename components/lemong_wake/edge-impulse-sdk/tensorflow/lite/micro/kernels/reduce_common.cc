@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include "edge-impulse-sdk/classifier/ei_classifier_config.h"
 #include "edge-impulse-sdk/tensorflow/lite/c/builtin_op_data.h"
 #include "edge-impulse-sdk/tensorflow/lite/c/common.h"
 #include "edge-impulse-sdk/tensorflow/lite/kernels/internal/quantization_util.h"
@@ -26,6 +27,13 @@ limitations under the License.
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_log.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_utils.h"
 
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1
+#include <esp_timer.h>
+
+#include "edge-impulse-sdk/porting/espressif/ESP-NN/include/esp_nn.h"
+#include "edge-impulse-sdk/porting/espressif/ei_esp_nn_stats.h"
+#endif
+
 namespace tflite {
 
 const int kMaxNumberOfAxis = 5;
@@ -132,6 +140,87 @@ void ResolveAxis(const int* axis_data, int axis_count,
   op_params->axis_count = axis_count;
 }
 
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1
+namespace {
+
+// int8 mean over H and W of an NHWC tensor without keep_dims (global average
+// pool) is what QuantizedMeanOrSum computes with its generic index walk. The
+// ESP-NN kernel sums each pixel's channels contiguously into int32 and
+// requantizes once per channel with the same float expression, so the output
+// is bit-identical to it.
+bool UseEspNnMean(const TfLiteEvalTensor* input, const OpDataReduce* op_data,
+                  bool keep_dims, bool axes_1_and_2) {
+  if (keep_dims || !axes_1_and_2 || input->type != kTfLiteInt8) {
+    return false;
+  }
+  // equal quantization takes reference_ops::Mean, which rounds differently
+  if (op_data->input_zp == op_data->output_zp &&
+      op_data->input_scale == op_data->output_scale) {
+    return false;
+  }
+  for (int i = 0; i < 4; i++) {
+    if (input->dims->data[i] <= 0 || input->dims->data[i] > UINT16_MAX) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void EvalMeanEspNn(TfLiteContext* context, const OpDataReduce* op_data,
+                   const TfLiteEvalTensor* input, TfLiteEvalTensor* output) {
+  const int batches = input->dims->data[0];
+  const int input_ht = input->dims->data[1];
+  const int input_wd = input->dims->data[2];
+  const int channels = input->dims->data[3];
+  const int input_size = input_ht * input_wd * channels;
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+  int32_t* sums = static_cast<int32_t*>(
+      context->GetScratchBuffer(context, op_data->temp_buffer_idx));
+  const float out_scale = op_data->input_scale / op_data->output_scale;
+
+  for (int i_batch = 0; i_batch < batches; i_batch++) {
+    esp_nn_mean_hw_s8(input_data + i_batch * input_size, input_wd, input_ht,
+                      channels, -op_data->input_zp, out_scale,
+                      op_data->output_zp, sums,
+                      output_data + i_batch * channels);
+  }
+}
+
+#if EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY
+// Recompute the op with the TFLM reference kernel and compare it byte by byte
+// with the ESP-NN output. Returns the time spent, so it can be excluded from
+// the op timing.
+long long VerifyMeanEspNn(TfLiteContext* context, const OpDataReduce* op_data,
+                          const TfLiteEvalTensor* input,
+                          const TfLiteEvalTensor* axis,
+                          const TfLiteEvalTensor* output) {
+  long long start_time = esp_timer_get_time();
+  const size_t output_size = ElementCount(*output->dims);
+  int8_t* expected = ei_esp_nn_verify_buffer(output_size);
+  if (expected != nullptr) {
+    int temp_index[kMaxNumberOfAxis];
+    int resolved_axis[kMaxNumberOfReducedAxis];
+    int32_t* temp_sum = static_cast<int32_t*>(
+        context->GetScratchBuffer(context, op_data->temp_buffer_idx));
+    reference_ops::QuantizedMeanOrSum(
+        tflite::micro::GetTensorData<int8_t>(input), op_data->input_zp,
+        op_data->input_scale, input->dims->data, input->dims->size, expected,
+        op_data->output_zp, op_data->output_scale, output->dims->data,
+        output->dims->size, tflite::micro::GetTensorData<int>(axis),
+        static_cast<int>(ElementCount(*axis->dims)), false, temp_index,
+        resolved_axis, temp_sum, false);
+    ei_esp_nn_stats_verify(EI_ESP_NN_OP_MEAN, expected,
+                           tflite::micro::GetTensorData<int8_t>(output),
+                           output_size);
+  }
+  return esp_timer_get_time() - start_time;
+}
+#endif
+
+}  // namespace
+#endif
+
 TfLiteStatus EvalMeanHelper(TfLiteContext* context, TfLiteNode* node,
                             OpDataReduce* op_data) {
   const TfLiteEvalTensor* input = tflite::micro::GetEvalInput(context, node, 0);
@@ -174,6 +263,19 @@ TfLiteStatus EvalMeanHelper(TfLiteContext* context, TfLiteNode* node,
       }
     } break;
     case kTfLiteInt8: {
+#if EI_CLASSIFIER_TFLITE_ENABLE_ESP_NN == 1
+      if (UseEspNnMean(input, op_data, params->keep_dims,
+                       special_case_4d_axes_1_and_2)) {
+        long long start_time = esp_timer_get_time();
+        EvalMeanEspNn(context, op_data, input, output);
+#if EI_CLASSIFIER_TFLITE_ESP_NN_VERIFY
+        start_time += VerifyMeanEspNn(context, op_data, input, axis, output);
+#endif
+        ei_esp_nn_stats_add_time(EI_ESP_NN_OP_MEAN,
+                                 esp_timer_get_time() - start_time);
+        break;
+      }
+#endif
       // Defer to specialized implementation for 4D Mean across axes 1 & 2.
       if (params->keep_dims && special_case_4d_axes_1_and_2) {
         reference_integer_ops::Mean(
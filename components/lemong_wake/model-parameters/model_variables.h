@@ -176,8 +176,8 @@ const ei_impulse_t impulse_829922_1 = {
 
     .sensor = EI_CLASSIFIER_SENSOR_MICROPHONE,
     .fusion_string = "audio",
-    .slice_size = (16000/4),
-    .slices_per_model_window = 4,
+    .slice_size = EI_CLASSIFIER_SLICE_SIZE,
+    .slices_per_model_window = EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW,
 
     .has_anomaly = EI_ANOMALY_TYPE_UNKNOWN,
     .label_count = 2,
@@ -36,6 +36,9 @@
 #include "edge-impulse-sdk/tensorflow/lite/c/common.h"
 #include "edge-impulse-sdk/tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "edge-impulse-sdk/porting/ei_classifier_porting.h"
+#if EI_CLASSIFIER_OP_PROFILE
+#include "edge-impulse-sdk/porting/espressif/ei_op_profile.h"
+#endif
 
 #if EI_CLASSIFIER_PRINT_STATE
 #if defined(__cplusplus) && EI_C_LINKAGE == 1
@@ -94,9 +97,9 @@ using namespace tflite::ops::micro;
 namespace {
 
 #if defined(EI_CLASSIFIER_ALLOCATION_STATIC_HIMAX) || defined(EI_CLASSIFIER_ALLOCATION_STATIC_HIMAX_GNU)
-constexpr int kTensorArenaSize = 34224;
+constexpr int kTensorArenaSize = 30800;
 #else
-constexpr int kTensorArenaSize = 33200;
+constexpr int kTensorArenaSize = 29776;
 #endif
 
 #if defined(EI_CLASSIFIER_ALLOCATION_STATIC)
@@ -124,8 +127,15 @@ template <int SZ, class T> struct TfArray {
 };
 
 enum used_operators_e {
-  OP_RESHAPE, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_PAD, OP_MEAN, OP_FULLY_CONNECTED, OP_SOFTMAX,  OP_LAST
+  OP_RESHAPE, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_MEAN, OP_FULLY_CONNECTED, OP_SOFTMAX,  OP_LAST
+};
+
+#if EI_CLASSIFIER_OP_PROFILE
+// names for the per-op profile, same order as used_operators_e
+static const char* const used_op_names[OP_LAST] = {
+  "RESHAPE", "CONV_2D", "DEPTHWISE_CONV_2D", "MEAN", "FULLY_CONNECTED", "SOFTMAX",
 };
+#endif
 
 struct TensorInfo_t { // subset of TfLiteTensor used for initialization from constant memory
   TfLiteAllocationType allocation_type;
@@ -1223,10 +1233,8 @@ const TfArray<1, int> outputs2 = { 1, { 64 } };
 const TfLiteConvParams opdata3 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs3 = { 3, { 64,57,56 } };
 const TfArray<1, int> outputs3 = { 1, { 65 } };
-const TfArray<2, int> inputs4 = { 2, { 65,2 } };
-const TfArray<1, int> outputs4 = { 1, { 66 } };
 const TfLiteDepthwiseConvParams opdata5 = { kTfLitePaddingValid, 2,2, 1, kTfLiteActRelu6, 1,1 };
-const TfArray<3, int> inputs5 = { 3, { 66,55,54 } };
+const TfArray<3, int> inputs5 = { 3, { 65,55,54 } };
 const TfArray<1, int> outputs5 = { 1, { 67 } };
 const TfLiteConvParams opdata6 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs6 = { 3, { 67,53,52 } };
@@ -1237,10 +1245,8 @@ const TfArray<1, int> outputs7 = { 1, { 69 } };
 const TfLiteConvParams opdata8 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs8 = { 3, { 69,49,48 } };
 const TfArray<1, int> outputs8 = { 1, { 70 } };
-const TfArray<2, int> inputs9 = { 2, { 70,2 } };
-const TfArray<1, int> outputs9 = { 1, { 71 } };
 const TfLiteDepthwiseConvParams opdata10 = { kTfLitePaddingValid, 2,2, 1, kTfLiteActRelu6, 1,1 };
-const TfArray<3, int> inputs10 = { 3, { 71,47,46 } };
+const TfArray<3, int> inputs10 = { 3, { 70,47,46 } };
 const TfArray<1, int> outputs10 = { 1, { 72 } };
 const TfLiteConvParams opdata11 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs11 = { 3, { 72,45,44 } };
@@ -1251,10 +1257,8 @@ const TfArray<1, int> outputs12 = { 1, { 74 } };
 const TfLiteConvParams opdata13 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs13 = { 3, { 74,41,40 } };
 const TfArray<1, int> outputs13 = { 1, { 75 } };
-const TfArray<2, int> inputs14 = { 2, { 75,2 } };
-const TfArray<1, int> outputs14 = { 1, { 76 } };
 const TfLiteDepthwiseConvParams opdata15 = { kTfLitePaddingValid, 2,2, 1, kTfLiteActRelu6, 1,1 };
-const TfArray<3, int> inputs15 = { 3, { 76,39,38 } };
+const TfArray<3, int> inputs15 = { 3, { 75,39,38 } };
 const TfArray<1, int> outputs15 = { 1, { 77 } };
 const TfLiteConvParams opdata16 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs16 = { 3, { 77,37,36 } };
@@ -1289,10 +1293,8 @@ const TfArray<1, int> outputs25 = { 1, { 87 } };
 const TfLiteConvParams opdata26 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs26 = { 3, { 87,17,16 } };
 const TfArray<1, int> outputs26 = { 1, { 88 } };
-const TfArray<2, int> inputs27 = { 2, { 88,2 } };
-const TfArray<1, int> outputs27 = { 1, { 89 } };
 const TfLiteDepthwiseConvParams opdata28 = { kTfLitePaddingValid, 2,2, 1, kTfLiteActRelu6, 1,1 };
-const TfArray<3, int> inputs28 = { 3, { 89,15,14 } };
+const TfArray<3, int> inputs28 = { 3, { 88,15,14 } };
 const TfArray<1, int> outputs28 = { 1, { 90 } };
 const TfLiteConvParams opdata29 = { kTfLitePaddingSame, 1,1, kTfLiteActRelu6, 1,1 };
 const TfArray<3, int> inputs29 = { 3, { 90,13,12 } };
@@ -1383,19 +1385,19 @@ TensorInfo_t tensorData[] = {
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension62, 3960, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant0))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 3968), (TfLiteIntArray*)&g0::tensor_dimension63, 3000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant63))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension63, 3000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 6432), (TfLiteIntArray*)&g0::tensor_dimension65, 6000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 3008), (TfLiteIntArray*)&g0::tensor_dimension65, 6000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension66, 6426, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 6432), (TfLiteIntArray*)&g0::tensor_dimension67, 1500, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension67, 1500, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 3008), (TfLiteIntArray*)&g0::tensor_dimension68, 3000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension68, 3000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 3440), (TfLiteIntArray*)&g0::tensor_dimension68, 3000, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension71, 3432, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 3440), (TfLiteIntArray*)&g0::tensor_dimension72, 720, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension72, 720, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 1504), (TfLiteIntArray*)&g0::tensor_dimension73, 1500, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension73, 1500, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 1952), (TfLiteIntArray*)&g0::tensor_dimension73, 1500, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension76, 1950, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
-{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 2416), (TfLiteIntArray*)&g0::tensor_dimension77, 300, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
+{ kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension77, 300, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 928), (TfLiteIntArray*)&g0::tensor_dimension78, 612, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant78))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 1552), (TfLiteIntArray*)&g0::tensor_dimension78, 612, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 928), (TfLiteIntArray*)&g0::tensor_dimension78, 612, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant64))}, },
@@ -1418,23 +1420,31 @@ TensorInfo_t tensorData[] = {
 { kTfLiteArenaRw, kTfLiteInt8, (int32_t*)(tensor_arena + 0), (TfLiteIntArray*)&g0::tensor_dimension96, 2, {kTfLiteAffineQuantization, const_cast<void*>(static_cast<const void*>(&g0::quant97))}, },
 };
 
+// The exported graph had a PAD (bottom / right by one, zero point) in front of
+// the VALID depthwise convolutions at nodes 5, 10, 15 and 28. The PADs are
+// folded into those convolutions: they read the unpadded tensor directly
+// (inputs5, inputs10, inputs15, inputs28) and every depthwise kernel
+// (reference, ESP-NN ansi and esp32s3) skips taps outside the input, which
+// contribute exactly what zero-point padding does. Output dims come from the
+// output tensors, so the results are bit-identical. Tensor 2 (the paddings)
+// and tensors 66, 71, 76 and 89 (the padded copies) are kept only so tensor
+// indices do not shift; with the padded copies gone tensors 65, 67, 72 and 77
+// were moved and the activation peak dropped from 12432 to 9008 bytes
+// (kTensorArenaSize 33200 -> 29776).
 #ifndef TF_LITE_STATIC_MEMORY
-TfLiteNode tflNodes[36] = {
+TfLiteNode tflNodes[32] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs3, (TfLiteIntArray*)&g0::outputs3, (TfLiteIntArray*)&g0::inputs3, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata3)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs4, (TfLiteIntArray*)&g0::outputs4, (TfLiteIntArray*)&g0::inputs4, nullptr, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs5, (TfLiteIntArray*)&g0::outputs5, (TfLiteIntArray*)&g0::inputs5, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata5)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs6, (TfLiteIntArray*)&g0::outputs6, (TfLiteIntArray*)&g0::inputs6, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata6)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs7, (TfLiteIntArray*)&g0::outputs7, (TfLiteIntArray*)&g0::inputs7, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata7)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs8, (TfLiteIntArray*)&g0::outputs8, (TfLiteIntArray*)&g0::inputs8, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata8)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs9, (TfLiteIntArray*)&g0::outputs9, (TfLiteIntArray*)&g0::inputs9, nullptr, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs10, (TfLiteIntArray*)&g0::outputs10, (TfLiteIntArray*)&g0::inputs10, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata10)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs11, (TfLiteIntArray*)&g0::outputs11, (TfLiteIntArray*)&g0::inputs11, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata11)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs12, (TfLiteIntArray*)&g0::outputs12, (TfLiteIntArray*)&g0::inputs12, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata12)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs13, (TfLiteIntArray*)&g0::outputs13, (TfLiteIntArray*)&g0::inputs13, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata13)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs14, (TfLiteIntArray*)&g0::outputs14, (TfLiteIntArray*)&g0::inputs14, nullptr, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs15, (TfLiteIntArray*)&g0::outputs15, (TfLiteIntArray*)&g0::inputs15, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata15)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs16, (TfLiteIntArray*)&g0::outputs16, (TfLiteIntArray*)&g0::inputs16, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata16)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs17, (TfLiteIntArray*)&g0::outputs17, (TfLiteIntArray*)&g0::inputs17, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata17)), nullptr, 0, },
@@ -1447,7 +1457,6 @@ TfLiteNode tflNodes[36] = {
 { (TfLiteIntArray*)&g0::inputs24, (TfLiteIntArray*)&g0::outputs24, (TfLiteIntArray*)&g0::inputs24, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata24)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs25, (TfLiteIntArray*)&g0::outputs25, (TfLiteIntArray*)&g0::inputs25, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata25)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs26, (TfLiteIntArray*)&g0::outputs26, (TfLiteIntArray*)&g0::inputs26, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata26)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs27, (TfLiteIntArray*)&g0::outputs27, (TfLiteIntArray*)&g0::inputs27, nullptr, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs28, (TfLiteIntArray*)&g0::outputs28, (TfLiteIntArray*)&g0::inputs28, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata28)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs29, (TfLiteIntArray*)&g0::outputs29, (TfLiteIntArray*)&g0::inputs29, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata29)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs30, (TfLiteIntArray*)&g0::outputs30, (TfLiteIntArray*)&g0::inputs30, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata30)), nullptr, 0, },
@@ -1458,22 +1467,19 @@ TfLiteNode tflNodes[36] = {
 { (TfLiteIntArray*)&g0::inputs35, (TfLiteIntArray*)&g0::outputs35, (TfLiteIntArray*)&g0::inputs35, nullptr, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata35)), nullptr, 0, },
 };
 #else
-TfLiteNode tflNodes[36] = {
+TfLiteNode tflNodes[32] = {
 { (TfLiteIntArray*)&g0::inputs0, (TfLiteIntArray*)&g0::outputs0, (TfLiteIntArray*)&g0::inputs0, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata0)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs1, (TfLiteIntArray*)&g0::outputs1, (TfLiteIntArray*)&g0::inputs1, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata1)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs2, (TfLiteIntArray*)&g0::outputs2, (TfLiteIntArray*)&g0::inputs2, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata2)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs3, (TfLiteIntArray*)&g0::outputs3, (TfLiteIntArray*)&g0::inputs3, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata3)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs4, (TfLiteIntArray*)&g0::outputs4, (TfLiteIntArray*)&g0::inputs4, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs5, (TfLiteIntArray*)&g0::outputs5, (TfLiteIntArray*)&g0::inputs5, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata5)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs6, (TfLiteIntArray*)&g0::outputs6, (TfLiteIntArray*)&g0::inputs6, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata6)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs7, (TfLiteIntArray*)&g0::outputs7, (TfLiteIntArray*)&g0::inputs7, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata7)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs8, (TfLiteIntArray*)&g0::outputs8, (TfLiteIntArray*)&g0::inputs8, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata8)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs9, (TfLiteIntArray*)&g0::outputs9, (TfLiteIntArray*)&g0::inputs9, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs10, (TfLiteIntArray*)&g0::outputs10, (TfLiteIntArray*)&g0::inputs10, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata10)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs11, (TfLiteIntArray*)&g0::outputs11, (TfLiteIntArray*)&g0::inputs11, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata11)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs12, (TfLiteIntArray*)&g0::outputs12, (TfLiteIntArray*)&g0::inputs12, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata12)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs13, (TfLiteIntArray*)&g0::outputs13, (TfLiteIntArray*)&g0::inputs13, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata13)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs14, (TfLiteIntArray*)&g0::outputs14, (TfLiteIntArray*)&g0::inputs14, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs15, (TfLiteIntArray*)&g0::outputs15, (TfLiteIntArray*)&g0::inputs15, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata15)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs16, (TfLiteIntArray*)&g0::outputs16, (TfLiteIntArray*)&g0::inputs16, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata16)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs17, (TfLiteIntArray*)&g0::outputs17, (TfLiteIntArray*)&g0::inputs17, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata17)), nullptr, 0, },
@@ -1486,7 +1492,6 @@ TfLiteNode tflNodes[36] = {
 { (TfLiteIntArray*)&g0::inputs24, (TfLiteIntArray*)&g0::outputs24, (TfLiteIntArray*)&g0::inputs24, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata24)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs25, (TfLiteIntArray*)&g0::outputs25, (TfLiteIntArray*)&g0::inputs25, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata25)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs26, (TfLiteIntArray*)&g0::outputs26, (TfLiteIntArray*)&g0::inputs26, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata26)), nullptr, 0, },
-{ (TfLiteIntArray*)&g0::inputs27, (TfLiteIntArray*)&g0::outputs27, (TfLiteIntArray*)&g0::inputs27, nullptr, nullptr, nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs28, (TfLiteIntArray*)&g0::outputs28, (TfLiteIntArray*)&g0::inputs28, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata28)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs29, (TfLiteIntArray*)&g0::outputs29, (TfLiteIntArray*)&g0::inputs29, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata29)), nullptr, 0, },
 { (TfLiteIntArray*)&g0::inputs30, (TfLiteIntArray*)&g0::outputs30, (TfLiteIntArray*)&g0::inputs30, nullptr, const_cast<void*>(static_cast<const void*>(&g0::opdata30)), nullptr, 0, },
@@ -1499,12 +1504,12 @@ TfLiteNode tflNodes[36] = {
 #endif
 
 used_operators_e used_ops[] =
-{OP_RESHAPE, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_PAD, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_PAD, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_PAD, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_PAD, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_MEAN, OP_FULLY_CONNECTED, OP_FULLY_CONNECTED, OP_SOFTMAX, };
+{OP_RESHAPE, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_DEPTHWISE_CONV_2D, OP_CONV_2D, OP_MEAN, OP_FULLY_CONNECTED, OP_FULLY_CONNECTED, OP_SOFTMAX, };
 
 
 // Indices into tflTensors and tflNodes for subgraphs
 const size_t tflTensors_subgraph_index[] = {0, 98, };
-const size_t tflNodes_subgraph_index[] = {0, 36, };
+const size_t tflNodes_subgraph_index[] = {0, 32, };
 
 // Input/output tensors
 static const int in_tensor_indices[] = {
@@ -1611,11 +1616,14 @@ static void * AllocatePersistentBufferImpl(struct TfLiteContext* ctx,
 
 typedef struct {
   size_t bytes;
+  size_t node;
+  size_t offset;
   void *ptr;
 } scratch_buffer_t;
 
 static scratch_buffer_t scratch_buffers[EI_MAX_SCRATCH_BUFFER_COUNT];
 static size_t scratch_buffers_ix = 0;
+static size_t scratch_node_ix = 0; // node being prepared
 
 static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, size_t bytes,
                                                 int* buffer_idx) {
@@ -1625,15 +1633,15 @@ static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, s
     return kTfLiteError;
   }
 
+  // Scratch buffers are only valid during the Eval of the op that requested them
+  // and ops are invoked one at a time, so only record the size here. All nodes
+  // share one region, sized to the largest node, see AllocateScratchBuffers().
+  // (ESP-NN requests one per CONV_2D / DEPTHWISE_CONV_2D, 27 in this model.)
   scratch_buffer_t b;
   b.bytes = bytes;
-
-  b.ptr = AllocatePersistentBufferImpl(ctx, b.bytes);
-  if (!b.ptr) {
-    ei_printf("ERR: Failed to allocate scratch buffer of size %d\n",
-      (int)bytes);
-    return kTfLiteError;
-  }
+  b.node = scratch_node_ix;
+  b.offset = 0;
+  b.ptr = nullptr;
 
   scratch_buffers[scratch_buffers_ix] = b;
   *buffer_idx = scratch_buffers_ix;
@@ -1643,8 +1651,41 @@ static TfLiteStatus RequestScratchBufferInArenaImpl(struct TfLiteContext* ctx, s
   return kTfLiteOk;
 }
 
+static TfLiteStatus AllocateScratchBuffers() {
+  // Requests from the same node (e.g. REDUCE's temp index and resolved axis)
+  // are live at the same time, so they are laid out one after the other;
+  // different nodes start again at offset 0.
+  size_t max_bytes = 0;
+  size_t node_bytes = 0;
+  for (size_t ix = 0; ix < scratch_buffers_ix; ix++) {
+    if (ix == 0 || scratch_buffers[ix].node != scratch_buffers[ix - 1].node) {
+      node_bytes = 0;
+    }
+    scratch_buffers[ix].offset = node_bytes;
+    node_bytes += (scratch_buffers[ix].bytes + 15) & ~(size_t)15;
+    if (node_bytes > max_bytes) {
+      max_bytes = node_bytes;
+    }
+  }
+  if (max_bytes == 0) {
+    return kTfLiteOk;
+  }
+
+  void *ptr = AllocatePersistentBufferImpl(nullptr, max_bytes);
+  if (!ptr) {
+    ei_printf("ERR: Failed to allocate scratch buffer of size %d\n",
+      (int)max_bytes);
+    return kTfLiteError;
+  }
+
+  for (size_t ix = 0; ix < scratch_buffers_ix; ix++) {
+    scratch_buffers[ix].ptr = (uint8_t *)ptr + scratch_buffers[ix].offset;
+  }
+  return kTfLiteOk;
+}
+
 static void* GetScratchBufferImpl(struct TfLiteContext* ctx, int buffer_idx) {
-  if (buffer_idx > (int)scratch_buffers_ix) {
+  if (buffer_idx < 0 || buffer_idx >= (int)scratch_buffers_ix) {
     return NULL;
   }
   return scratch_buffers[buffer_idx].ptr;
@@ -1791,7 +1832,6 @@ TfLiteStatus tflite_learn_829922_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
   registrations[OP_RESHAPE] = Register_RESHAPE();
   registrations[OP_CONV_2D] = Register_CONV_2D();
   registrations[OP_DEPTHWISE_CONV_2D] = Register_DEPTHWISE_CONV_2D();
-  registrations[OP_PAD] = Register_PAD();
   registrations[OP_MEAN] = Register_MEAN();
   registrations[OP_FULLY_CONNECTED] = Register_FULLY_CONNECTED();
   registrations[OP_SOFTMAX] = Register_SOFTMAX();
@@ -1811,6 +1851,7 @@ TfLiteStatus tflite_learn_829922_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
     for(size_t i = tflNodes_subgraph_index[g]; i < tflNodes_subgraph_index[g+1]; ++i) {
       if (registrations[used_ops[i]].prepare) {
         ResetTensors();
+        scratch_node_ix = i;
         TfLiteStatus status = registrations[used_ops[i]].prepare(&ctx, &tflNodes[i]);
         if (status != kTfLiteOk) {
           return status;
@@ -1820,7 +1861,7 @@ TfLiteStatus tflite_learn_829922_4_init( void*(*alloc_fnc)(size_t,size_t) ) {
   }
   current_subgraph_index = 0;
 
-  return kTfLiteOk;
+  return AllocateScratchBuffers();
 }
 
 TfLiteStatus tflite_learn_829922_4_input(int index, TfLiteTensor *tensor) {
@@ -1834,10 +1875,20 @@ TfLiteStatus tflite_learn_829922_4_output(int index, TfLiteTensor *tensor) {
 }
 
 TfLiteStatus tflite_learn_829922_4_invoke() {
-  for (size_t i = 0; i < 36; ++i) {
+  for (size_t i = 0; i < 32; ++i) {
     ResetTensors();
 
+#if EI_CLASSIFIER_OP_PROFILE
+    uint32_t op_start = ei_op_profile_now();
+#endif
     TfLiteStatus status = registrations[used_ops[i]].invoke(&ctx, &tflNodes[i]);
+#if EI_CLASSIFIER_OP_PROFILE
+    uint32_t op_cycles = ei_op_profile_now() - op_start;
+    const TfLiteIntArray* op_in = tensorData[tflNodes[i].inputs->data[0]].dims;
+    const TfLiteIntArray* op_out = tensorData[tflNodes[i].outputs->data[0]].dims;
+    ei_op_profile_record(i, used_op_names[used_ops[i]], op_in->data, op_in->size,
+                         op_out->data, op_out->size, op_cycles);
+#endif
 
 #if EI_CLASSIFIER_PRINT_STATE
     ei_printf("layer %lu\n", i);
@@ -1902,6 +1953,9 @@ TfLiteStatus tflite_learn_829922_4_invoke() {
       return status;
     }
   }
+#if EI_CLASSIFIER_OP_PROFILE
+  ei_op_profile_end_inference();
+#endif
   return kTfLiteOk;
 }
 
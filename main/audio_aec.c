@@ -0,0 +1,167 @@
+#include "audio_aec.h"
+#include "dsps_dotprod.h"
+#include "dsps_mulc.h"
+#include "dsps_add.h"
+#include <math.h>
+#include <string.h>
+
+#define AEC_FULL_SCALE          32768.0f
+#define AEC_MIN_ENERGY          1e-3f   // 數位靜音時避免除以 0
+#define AEC_SMOOTH              0.1f    // ERLE 的平滑係數（每區塊，約 100 ms）
+
+void audio_aec_default_config(audio_aec_config_t *config)
+{
+    config->taps = 256;
+    config->step = 0.2f;
+    config->ref_silence_dbfs = -60.0f;
+    config->dtd_ratio_db = 6.0f;
+    config->dtd_min_erle_db = 6.0f;
+    config->dtd_hangover_blocks = 3;
+    config->dtd_max_blocks = 150;
+}
+
+esp_err_t audio_aec_init(audio_aec_t *aec, const audio_aec_config_t *config)
+{
+    if (config->taps <= 0 || config->taps > AUDIO_AEC_MAX_TAPS || config->taps % 4 != 0 ||
+        config->step <= 0.0f || config->step >= 1.0f || config->dtd_ratio_db < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(aec, 0, sizeof(*aec));
+    aec->config = *config;
+    float silence = AEC_FULL_SCALE * powf(10.0f, config->ref_silence_dbfs / 20.0f);
+    aec->ref_silence = silence * silence;
+    aec->regularization = aec->ref_silence * config->taps;
+    audio_aec_reset(aec);
+    return ESP_OK;
+}
+
+void audio_aec_reset(audio_aec_t *aec)
+{
+    memset(aec->weights, 0, sizeof(aec->weights));
+    memset(aec->line, 0, sizeof(aec->line));
+    aec->pos = 0;
+    aec->ref_energy = 0.0f;
+    aec->zero_run = aec->config.taps;
+    aec->adapt = true;
+    aec->hangover = 0;
+    aec->freeze_run = 0;
+    aec->converged = false;
+    aec->erle_db = 0.0f;
+    aec->block_fill = 0;
+    aec->block_ref = 0.0f;
+    aec->block_mic = 0.0f;
+    aec->block_err = 0.0f;
+    memset(&aec->stats, 0, sizeof(aec->stats));
+}
+
+// 區塊結束：決定下一個區塊是否更新係數
+static void end_block(audio_aec_t *aec)
+{
+    const int taps = aec->config.taps;
+    const float *x = aec->line + aec->pos;
+    // 逐樣本加減的 Σx² 會累積誤差，每區塊重算一次
+    dsps_dotprod_f32(x, x, &aec->ref_energy, taps);
+
+    float ref = aec->block_ref / AUDIO_AEC_BLOCK;
+    float mic = aec->block_mic;
+    float err = fmaxf(aec->block_err, AEC_MIN_ENERGY);
+    aec->block_fill = 0;
+    aec->block_ref = 0.0f;
+    aec->block_mic = 0.0f;
+    aec->block_err = 0.0f;
+
+    if (ref < aec->ref_silence) {
+        // 沒有在播放：沒有回音可以學，也無從判斷雙講
+        aec->adapt = true;
+        aec->hangover = 0;
+        aec->freeze_run = 0;
+        return;
+    }
+    aec->stats.blocks++;
+
+    // 雙講：濾波器已收斂，這個區塊的 ERLE 卻比平常低了 dtd_ratio_db（近端語音只出現在殘差裡）
+    // 用比值而不是殘差能量，播放音量起伏不會被誤判
+    float erle_db = 10.0f * log10f(fmaxf(mic, AEC_MIN_ENERGY) / err);
+    bool near_end = aec->converged && aec->erle_db >= aec->config.dtd_min_erle_db &&
+                    erle_db < aec->erle_db - aec->config.dtd_ratio_db;
+    if (near_end) {
+        aec->hangover = aec->config.dtd_hangover_blocks;
+    } else if (aec->hangover > 0) {
+        aec->hangover--;
+    }
+
+    bool freeze = near_end || aec->hangover > 0;
+    if (freeze) {
+        aec->stats.double_talk_blocks++;
+        // 暫停太久多半是回音路徑變了（有人移動裝置），恢復更新讓濾波器重新收斂
+        if (++aec->freeze_run > aec->config.dtd_max_blocks) {
+            freeze = false;
+        }
+    } else {
+        aec->freeze_run = 0;
+    }
+
+    if (!freeze) {
+        if (!aec->converged) {
+            aec->erle_db = erle_db;
+            aec->converged = true;
+        } else {
+            aec->erle_db += (erle_db - aec->erle_db) * AEC_SMOOTH;
+        }
+        aec->stats.adapted_blocks++;
+    }
+    aec->adapt = !freeze;
+}
+
+void audio_aec_process(audio_aec_t *aec, int16_t *mic, const int16_t *ref, size_t length)
+{
+    const int taps = aec->config.taps;
+    const float step = aec->config.step;
+
+    for (size_t i = 0; i < length; i++) {
+        float x = ref[i];
+        // 延遲線全為 0 且參考仍是 0：回音估計為 0，麥克風原樣輸出
+        if (ref[i] == 0 && aec->zero_run >= (uint32_t)taps) {
+            continue;
+        }
+        aec->zero_run = ref[i] == 0 ? aec->zero_run + 1 : 0;
+
+        // 最新樣本在 pos，x(n-k) 在 pos + k
+        aec->pos = aec->pos == 0 ? taps - 1 : aec->pos - 1;
+        float oldest = aec->line[aec->pos];
+        aec->line[aec->pos] = x;
+        aec->line[aec->pos + taps] = x;
+        aec->ref_energy = fmaxf(aec->ref_energy + x * x - oldest * oldest, 0.0f);
+        const float *v = aec->line + aec->pos;
+
+        float echo;
+        dsps_dotprod_f32(aec->weights, v, &echo, taps);
+        float d = mic[i];
+        float e = d - echo;
+
+        // w += μ·e·x / (Σx² + δ)
+        if (aec->adapt) {
+            float g = step * e / (aec->ref_energy + aec->regularization);
+            dsps_mulc_f32(v, aec->scratch, taps, g, 1, 1);
+            dsps_add_f32(aec->weights, aec->scratch, aec->weights, taps, 1, 1, 1);
+        }
+
+        if (e > 32767.0f) e = 32767.0f;
+        if (e < -32768.0f) e = -32768.0f;
+        mic[i] = (int16_t)lrintf(e);
+
+        aec->block_ref += x * x;
+        aec->block_mic += d * d;
+        aec->block_err += e * e;
+        if (++aec->block_fill == AUDIO_AEC_BLOCK) {
+            end_block(aec);
+        }
+    }
+}
+
+void audio_aec_get_stats(const audio_aec_t *aec, audio_aec_stats_t *stats)
+{
+    *stats = aec->stats;
+    stats->erle_db = aec->erle_db;
+}
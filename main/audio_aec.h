@@ -0,0 +1,93 @@
+#ifndef AUDIO_AEC_H
+#define AUDIO_AEC_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 回音消除（NLMS）：以喇叭送出的訊號為參考，自適應 FIR 估計喇叭到麥克風的回音並從麥克風訊號減掉。
+// 每個樣本以 esp-dsp dsps_dotprod_f32 算回音估計，dsps_mulc_f32 + dsps_add_f32 更新係數。
+// 每 AUDIO_AEC_BLOCK 個樣本做一次雙講偵測：已收斂後區塊的回音消除量突然比平常低 dtd_ratio_db，
+// 表示殘差裡多了近端語音（例如播放中說喚醒詞），暫停更新，避免濾波器被語音帶偏。
+// 參考訊號長時間為 0（沒有播放）時直接略過，不花 CPU。
+
+#define AUDIO_AEC_MAX_TAPS      512
+#define AUDIO_AEC_BLOCK         160     // 雙講偵測與統計的區塊（10 ms）
+
+typedef struct {
+    int taps;                       // 濾波器長度（樣本數，4 的倍數），需涵蓋回音路徑
+    float step;                     // NLMS 步長 μ（0 < μ < 1，越大收斂越快，雙講時也越容易被帶偏）
+    float ref_silence_dbfs;         // 參考訊號低於這個電平時不更新、不統計
+    float dtd_ratio_db;             // 區塊的 ERLE 比平常低這麼多視為雙講
+    float dtd_min_erle_db;          // 回音消除量（ERLE）達到這個值後才啟用雙講偵測（未收斂時殘差本來就大）
+    uint32_t dtd_hangover_blocks;   // 雙講結束後繼續暫停的區塊數
+    uint32_t dtd_max_blocks;        // 連續暫停超過這麼多區塊就恢復更新（回音路徑改變時殘差也會升高）
+} audio_aec_config_t;
+
+typedef struct {
+    uint32_t blocks;                // 有參考訊號（播放中）的區塊數
+    uint32_t adapted_blocks;        // 其中有更新濾波器的區塊數
+    uint32_t double_talk_blocks;    // 其中判定雙講而暫停更新的區塊數
+    float erle_db;                  // 平滑後的回音消除量（麥克風能量 / 殘差能量）
+} audio_aec_stats_t;
+
+typedef struct {
+    audio_aec_config_t config;
+    float ref_silence;              // 參考能量門檻（Σx²/N，int16 尺度）
+    float regularization;           // NLMS 正規化的下限，避免參考很小時步長爆大
+    int pos;                        // 延遲線中最新樣本的位置
+    float ref_energy;               // 延遲線內的 Σx²
+    uint32_t zero_run;              // 連續為 0 的參考樣本數（≥ taps 時延遲線全為 0）
+    bool adapt;                     // 這個區塊是否更新（上一個區塊結束時決定）
+    uint32_t hangover;
+    uint32_t freeze_run;            // 連續暫停的區塊數
+    bool converged;                 // erle_db 已有初值
+    float erle_db;                  // 平滑後的 ERLE（只在更新的區塊追蹤）
+    uint32_t block_fill;
+    float block_ref;                // 目前區塊的 Σ參考²、Σ麥克風²、Σ殘差²
+    float block_mic;
+    float block_err;
+    audio_aec_stats_t stats;
+    float weights[AUDIO_AEC_MAX_TAPS] __attribute__((aligned(16)));
+    float line[AUDIO_AEC_MAX_TAPS * 2] __attribute__((aligned(16)));    // 每個樣本寫兩份，任何位置起的 taps 個樣本都連續
+    float scratch[AUDIO_AEC_MAX_TAPS] __attribute__((aligned(16)));
+} audio_aec_t;
+
+/**
+ * @brief 預設參數：256 taps（16 ms @ 16 kHz）、μ = 0.2、-60 dBFS 以下不更新、ERLE 掉 6 dB 視為雙講
+ */
+void audio_aec_default_config(audio_aec_config_t *config);
+
+/**
+ * @brief 初始化（係數從 0 開始）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 參數超出範圍
+ */
+esp_err_t audio_aec_init(audio_aec_t *aec, const audio_aec_config_t *config);
+
+/**
+ * @brief 清除係數、延遲線與統計（參數不變）
+ */
+void audio_aec_reset(audio_aec_t *aec);
+
+/**
+ * @brief 就地從 mic 減掉回音估計（長度不限）
+ * @param mic 麥克風樣本，處理後是殘差
+ * @param ref 同一時間送到喇叭的樣本（已對齊，可以稍微提前，濾波器會補上延遲）
+ */
+void audio_aec_process(audio_aec_t *aec, int16_t *mic, const int16_t *ref, size_t length);
+
+/**
+ * @brief 取得統計數據
+ */
+void audio_aec_get_stats(const audio_aec_t *aec, audio_aec_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_AEC_H
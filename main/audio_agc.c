@@ -0,0 +1,126 @@
+#include "audio_agc.h"
+#include "dsps_mul.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AGC_FULL_SCALE          32768.0f
+#define AGC_MIN_ENERGY          1e-3f   // 數位靜音時避免 log(0)
+
+void audio_agc_default_config(audio_agc_config_t *config, uint32_t sample_rate)
+{
+    config->sample_rate = sample_rate;
+    config->target_dbfs = -12.0f;       // 與舊的 target_rms 8192 相同
+    config->max_gain_db = AUDIO_AGC_MAX_GAIN_DB;
+    config->min_gain_db = 0.0f;
+    config->attack_ms = 10.0f;
+    config->release_ms = 300.0f;
+    config->silence_dbfs = -50.0f;
+    config->limit_dbfs = -1.0f;
+}
+
+esp_err_t audio_agc_init(audio_agc_t *agc, const audio_agc_config_t *config)
+{
+    if (config->sample_rate == 0 ||
+        config->max_gain_db > AUDIO_AGC_MAX_GAIN_DB || config->min_gain_db > config->max_gain_db ||
+        config->attack_ms <= 0.0f || config->release_ms <= 0.0f ||
+        config->target_dbfs > 0.0f || config->limit_dbfs > 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(agc, 0, sizeof(*agc));
+    agc->target = AGC_FULL_SCALE * powf(10.0f, config->target_dbfs / 20.0f);
+    agc->max_gain = powf(10.0f, config->max_gain_db / 20.0f);
+    agc->min_gain = powf(10.0f, config->min_gain_db / 20.0f);
+    float silence = AGC_FULL_SCALE * powf(10.0f, config->silence_dbfs / 20.0f);
+    agc->silence = silence * silence;
+    agc->limit = (AGC_FULL_SCALE - 1.0f) * powf(10.0f, config->limit_dbfs / 20.0f);
+    agc->attack_tau = config->attack_ms * config->sample_rate / 1000.0f;
+    agc->release_tau = config->release_ms * config->sample_rate / 1000.0f;
+    audio_agc_reset(agc);
+    return ESP_OK;
+}
+
+void audio_agc_reset(audio_agc_t *agc)
+{
+    agc->envelope = 0.0f;
+    agc->gain = 1.0f;
+    memset(&agc->stats, 0, sizeof(agc->stats));
+}
+
+// 處理最多 AUDIO_AGC_BLOCK 個樣本
+static void process_block(audio_agc_t *agc, int16_t *data, size_t length)
+{
+    int64_t energy = 0;
+    int32_t peak = 0;
+    for (size_t i = 0; i < length; i++) {
+        int32_t x = data[i];
+        energy += x * x;
+        int32_t a = abs(x);
+        peak = a > peak ? a : peak;
+    }
+
+    // 包絡：能量上升用 attack，下降用 release
+    float e = (float)energy / (float)length;
+    float tau = e > agc->envelope ? agc->attack_tau : agc->release_tau;
+    agc->envelope += (e - agc->envelope) * (1.0f - expf(-(float)length / tau));
+
+    float start = agc->gain;
+    float end = start;
+    if (agc->envelope >= agc->silence) {
+        end = agc->target / sqrtf(agc->envelope);
+        end = fminf(fmaxf(end, agc->min_gain), agc->max_gain);
+    } else {
+        agc->stats.silent_blocks++;
+    }
+
+    // 限幅器：整個區塊（含漸變的起點）的增益都不超過 上限 / 峰值
+    if (peak > 0) {
+        float limit = agc->limit / (float)peak;
+        if (end > limit || start > limit) {
+            agc->stats.limited_blocks++;
+        }
+        end = fminf(end, limit);
+        start = fminf(start, limit);
+    }
+
+    // Q15 尾數 + 區塊指數：增益 = 尾數 / 2^(15 - exponent)，尾數 < 1
+    float largest = fmaxf(start, end);
+    int exponent = 0;
+    while (exponent < 3 && largest >= 1.0f) {
+        largest *= 0.5f;
+        exponent++;
+    }
+    const int shift = 15 - exponent;
+    const float scale = (float)(1 << shift);
+    int32_t m0 = lrintf(start * scale);
+    int32_t m1 = lrintf(end * scale);
+    m0 = m0 > 32767 ? 32767 : m0;
+    m1 = m1 > 32767 ? 32767 : m1;
+    for (size_t i = 0; i < length; i++) {
+        agc->ramp[i] = (int16_t)(m0 + (m1 - m0) * (int32_t)(i + 1) / (int32_t)length);
+    }
+
+    // out = (x * 尾數) >> shift；S3 上 16-byte 對齊且長度是 8 的倍數時用 PIE 向量乘法（飽和）
+    dsps_mul_s16(data, agc->ramp, data, (int)length, 1, 1, 1, shift);
+
+    agc->gain = end;
+    agc->stats.blocks++;
+}
+
+void audio_agc_process(audio_agc_t *agc, int16_t *data, size_t length)
+{
+    while (length > 0) {
+        size_t n = length > AUDIO_AGC_BLOCK ? AUDIO_AGC_BLOCK : length;
+        process_block(agc, data, n);
+        data += n;
+        length -= n;
+    }
+}
+
+void audio_agc_get_stats(const audio_agc_t *agc, audio_agc_stats_t *stats)
+{
+    *stats = agc->stats;
+    stats->gain_db = 20.0f * log10f(agc->gain);
+    stats->envelope_dbfs = 10.0f * log10f(fmaxf(agc->envelope, AGC_MIN_ENERGY) / (AGC_FULL_SCALE * AGC_FULL_SCALE));
+}
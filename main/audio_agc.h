@@ -0,0 +1,86 @@
+#ifndef AUDIO_AGC_H
+#define AUDIO_AGC_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 串流自動增益（單次走訪）：每 10 ms 一個區塊，以 attack / release 追蹤 RMS 包絡，
+// 增益 = 目標電平 / 包絡；包絡低於靜音門檻時維持原增益，不把背景噪音放大。
+// 限幅器依區塊峰值限制增益，輸出不會超過上限。
+// 增益以 Q15 尾數 + 區塊指數表示，區塊內線性漸變，用 esp-dsp dsps_mul_s16 套用
+// （ESP32-S3 上是 PIE 向量乘法，飽和截斷）。結果只取決於之前的音訊，與整段長度無關。
+
+#define AUDIO_AGC_BLOCK         160     // 區塊大小（10 ms；8 的倍數才能用向量指令）
+#define AUDIO_AGC_MAX_GAIN_DB   18.0f   // 增益上限（指數最多 3，即 < 8 倍）
+
+typedef struct {
+    uint32_t sample_rate;
+    float target_dbfs;          // 語音的目標 RMS 電平
+    float max_gain_db;          // 最大增益（不超過 AUDIO_AGC_MAX_GAIN_DB）
+    float min_gain_db;          // 最小增益（0 = 只放大不縮小）
+    float attack_ms;            // 電平上升時包絡的反應時間
+    float release_ms;           // 電平下降時包絡的反應時間
+    float silence_dbfs;         // 包絡低於這個電平時維持原增益
+    float limit_dbfs;           // 限幅器上限（峰值）
+} audio_agc_config_t;
+
+typedef struct {
+    uint32_t blocks;
+    uint32_t limited_blocks;    // 限幅器介入的區塊數
+    uint32_t silent_blocks;     // 低於靜音門檻、增益維持不變的區塊數
+    float gain_db;              // 目前增益
+    float envelope_dbfs;        // 目前包絡
+} audio_agc_stats_t;
+
+typedef struct {
+    float target;               // 目標 RMS（int16 尺度）
+    float max_gain;
+    float min_gain;
+    float silence;              // 靜音門檻能量（Σx²/N）
+    float limit;                // 峰值上限（int16 尺度）
+    float attack_tau;           // 時間常數（樣本數）
+    float release_tau;
+    float envelope;             // 平滑後的能量
+    float gain;                 // 上一個區塊結尾的增益
+    audio_agc_stats_t stats;
+    int16_t ramp[AUDIO_AGC_BLOCK] __attribute__((aligned(16)));    // 區塊內的 Q15 增益尾數
+} audio_agc_t;
+
+/**
+ * @brief 預設參數：目標 -12 dBFS、最多 +18 dB、attack 10 ms、release 300 ms、-50 dBFS 以下不調整、限幅 -1 dBFS
+ */
+void audio_agc_default_config(audio_agc_config_t *config, uint32_t sample_rate);
+
+/**
+ * @brief 初始化（增益從 0 dB 開始）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 參數超出範圍
+ */
+esp_err_t audio_agc_init(audio_agc_t *agc, const audio_agc_config_t *config);
+
+/**
+ * @brief 清除包絡與增益（參數不變）
+ */
+void audio_agc_reset(audio_agc_t *agc);
+
+/**
+ * @brief 就地處理一段 16-bit 音訊（長度不限）
+ *        data 16-byte 對齊且區塊長度是 8 的倍數時走向量指令，否則走純量路徑
+ *        （純量路徑不飽和，由限幅器保證不會溢位）
+ */
+void audio_agc_process(audio_agc_t *agc, int16_t *data, size_t length);
+
+/**
+ * @brief 取得統計數據
+ */
+void audio_agc_get_stats(const audio_agc_t *agc, audio_agc_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_AGC_H
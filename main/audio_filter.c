@@ -0,0 +1,131 @@
+#include "audio_filter.h"
+#include "dsps_biquad.h"
+#include "dsps_biquad_gen.h"
+#include <math.h>
+#include <string.h>
+
+#define FILTER_MIN_ENERGY       1e-3f   // 數位靜音時避免 log(0)
+
+void audio_filter_default_config(audio_filter_config_t *config, uint32_t sample_rate)
+{
+    config->sample_rate = sample_rate;
+    config->dc_cutoff_hz = 20.0f;
+    config->hpf_cutoff_hz = 80.0f;
+    config->hpf_order = 2;
+    config->expander_threshold_db = -56.0f;     // 約等於舊的噪音門限（|x| < 50）
+    config->expander_ratio = 2.0f;
+    config->expander_max_atten_db = 20.0f;
+    config->expander_attack_ms = 2.0f;
+    config->expander_release_ms = 100.0f;
+}
+
+esp_err_t audio_filter_init(audio_filter_t *filter, const audio_filter_config_t *config)
+{
+    const float nyquist = config->sample_rate / 2.0f;
+    if (config->sample_rate == 0 ||
+        config->hpf_order < 0 || config->hpf_order % 2 != 0 ||
+        config->hpf_order / 2 > AUDIO_FILTER_MAX_SECTIONS ||
+        config->dc_cutoff_hz < 0.0f || config->dc_cutoff_hz >= nyquist ||
+        config->hpf_cutoff_hz < 0.0f || config->hpf_cutoff_hz >= nyquist ||
+        config->expander_ratio < 1.0f || config->expander_max_atten_db < 0.0f ||
+        config->expander_attack_ms <= 0.0f || config->expander_release_ms <= 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(filter, 0, sizeof(*filter));
+
+    // 直流阻隔：H(z) = (1 - z^-1) / (1 - R z^-1)
+    if (config->dc_cutoff_hz > 0.0f) {
+        float r = expf(-2.0f * (float)M_PI * config->dc_cutoff_hz / config->sample_rate);
+        filter->coeffs[0][0] = 1.0f;
+        filter->coeffs[0][1] = -1.0f;
+        filter->coeffs[0][3] = -r;
+        filter->first_section = 0;
+    } else {
+        filter->first_section = 1;
+    }
+
+    // Butterworth 高通：N 階拆成 N/2 個 2 階節，第 k 節 Q = 1 / (2 sin((2k+1)π / 2N))
+    int hpf_sections = config->hpf_cutoff_hz > 0.0f ? config->hpf_order / 2 : 0;
+    for (int k = 0; k < hpf_sections; k++) {
+        float q = 1.0f / (2.0f * sinf((2 * k + 1) * (float)M_PI / (2.0f * config->hpf_order)));
+        esp_err_t ret = dsps_biquad_gen_hpf_f32(filter->coeffs[1 + k],
+                                                config->hpf_cutoff_hz / config->sample_rate, q);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    filter->sections = 1 + hpf_sections;
+
+    filter->threshold = 32768.0f * 32768.0f * powf(10.0f, config->expander_threshold_db / 10.0f);
+    filter->slope = 1.0f - config->expander_ratio;
+    filter->min_gain_db = -config->expander_max_atten_db;
+    filter->attack_tau = config->expander_attack_ms * config->sample_rate / 1000.0f;
+    filter->release_tau = config->expander_release_ms * config->sample_rate / 1000.0f;
+
+    audio_filter_reset(filter);
+    return ESP_OK;
+}
+
+void audio_filter_reset(audio_filter_t *filter)
+{
+    memset(filter->state, 0, sizeof(filter->state));
+    filter->envelope = filter->threshold;
+    filter->gain = 1.0f;
+}
+
+// 處理最多 AUDIO_FILTER_BLOCK 個樣本
+static void process_block(audio_filter_t *filter, int16_t *data, size_t length)
+{
+    float *x = filter->work[0];
+    float *y = filter->work[1];
+
+    for (size_t i = 0; i < length; i++) {
+        x[i] = data[i];
+    }
+
+    // 每一節輸出到另一個工作區，兩個工作區輪流使用
+    for (int s = filter->first_section; s < filter->sections; s++) {
+        dsps_biquad_f32(x, y, (int)length, filter->coeffs[s], filter->state[s]);
+        float *tmp = x;
+        x = y;
+        y = tmp;
+    }
+
+    // 擴展器：區塊能量上升時快速跟上（attack），下降時慢慢放開（release）
+    float energy = 0.0f;
+    for (size_t i = 0; i < length; i++) {
+        energy += x[i] * x[i];
+    }
+    energy /= (float)length;
+    float tau = energy > filter->envelope ? filter->attack_tau : filter->release_tau;
+    filter->envelope += (energy - filter->envelope) * (1.0f - expf(-(float)length / tau));
+
+    float target = 1.0f;
+    if (filter->envelope < filter->threshold) {
+        float below_db = 10.0f * log10f(filter->threshold / fmaxf(filter->envelope, FILTER_MIN_ENERGY));
+        target = powf(10.0f, fmaxf(filter->slope * below_db, filter->min_gain_db) / 20.0f);
+    }
+
+    // 增益在區塊內從上一個值線性漸變到目標值
+    float gain = filter->gain;
+    const float step = (target - gain) / (float)length;
+    for (size_t i = 0; i < length; i++) {
+        gain += step;
+        float v = x[i] * gain;
+        if (v > 32767.0f) v = 32767.0f;
+        if (v < -32768.0f) v = -32768.0f;
+        data[i] = (int16_t)lrintf(v);
+    }
+    filter->gain = target;
+}
+
+void audio_filter_process(audio_filter_t *filter, int16_t *data, size_t length)
+{
+    while (length > 0) {
+        size_t n = length > AUDIO_FILTER_BLOCK ? AUDIO_FILTER_BLOCK : length;
+        process_block(filter, data, n);
+        data += n;
+        length -= n;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef AUDIO_FILTER_H
+#define AUDIO_FILTER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 擷取端的串流前處理：直流阻隔 → 高通串聯（Butterworth，2 階一節）→ 柔性下行擴展器
+// 濾波器狀態跨區塊保留，可以用任意長度逐段處理（例如跨過環形緩衝區結尾的兩段），
+// 濾波結果與一次處理整段相同；擴展器每段（最多 AUDIO_FILTER_BLOCK 個樣本）更新一次增益。
+// 喚醒詞模型與上傳看到的是同一個濾波後的串流。
+
+#define AUDIO_FILTER_MAX_SECTIONS   4       // 高通最多 8 階
+#define AUDIO_FILTER_BLOCK          160     // 內部浮點工作區大小（較長的輸入分段處理）
+
+typedef struct {
+    uint32_t sample_rate;
+    float dc_cutoff_hz;             // 直流阻隔的截止頻率（一階，0 = 不使用）
+    float hpf_cutoff_hz;            // 高通截止頻率（0 = 不使用）
+    int hpf_order;                  // 高通階數（2、4、6、8）
+    float expander_threshold_db;    // 低於這個電平（dBFS）開始衰減
+    float expander_ratio;           // 擴展比：門檻以下每 1 dB 變成 ratio dB
+    float expander_max_atten_db;    // 最大衰減（柔性，不會像噪音門限一樣直接歸零）
+    float expander_attack_ms;       // 電平上升時的反應時間（語音開頭不被吃掉）
+    float expander_release_ms;      // 電平下降時的反應時間
+} audio_filter_config_t;
+
+typedef struct {
+    // biquad 係數 b0, b1, b2, a1, a2（esp-dsp 格式）與狀態；第 0 節是直流阻隔
+    float coeffs[AUDIO_FILTER_MAX_SECTIONS + 1][5];
+    float state[AUDIO_FILTER_MAX_SECTIONS + 1][2];
+    int first_section;              // 不使用直流阻隔時從第 1 節開始
+    int sections;                   // 使用的節數（含直流阻隔）
+    // 擴展器（以區塊能量追蹤電平，增益在區塊內線性漸變，避免拉鍊雜音）
+    float threshold;                // 門檻能量（Σx²/N，int16 尺度）
+    float slope;                    // 增益(dB) = slope × (門檻 - 電平)(dB)，即 1 - ratio
+    float min_gain_db;
+    float attack_tau;               // 時間常數（樣本數）
+    float release_tau;
+    float envelope;                 // 平滑後的能量
+    float gain;                     // 上一個區塊結尾的增益（線性）
+    float work[2][AUDIO_FILTER_BLOCK] __attribute__((aligned(16)));
+} audio_filter_t;
+
+/**
+ * @brief 預設參數：20 Hz 直流阻隔、80 Hz 2 階高通、-56 dBFS 以下 1:2 擴展（最多 -20 dB）
+ */
+void audio_filter_default_config(audio_filter_config_t *config, uint32_t sample_rate);
+
+/**
+ * @brief 依參數產生係數並清除狀態
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 參數超出範圍
+ */
+esp_err_t audio_filter_init(audio_filter_t *filter, const audio_filter_config_t *config);
+
+/**
+ * @brief 清除濾波器與擴展器狀態（係數不變）
+ */
+void audio_filter_reset(audio_filter_t *filter);
+
+/**
+ * @brief 就地處理一段 16-bit 音訊（長度不限），狀態延續到下一次呼叫
+ */
+void audio_filter_process(audio_filter_t *filter, int16_t *data, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_FILTER_H
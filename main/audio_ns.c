@@ -0,0 +1,164 @@
+#include "audio_ns.h"
+#include "dsps_fft2r.h"
+#include "esp_cpu.h"
+#include <math.h>
+#include <string.h>
+
+#define NS_MIN_NOISE            1e-3f   // 噪音估計下限（數位靜音時避免除以 0）
+#define NS_MAX_PRIORI_SNR       1e3f    // 先驗 SNR 上限（30 dB），避免 float 溢位
+#define NS_SPEECH_RATIO         4.0f    // 功率超過噪音估計的 4 倍（6 dB）視為語音
+
+// 只有上傳任務使用，窗函數放在靜態記憶體
+static float s_window[AUDIO_NS_FFT_SIZE];   // sqrt-Hann（週期型），分析與合成各乘一次，50% 重疊時總和為 1
+
+void audio_ns_default_config(audio_ns_config_t *config)
+{
+    config->min_gain_db = -15.0f;
+    config->dd_alpha = 0.98f;
+    config->noise_up_rate = 0.005f;
+    config->noise_update_rate = 0.1f;
+    config->init_frames = 4;
+}
+
+esp_err_t audio_ns_init(audio_ns_t *ns, const audio_ns_config_t *config)
+{
+    if (config->min_gain_db > 0.0f || config->dd_alpha < 0.0f || config->dd_alpha >= 1.0f ||
+        config->noise_up_rate < 0.0f || config->noise_update_rate <= 0.0f || config->noise_update_rate > 1.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // fc32 FFT 只有一份全域旋轉因子表，已初始化時直接返回 ESP_OK
+    esp_err_t ret = dsps_fft2r_init_fc32(NULL, CONFIG_DSP_MAX_FFT_SIZE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(ns, 0, sizeof(*ns));
+    ns->config = *config;
+    ns->min_gain = powf(10.0f, config->min_gain_db / 20.0f);
+    for (int i = 0; i < AUDIO_NS_FFT_SIZE; i++) {
+        s_window[i] = sqrtf(0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / AUDIO_NS_FFT_SIZE));
+    }
+    return ESP_OK;
+}
+
+void audio_ns_reset_stream(audio_ns_t *ns)
+{
+    memset(ns->input, 0, sizeof(ns->input));
+    memset(ns->overlap, 0, sizeof(ns->overlap));
+    memset(ns->output, 0, sizeof(ns->output));
+    memset(ns->prev_clean, 0, sizeof(ns->prev_clean));
+    ns->fill = 0;
+    ns->gain_db_sum = 0.0;
+    memset(&ns->stats, 0, sizeof(ns->stats));
+}
+
+// 更新一個頻點的噪音估計：功率不超過噪音的 NS_SPEECH_RATIO 倍時視為噪音，以遞迴平均跟隨
+// （單一頻點的功率起伏很大，只往下快速跟隨會偏向最小值而低估噪音）；
+// 超過時視為語音，噪音每幀最多乘上 1 + up_rate，環境噪音突然變大時仍能慢慢跟上
+static inline float track_noise(const audio_ns_t *ns, float noise, float power) {
+    if (ns->noise_frames < ns->config.init_frames) {
+        return noise + (power - noise) / (float)(ns->noise_frames + 1);
+    }
+    if (power < noise * NS_SPEECH_RATIO) {
+        return noise + (power - noise) * ns->config.noise_update_rate;
+    }
+    return noise * (1.0f + ns->config.noise_up_rate);
+}
+
+static void process_frame(audio_ns_t *ns) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    float *x = ns->fft;
+
+    for (int i = 0; i < AUDIO_NS_FFT_SIZE; i++) {
+        x[2 * i] = ns->input[i] * s_window[i];
+        x[2 * i + 1] = 0.0f;
+    }
+    dsps_fft2r_fc32(x, AUDIO_NS_FFT_SIZE);
+    dsps_bit_rev2r_fc32(x, AUDIO_NS_FFT_SIZE);
+
+    // Wiener 增益：先驗 SNR = α·上一幀乾淨功率 / 噪音 + (1 - α)·max(後驗 SNR - 1, 0)
+    const float alpha = ns->config.dd_alpha;
+    float gain_db_sum = 0.0f;
+    for (int k = 0; k < AUDIO_NS_BINS; k++) {
+        float re = x[2 * k];
+        float im = x[2 * k + 1];
+        float power = re * re + im * im;
+
+        float noise = fmaxf(track_noise(ns, ns->noise[k], power), NS_MIN_NOISE);
+        ns->noise[k] = noise;
+
+        float post = power / noise;
+        float prio = alpha * ns->prev_clean[k] / noise + (1.0f - alpha) * fmaxf(post - 1.0f, 0.0f);
+        prio = fminf(prio, NS_MAX_PRIORI_SNR);
+        float gain = fmaxf(prio / (1.0f + prio), ns->min_gain);
+        ns->prev_clean[k] = gain * gain * power;
+        gain_db_sum += 20.0f * log10f(gain);
+
+        // 實數訊號的頻譜共軛對稱，負頻率乘上同一個增益
+        x[2 * k] *= gain;
+        x[2 * k + 1] *= gain;
+        if (k > 0 && k < AUDIO_NS_FFT_SIZE / 2) {
+            x[2 * (AUDIO_NS_FFT_SIZE - k)] *= gain;
+            x[2 * (AUDIO_NS_FFT_SIZE - k) + 1] *= gain;
+        }
+    }
+    ns->noise_frames++;
+
+    // 反 FFT：x = conj(FFT(conj(X))) / N，輸出是實數，只取實部
+    for (int i = 0; i < AUDIO_NS_FFT_SIZE; i++) {
+        x[2 * i + 1] = -x[2 * i + 1];
+    }
+    dsps_fft2r_fc32(x, AUDIO_NS_FFT_SIZE);
+    dsps_bit_rev2r_fc32(x, AUDIO_NS_FFT_SIZE);
+
+    // 合成窗後重疊相加：前半與上一幀的後半相加即完成，後半留到下一幀
+    const float scale = 1.0f / AUDIO_NS_FFT_SIZE;
+    for (int i = 0; i < AUDIO_NS_HOP; i++) {
+        float y = ns->overlap[i] + x[2 * i] * scale * s_window[i];
+        ns->overlap[i] = x[2 * (i + AUDIO_NS_HOP)] * scale * s_window[i + AUDIO_NS_HOP];
+        if (y > 32767.0f) y = 32767.0f;
+        if (y < -32768.0f) y = -32768.0f;
+        ns->output[i] = (int16_t)lrintf(y);
+    }
+
+    // 這一幀的後半成為下一幀的前半
+    memcpy(ns->input, ns->input + AUDIO_NS_HOP, AUDIO_NS_HOP * sizeof(float));
+
+    ns->gain_db_sum += gain_db_sum / AUDIO_NS_BINS;
+    ns->stats.frames++;
+    ns->stats.cycles += esp_cpu_get_cycle_count() - start;
+}
+
+void audio_ns_process(audio_ns_t *ns, int16_t *data, size_t length)
+{
+    while (length > 0) {
+        size_t n = AUDIO_NS_HOP - ns->fill;
+        if (n > length) {
+            n = length;
+        }
+        // 新樣本放進這一幀的後半，同時送出上一幀完成的輸出（延遲一整幀）
+        for (size_t i = 0; i < n; i++) {
+            ns->input[AUDIO_NS_HOP + ns->fill + i] = data[i];
+            data[i] = ns->output[ns->fill + i];
+        }
+        ns->fill += n;
+        data += n;
+        length -= n;
+        if (ns->fill == AUDIO_NS_HOP) {
+            process_frame(ns);
+            ns->fill = 0;
+        }
+    }
+}
+
+void audio_ns_get_stats(const audio_ns_t *ns, uint32_t sample_rate, audio_ns_stats_t *stats)
+{
+    *stats = ns->stats;
+    if (stats->frames > 0) {
+        // 每幀 AUDIO_NS_HOP 個新樣本；10 ms = sample_rate / 100 個樣本
+        stats->cycles_per_10ms = (uint32_t)(stats->cycles * (sample_rate / 100) /
+                                            ((uint64_t)stats->frames * AUDIO_NS_HOP));
+        stats->mean_gain_db = (float)(ns->gain_db_sum / stats->frames);
+    }
+}
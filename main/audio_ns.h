@@ -0,0 +1,83 @@
+#ifndef AUDIO_NS_H
+#define AUDIO_NS_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 頻譜降噪（上傳音訊用）：256 點 STFT，sqrt-Hann 窗，50% 重疊相加（每 8 ms 一幀）。
+// 每個頻點追蹤噪音功率（不像語音的幀以遞迴平均更新，像語音的幀只讓噪音慢慢抬高），
+// 以 decision-directed 先驗 SNR 算 Wiener 增益，增益下限避免「音樂雜音」。
+// FFT 使用 esp-dsp dsps_fft2r_fc32（與 Edge Impulse SDK 共用同一份旋轉因子表）。
+// 逐段串流處理：輸出比輸入晚 AUDIO_NS_FFT_SIZE 個樣本（16 ms），長度不變。
+
+#define AUDIO_NS_FFT_SIZE       256
+#define AUDIO_NS_HOP            (AUDIO_NS_FFT_SIZE / 2)
+#define AUDIO_NS_BINS           (AUDIO_NS_FFT_SIZE / 2 + 1)
+#define AUDIO_NS_CYCLE_BUDGET   48000   // 每 10 ms 音訊的 CPU 預算（240 MHz 的 2%）
+
+typedef struct {
+    float min_gain_db;          // 增益下限（越低降噪越強，音樂雜音也越明顯）
+    float dd_alpha;             // decision-directed 平滑係數（越接近 1 越平滑）
+    float noise_up_rate;        // 像語音的幀（功率超過噪音 6 dB）噪音每幀上升的比例
+    float noise_update_rate;    // 其他幀的遞迴平均係數
+    uint32_t init_frames;       // 前幾幀直接平均當作初始噪音
+} audio_ns_config_t;
+
+typedef struct {
+    uint32_t frames;            // 處理過的幀數
+    uint64_t cycles;            // 幀處理的 CPU 週期總和
+    uint32_t cycles_per_10ms;   // 換算成每 10 ms 音訊
+    float mean_gain_db;         // 平均增益（各頻點、各幀的 dB 平均）
+} audio_ns_stats_t;
+
+typedef struct {
+    audio_ns_config_t config;
+    float min_gain;
+    float input[AUDIO_NS_FFT_SIZE];         // 最近一幀的輸入（前半是上一幀的後半）
+    float overlap[AUDIO_NS_HOP];            // 上一幀輸出的後半，等待相加
+    int16_t output[AUDIO_NS_HOP];           // 已完成、等待送出的輸出
+    size_t fill;                            // 目前這一幀已收到的新樣本數
+    float noise[AUDIO_NS_BINS];             // 噪音功率估計
+    float prev_clean[AUDIO_NS_BINS];        // 上一幀的 |G·X|²（decision-directed 用）
+    uint32_t noise_frames;                  // 已用於噪音估計的幀數
+    double gain_db_sum;
+    audio_ns_stats_t stats;
+    float fft[AUDIO_NS_FFT_SIZE * 2] __attribute__((aligned(16)));    // 交錯的實部 / 虛部
+} audio_ns_t;
+
+/**
+ * @brief 預設參數：增益下限 -15 dB、α = 0.98、噪音上升 0.5% / 幀（約 2.7 dB/秒）
+ */
+void audio_ns_default_config(audio_ns_config_t *config);
+
+/**
+ * @brief 初始化（FFT 表未初始化時以 CONFIG_DSP_MAX_FFT_SIZE 初始化，與 Edge Impulse SDK 相同）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 參數超出範圍，其他為 esp-dsp 錯誤
+ */
+esp_err_t audio_ns_init(audio_ns_t *ns, const audio_ns_config_t *config);
+
+/**
+ * @brief 開始新的一段串流：清除重疊相加的緩衝區與統計，保留噪音估計（環境噪音通常不變）
+ */
+void audio_ns_reset_stream(audio_ns_t *ns);
+
+/**
+ * @brief 就地處理一段 16-bit 音訊（長度不限），輸出延遲 AUDIO_NS_FFT_SIZE 個樣本
+ */
+void audio_ns_process(audio_ns_t *ns, int16_t *data, size_t length);
+
+/**
+ * @brief 取得統計數據（包含實測的每 10 ms CPU 週期）
+ */
+void audio_ns_get_stats(const audio_ns_t *ns, uint32_t sample_rate, audio_ns_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_NS_H
@@ -0,0 +1,265 @@
+#include "audio_ring.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include <stdbool.h>
+#include <string.h>
+
+// head / tail 是自由遞增的樣本計數，head - tail 即填充量（uint32 溢位時仍正確）
+// 生產者先寫資料再以 release 更新 head，消費者以 acquire 讀 head 後才讀資料；tail 反之。
+
+esp_err_t audio_ring_init(audio_ring_t *ring, size_t size_samples)
+{
+    if (size_samples == 0 || (size_samples & (size_samples - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->buffer = (int16_t *)heap_caps_malloc(size_samples * sizeof(int16_t),
+                                               MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (ring->buffer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring->size = size_samples;
+    ring->mask = size_samples - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overflow_samples, 0);
+    atomic_init(&ring->overflows, 0);
+    atomic_init(&ring->underruns, 0);
+    atomic_init(&ring->high_water, 0);
+    return ESP_OK;
+}
+
+void audio_ring_deinit(audio_ring_t *ring)
+{
+    heap_caps_free(ring->buffer);
+    ring->buffer = NULL;
+}
+
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *data, size_t count)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t space = ring->size - (head - tail);
+
+    size_t to_write = count;
+    if (to_write > space) {
+        to_write = space;
+        atomic_fetch_add_explicit(&ring->overflow_samples, count - to_write, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+    }
+
+    // 分兩段複製（跨過緩衝區結尾時）
+    uint32_t pos = head & ring->mask;
+    size_t first = ring->size - pos;
+    if (first > to_write) {
+        first = to_write;
+    }
+    memcpy(ring->buffer + pos, data, first * sizeof(int16_t));
+    memcpy(ring->buffer, data + first, (to_write - first) * sizeof(int16_t));
+
+    atomic_store_explicit(&ring->head, head + to_write, memory_order_release);
+
+    uint32_t fill = head + to_write - tail;
+    if (fill > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, fill, memory_order_relaxed);
+    }
+    return to_write;
+}
+
+size_t audio_ring_reserve(audio_ring_t *ring, size_t count, int16_t **dst)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint32_t space = ring->size - (head - tail);
+
+    uint32_t pos = head & ring->mask;
+    size_t contiguous = ring->size - pos;
+    if (contiguous > space) {
+        contiguous = space;
+    }
+    if (contiguous > count) {
+        contiguous = count;
+    }
+    *dst = ring->buffer + pos;
+    return contiguous;
+}
+
+void audio_ring_commit(audio_ring_t *ring, size_t written, size_t dropped)
+{
+    if (dropped > 0) {
+        atomic_fetch_add_explicit(&ring->overflow_samples, dropped, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+    }
+    if (written == 0) {
+        return;
+    }
+
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + written;
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    uint32_t fill = head - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (fill > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, fill, memory_order_relaxed);
+    }
+}
+
+size_t audio_ring_read(audio_ring_t *ring, int16_t *data, size_t count)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head - tail < count) {
+        atomic_fetch_add_explicit(&ring->underruns, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    uint32_t pos = tail & ring->mask;
+    size_t first = ring->size - pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(data, ring->buffer + pos, first * sizeof(int16_t));
+    memcpy(data + first, ring->buffer, (count - first) * sizeof(int16_t));
+
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+size_t audio_ring_available(audio_ring_t *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t audio_ring_write_count(audio_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+uint32_t audio_ring_read_count(audio_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+void audio_ring_flush(audio_ring_t *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    atomic_store_explicit(&ring->tail, head, memory_order_release);
+}
+
+void audio_ring_get_stats(audio_ring_t *ring, audio_ring_stats_t *stats)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    stats->size = ring->size;
+    stats->fill = head - tail;
+    stats->high_water = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+    stats->overflow_samples = atomic_load_explicit(&ring->overflow_samples, memory_order_relaxed);
+    stats->overflows = atomic_load_explicit(&ring->overflows, memory_order_relaxed);
+    stats->underruns = atomic_load_explicit(&ring->underruns, memory_order_relaxed);
+}
+
+static esp_err_t history_init(audio_history_t *history, size_t size_samples, uint32_t caps)
+{
+    if (size_samples == 0 || (size_samples & (size_samples - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(history, 0, sizeof(*history));
+    history->buffer = (int16_t *)heap_caps_malloc(size_samples * sizeof(int16_t), caps);
+    if (history->buffer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    history->size = size_samples;
+    history->mask = size_samples - 1;
+    atomic_init(&history->head, 0);
+    atomic_init(&history->max_block, 0);
+    return ESP_OK;
+}
+
+esp_err_t audio_history_init(audio_history_t *history, size_t size_samples)
+{
+    return history_init(history, size_samples, MALLOC_CAP_SPIRAM);
+}
+
+esp_err_t audio_history_init_internal(audio_history_t *history, size_t size_samples)
+{
+    return history_init(history, size_samples, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void audio_history_deinit(audio_history_t *history)
+{
+    heap_caps_free(history->buffer);
+    history->buffer = NULL;
+}
+
+// 放在 IRAM：喇叭參考訊號在播放 DMA 的中斷中寫入（緩衝區在內部 RAM）
+IRAM_ATTR void audio_history_write(audio_history_t *history, const int16_t *data, size_t count)
+{
+    uint32_t head = atomic_load_explicit(&history->head, memory_order_relaxed);
+
+    // 一次寫入超過容量時只保留最後 size 個樣本
+    if (count > history->size) {
+        head += count - history->size;
+        data += count - history->size;
+        count = history->size;
+    }
+
+    // 先公布區塊大小再覆蓋資料，讀取端才知道要保留多少餘量
+    if (count > atomic_load_explicit(&history->max_block, memory_order_relaxed)) {
+        atomic_store_explicit(&history->max_block, count, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    uint32_t pos = head & history->mask;
+    size_t first = history->size - pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(history->buffer + pos, data, first * sizeof(int16_t));
+    memcpy(history->buffer, data + first, (count - first) * sizeof(int16_t));
+
+    atomic_store_explicit(&history->head, head + count, memory_order_release);
+}
+
+uint32_t audio_history_write_count(audio_history_t *history)
+{
+    return atomic_load_explicit(&history->head, memory_order_acquire);
+}
+
+// [start_count, ...) 是否可能已被覆蓋：生產者正在寫的區塊（最多 max_block 個樣本）
+// 在 head 更新之前就已經落在緩衝區裡，所以要多保留一個區塊的餘量
+static bool history_overwritten(audio_history_t *history, uint32_t head, uint32_t start_count)
+{
+    uint32_t max_block = atomic_load_explicit(&history->max_block, memory_order_relaxed);
+    return head + max_block - start_count > history->size;
+}
+
+esp_err_t audio_history_read(audio_history_t *history, uint32_t start_count, int16_t *data, size_t count)
+{
+    uint32_t head = atomic_load_explicit(&history->head, memory_order_acquire);
+    if ((int32_t)(head - start_count) < (int32_t)count) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (history_overwritten(history, head, start_count)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t pos = start_count & history->mask;
+    size_t first = history->size - pos;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(data, history->buffer + pos, first * sizeof(int16_t));
+    memcpy(data + first, history->buffer, (count - first) * sizeof(int16_t));
+
+    // 複製期間生產者可能已經覆蓋了開頭（包括還沒更新 head 的區塊），再檢查一次
+    atomic_thread_fence(memory_order_acquire);
+    head = atomic_load_explicit(&history->head, memory_order_acquire);
+    if (history_overwritten(history, head, start_count)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
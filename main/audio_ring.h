@@ -0,0 +1,156 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 單一生產者 / 單一消費者（SPSC）的 16-bit 音訊環形緩衝區，不使用鎖：
+// 只有生產者（擷取任務）更新 head，只有消費者（檢測任務）更新 tail，
+// 兩個任務可以在不同核心上同時存取。
+typedef struct {
+    int16_t *buffer;
+    uint32_t size;                  // 容量（樣本數，2 的次方）
+    uint32_t mask;
+    atomic_uint head;               // 已寫入的樣本總數（生產者）
+    atomic_uint tail;               // 已讀出的樣本總數（消費者）
+    atomic_uint overflow_samples;   // 緩衝區已滿而丟棄的樣本數
+    atomic_uint overflows;          // 發生丟棄的寫入次數
+    atomic_uint underruns;          // 要讀取時資料不足的次數
+    atomic_uint high_water;         // 最高填充量（樣本數）
+} audio_ring_t;
+
+typedef struct {
+    uint32_t size;
+    uint32_t fill;
+    uint32_t high_water;
+    uint32_t overflow_samples;
+    uint32_t overflows;
+    uint32_t underruns;
+} audio_ring_stats_t;
+
+/**
+ * @brief 初始化環形緩衝區（配置在內部 RAM）
+ * @param ring 環形緩衝區
+ * @param size_samples 容量（樣本數，必須是 2 的次方）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 容量不是 2 的次方，ESP_ERR_NO_MEM 記憶體不足
+ */
+esp_err_t audio_ring_init(audio_ring_t *ring, size_t size_samples);
+
+/**
+ * @brief 釋放環形緩衝區
+ */
+void audio_ring_deinit(audio_ring_t *ring);
+
+/**
+ * @brief 寫入樣本（只能由生產者呼叫，不會阻塞）
+ *        空間不足時寫入能放下的部分，其餘丟棄並計入 overflow
+ * @return 實際寫入的樣本數
+ */
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *data, size_t count);
+
+/**
+ * @brief 零複製寫入：取得下一段可直接寫入的連續空間（只能由生產者呼叫）
+ *        空間不會跨過緩衝區結尾，寫滿 count 個樣本可能需要呼叫兩次
+ * @param count 想寫入的樣本數
+ * @param dst 返回可寫入的位置
+ * @return 可寫入的樣本數（不超過 count），0 表示緩衝區已滿
+ */
+size_t audio_ring_reserve(audio_ring_t *ring, size_t count, int16_t **dst);
+
+/**
+ * @brief 發布 audio_ring_reserve 取得的空間（只能由生產者呼叫）
+ * @param written 已寫入的樣本數（不超過 reserve 的返回值）
+ * @param dropped 因緩衝區已滿而丟棄的樣本數，計入 overflow
+ */
+void audio_ring_commit(audio_ring_t *ring, size_t written, size_t dropped);
+
+/**
+ * @brief 讀取剛好 count 個樣本（只能由消費者呼叫，不會阻塞）
+ *        資料不足時不讀取並計入 underrun
+ * @return count 成功，0 資料不足
+ */
+size_t audio_ring_read(audio_ring_t *ring, int16_t *data, size_t count);
+
+/**
+ * @brief 可讀取的樣本數（消費者）
+ */
+size_t audio_ring_available(audio_ring_t *ring);
+
+/**
+ * @brief 已寫入的樣本總數（自由遞增，可當作樣本序號）
+ */
+uint32_t audio_ring_write_count(audio_ring_t *ring);
+
+/**
+ * @brief 已讀出的樣本總數（自由遞增，可當作樣本序號）
+ */
+uint32_t audio_ring_read_count(audio_ring_t *ring);
+
+/**
+ * @brief 丟棄所有尚未讀取的樣本（只能由消費者呼叫）
+ */
+void audio_ring_flush(audio_ring_t *ring);
+
+/**
+ * @brief 取得統計數據（任何任務都可呼叫）
+ */
+void audio_ring_get_stats(audio_ring_t *ring, audio_ring_stats_t *stats);
+
+// 預錄環形緩衝區：保留最近 size 個樣本（配置在 PSRAM），以寫入計數（樣本序號）隨機讀取。
+// 單一生產者，寫入永遠不會失敗，只會覆蓋最舊的樣本；任何任務都可以讀取仍在緩衝區內的範圍。
+typedef struct {
+    int16_t *buffer;
+    uint32_t size;                  // 容量（樣本數，2 的次方）
+    uint32_t mask;
+    atomic_uint head;               // 已寫入的樣本總數
+    atomic_uint max_block;          // 單次寫入的最大樣本數（讀取時保留的餘量）
+} audio_history_t;
+
+/**
+ * @brief 初始化預錄環形緩衝區（配置在 PSRAM）
+ * @param size_samples 容量（樣本數，必須是 2 的次方）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 容量不是 2 的次方，ESP_ERR_NO_MEM 記憶體不足
+ */
+esp_err_t audio_history_init(audio_history_t *history, size_t size_samples);
+
+/**
+ * @brief 初始化預錄環形緩衝區（配置在內部 RAM，可以在中斷中寫入）
+ * @param size_samples 容量（樣本數，必須是 2 的次方）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 容量不是 2 的次方，ESP_ERR_NO_MEM 記憶體不足
+ */
+esp_err_t audio_history_init_internal(audio_history_t *history, size_t size_samples);
+
+/**
+ * @brief 釋放預錄環形緩衝區
+ */
+void audio_history_deinit(audio_history_t *history);
+
+/**
+ * @brief 寫入樣本（只能由生產者呼叫，覆蓋最舊的樣本）
+ */
+void audio_history_write(audio_history_t *history, const int16_t *data, size_t count);
+
+/**
+ * @brief 已寫入的樣本總數
+ */
+uint32_t audio_history_write_count(audio_history_t *history);
+
+/**
+ * @brief 讀取寫入計數 [start_count, start_count + count) 的樣本
+ *        生產者在更新 head 之前就會覆蓋 head 之後一個區塊的位置，
+ *        所以範圍必須距離 head - size 至少一個最大寫入區塊，複製前後各檢查一次
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 還沒寫到，ESP_ERR_NOT_FOUND 已被覆蓋
+ */
+esp_err_t audio_history_read(audio_history_t *history, uint32_t start_count, int16_t *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_RING_H
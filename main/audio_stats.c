@@ -0,0 +1,127 @@
+#include "audio_stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+// 每次處理 4 個樣本：兩兩相加的平方和最多 2^31，放得進 uint32，再累加到 64-bit
+void audio_convert_i2s32(const int32_t *input, int16_t *output, size_t length, audio_stats_t *stats)
+{
+    uint64_t energy = 0;
+    int32_t sum = 0;
+    int32_t peak = stats->peak;
+    size_t i = 0;
+
+    for (; i + 4 <= length; i += 4) {
+        // INMP441 輸出 24-bit 數據，存儲在 32-bit 容器的高 24 位，右移 16 位保留最高有效位
+        int32_t a = input[i] >> 16;
+        int32_t b = input[i + 1] >> 16;
+        int32_t c = input[i + 2] >> 16;
+        int32_t d = input[i + 3] >> 16;
+        output[i] = (int16_t)a;
+        output[i + 1] = (int16_t)b;
+        output[i + 2] = (int16_t)c;
+        output[i + 3] = (int16_t)d;
+
+        energy += (uint32_t)(a * a) + (uint32_t)(b * b);
+        energy += (uint32_t)(c * c) + (uint32_t)(d * d);
+        sum += a + b + c + d;
+
+        // Xtensa 有 ABS / MAX 指令，這裡不會產生分支
+        int32_t m = MAX(MAX(abs(a), abs(b)), MAX(abs(c), abs(d)));
+        peak = MAX(peak, m);
+    }
+    for (; i < length; i++) {
+        int32_t a = input[i] >> 16;
+        output[i] = (int16_t)a;
+        energy += (uint32_t)(a * a);
+        sum += a;
+        peak = MAX(peak, abs(a));
+    }
+
+    stats->energy += energy;
+    stats->sum += sum;
+    stats->peak = peak;
+    stats->samples += length;
+}
+
+void audio_stats_accumulate(audio_stats_t *stats, const int16_t *data, size_t length)
+{
+    uint64_t energy = 0;
+    int64_t sum = 0;
+    int32_t peak = stats->peak;
+
+    for (size_t i = 0; i < length; i++) {
+        int32_t a = data[i];
+        energy += (uint32_t)(a * a);
+        sum += a;
+        peak = MAX(peak, abs(a));
+    }
+
+    stats->energy += energy;
+    stats->sum += sum;
+    stats->peak = peak;
+    stats->samples += length;
+}
+
+void audio_stats_merge(audio_stats_t *dst, const audio_stats_t *src)
+{
+    dst->energy += src->energy;
+    dst->sum += src->sum;
+    if (src->peak > dst->peak) {
+        dst->peak = src->peak;
+    }
+    dst->samples += src->samples;
+}
+
+int64_t audio_stats_mean_energy(const audio_stats_t *stats)
+{
+    return stats->samples > 0 ? (int64_t)(stats->energy / stats->samples) : 0;
+}
+
+int32_t audio_stats_dc(const audio_stats_t *stats)
+{
+    return stats->samples > 0 ? (int32_t)(stats->sum / (int64_t)stats->samples) : 0;
+}
+
+void audio_stats_history_push(audio_stats_history_t *history, uint32_t end_count, const audio_stats_t *block)
+{
+    uint32_t count = atomic_load_explicit(&history->count, memory_order_relaxed);
+    audio_stats_block_t *entry = &history->blocks[count & (AUDIO_STATS_HISTORY - 1)];
+    entry->end_count = end_count;
+    entry->samples = block->samples;
+    entry->energy = block->energy;
+    entry->sum = (int32_t)block->sum;
+    entry->peak = block->peak;
+    atomic_store_explicit(&history->count, count + 1, memory_order_release);
+}
+
+// 從最新的區塊往回找；消費者落後不會超過環形緩衝區容量，要讀的區塊不會被覆寫
+bool audio_stats_history_range(audio_stats_history_t *history, uint32_t start_count, uint32_t end_count,
+                               audio_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    uint32_t count = atomic_load_explicit(&history->count, memory_order_acquire);
+    uint32_t available = count < AUDIO_STATS_HISTORY ? count : AUDIO_STATS_HISTORY;
+
+    for (uint32_t n = 1; n <= available; n++) {
+        const audio_stats_block_t *entry = &history->blocks[(count - n) & (AUDIO_STATS_HISTORY - 1)];
+        // 以差值比較，寫入計數溢位時仍正確
+        if ((int32_t)(entry->end_count - start_count) <= 0) {
+            break;
+        }
+        if ((int32_t)(entry->end_count - end_count) > 0) {
+            continue;
+        }
+        out->energy += entry->energy;
+        out->sum += entry->sum;
+        if (entry->peak > out->peak) {
+            out->peak = entry->peak;
+        }
+        out->samples += entry->samples;
+    }
+    return out->samples > 0;
+}
@@ -0,0 +1,83 @@
+#ifndef AUDIO_STATS_H
+#define AUDIO_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 一段音訊的統計（可以逐區塊累加）
+typedef struct {
+    uint64_t energy;        // Σx²
+    int64_t sum;            // Σx（直流偏移 = sum / samples）
+    int32_t peak;           // max |x|
+    uint32_t samples;
+} audio_stats_t;
+
+// 擷取任務每寫入一個 DMA 區塊就記一筆，檢測任務依樣本序號查詢任意範圍的統計
+// 容量必須涵蓋環形緩衝區（約 103 個區塊）加上一個切片（最多 50 個區塊）
+#define AUDIO_STATS_HISTORY     256     // 必須是 2 的次方
+
+typedef struct {
+    uint32_t end_count;     // 區塊結尾的寫入計數（audio_ring_write_count）
+    uint32_t samples;
+    uint64_t energy;
+    int32_t sum;
+    int32_t peak;
+} audio_stats_block_t;
+
+// 單一生產者 / 單一消費者，不使用鎖（同 audio_ring）
+typedef struct {
+    audio_stats_block_t blocks[AUDIO_STATS_HISTORY];
+    atomic_uint count;      // 已記錄的區塊總數
+} audio_stats_history_t;
+
+/**
+ * @brief 將 32-bit I2S 數據（24-bit 有效位）轉換為 16-bit，同時累計能量、峰值與直流
+ *        只走訪一次輸入；stats 會累加，不會先清零
+ */
+void audio_convert_i2s32(const int32_t *input, int16_t *output, size_t length, audio_stats_t *stats);
+
+/**
+ * @brief 累計 16-bit 音訊的統計（stats 會累加）
+ */
+void audio_stats_accumulate(audio_stats_t *stats, const int16_t *data, size_t length);
+
+/**
+ * @brief 合併兩段統計：dst += src
+ */
+void audio_stats_merge(audio_stats_t *dst, const audio_stats_t *src);
+
+/**
+ * @brief 平均能量 Σx² / N（與舊的 calculate_energy 相同尺度）
+ */
+int64_t audio_stats_mean_energy(const audio_stats_t *stats);
+
+/**
+ * @brief 直流偏移 Σx / N
+ */
+int32_t audio_stats_dc(const audio_stats_t *stats);
+
+/**
+ * @brief 記錄一個區塊（只能由生產者呼叫）
+ * @param end_count 區塊最後一個樣本之後的寫入計數
+ */
+void audio_stats_history_push(audio_stats_history_t *history, uint32_t end_count, const audio_stats_t *block);
+
+/**
+ * @brief 查詢寫入計數 (start_count, end_count] 之間結束的區塊統計總和（只能由消費者呼叫）
+ *        區塊邊界不一定對齊範圍，誤差最多一個區塊
+ * @return true 找到至少一個區塊
+ */
+bool audio_stats_history_range(audio_stats_history_t *history, uint32_t start_count, uint32_t end_count,
+                               audio_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_STATS_H
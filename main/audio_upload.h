@@ -31,4 +31,28 @@ esp_err_t upload_audio_with_location(const char* url,
                                      char* response_buffer,
                                      size_t response_size);
 
+// 串流上傳（HTTP chunked transfer encoding）：錄音期間邊錄邊送，不需要整段音訊的緩衝區
+// 用法：begin → write（可多次）→ finish；中途失敗或放棄時呼叫 abort
+// WAV 頭的長度欄位填最大值（總長度在開始時未知），伺服器讀到請求結束為止
+typedef struct audio_upload_stream audio_upload_stream_t;
+
+// 建立連線並送出 WAV 頭；成功時 *out 為串流狀態
+esp_err_t audio_upload_stream_begin(const char* url,
+                                    const char* api_key,
+                                    uint32_t sample_rate,
+                                    audio_upload_stream_t** out);
+
+// 送出一段 PCM（每 2 KB 一個 chunk）；失敗後只能呼叫 abort
+esp_err_t audio_upload_stream_write(audio_upload_stream_t* stream,
+                                    const int16_t* audio_data,
+                                    size_t audio_len);
+
+// 送出結束 chunk 並等待伺服器響應（同 upload_audio_json）；無論成功與否都會釋放 stream
+esp_err_t audio_upload_stream_finish(audio_upload_stream_t* stream,
+                                     char* response_buffer,
+                                     size_t response_size);
+
+// 關閉連線並釋放 stream（stream 可為 NULL）
+void audio_upload_stream_abort(audio_upload_stream_t* stream);
+
 #endif // AUDIO_UPLOAD_H
@@ -2,7 +2,10 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_http_client.h"
 #include "mbedtls/base64.h"
 #include "cJSON.h"
@@ -412,3 +415,218 @@ esp_err_t upload_audio_with_location(const char* url,
         return ESP_FAIL;
     }
 }
+
+// ===== 串流上傳（HTTP chunked transfer encoding）=====
+// 錄音期間邊錄邊送，說完只需要送出結尾的幾個 chunk，不必先錄完整段音訊
+
+#define STREAM_CHUNK_BYTES      2048    // 每個 chunk 的 PCM 大小（與上面的分塊上傳相同）
+#define STREAM_WRITE_RETRIES    5       // 連續寫入失敗這麼多次就放棄
+
+struct audio_upload_stream {
+    esp_http_client_handle_t client;
+    size_t pcm_bytes;               // 已送出的 PCM
+    int64_t open_us;                // 開始連線的時間
+    // chunk 大小（十六進位）+ CRLF、資料、CRLF 組在一起，每個 chunk 只呼叫一次 esp_http_client_write
+    char frame[10 + STREAM_CHUNK_BYTES + 2];
+};
+
+// 寫完 len bytes，部分寫入時繼續寫剩下的
+static esp_err_t stream_write_all(esp_http_client_handle_t client, const char *data, size_t len)
+{
+    int consecutive_failures = 0;
+    while (len > 0) {
+        int written = esp_http_client_write(client, data, len);
+        if (written <= 0) {
+            if (++consecutive_failures >= STREAM_WRITE_RETRIES) {
+                ESP_LOGE(TAG, "❌ 串流寫入連續失敗 %d 次，放棄", consecutive_failures);
+                return ESP_FAIL;
+            }
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+        consecutive_failures = 0;
+        data += written;
+        len -= written;
+    }
+    return ESP_OK;
+}
+
+// 送出一個 chunk：<大小>\r\n<資料>\r\n
+static esp_err_t stream_write_chunk(audio_upload_stream_t *stream, const void *data, size_t len)
+{
+    int head = snprintf(stream->frame, 10, "%x\r\n", (unsigned)len);
+    memcpy(stream->frame + head, data, len);
+    memcpy(stream->frame + head + len, "\r\n", 2);
+    return stream_write_all(stream->client, stream->frame, head + len + 2);
+}
+
+// 等待並讀取伺服器響應（同 upload_audio_json），返回 HTTP 狀態碼，失敗返回 -1
+static int stream_read_response(esp_http_client_handle_t client, char *response_buffer, size_t response_size)
+{
+    int wait_count = 0;
+    int content_length = -1;
+    int status_code = -1;
+    
+    while (wait_count < 120) {
+        content_length = esp_http_client_fetch_headers(client);
+        status_code = esp_http_client_get_status_code(client);
+        if (status_code > 0) {
+            break;
+        }
+        if (wait_count % 10 == 0) {
+            ESP_LOGI(TAG, "⏳ 等待中... (%d 秒)", wait_count);
+        }
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        wait_count++;
+    }
+    
+    ESP_LOGI(TAG, "📊 HTTP 狀態碼: %d, Content-Length: %d", status_code, content_length);
+    if (status_code <= 0) {
+        ESP_LOGE(TAG, "❌ 連線超時或網絡錯誤（等待了 %d 秒）", wait_count);
+        return -1;
+    }
+    
+    // 伺服器也可能以 chunked 回應（沒有 Content-Length）
+    if (content_length > 0 || esp_http_client_is_chunked_response(client)) {
+        int buffer_size = (content_length > 0 && content_length < 4096) ? content_length + 1 : 4096;
+        char *temp_buffer = malloc(buffer_size);
+        if (temp_buffer) {
+            int read_len = esp_http_client_read(client, temp_buffer, buffer_size - 1);
+            if (read_len > 0) {
+                temp_buffer[read_len] = '\0';
+                ESP_LOGI(TAG, "📨 伺服器響應: %s", temp_buffer);
+                
+                if (response_buffer && response_size > 0) {
+                    size_t copy_len = (read_len < response_size - 1) ? read_len : response_size - 1;
+                    memcpy(response_buffer, temp_buffer, copy_len);
+                    response_buffer[copy_len] = '\0';
+                }
+            }
+            free(temp_buffer);
+        }
+    }
+    return status_code;
+}
+
+esp_err_t audio_upload_stream_begin(const char* url,
+                                    const char* api_key,
+                                    uint32_t sample_rate,
+                                    audio_upload_stream_t** out)
+{
+    *out = NULL;
+    audio_upload_stream_t *stream = calloc(1, sizeof(audio_upload_stream_t));
+    if (stream == NULL) {
+        ESP_LOGE(TAG, "❌ 無法分配串流上傳狀態");
+        return ESP_ERR_NO_MEM;
+    }
+    stream->open_us = esp_timer_get_time();
+    
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = 120000,  // 伺服器在收到最後一個 chunk 後才開始處理（Whisper + ChatGPT + TTS）
+        .skip_cert_common_name_check = true,
+        .buffer_size = 8192,
+        .buffer_size_tx = 4096,
+        .keep_alive_enable = true,
+        .keep_alive_idle = 10,
+        .keep_alive_interval = 10,
+        .keep_alive_count = 3,
+    };
+    
+    stream->client = esp_http_client_init(&config);
+    if (stream->client == NULL) {
+        ESP_LOGE(TAG, "❌ HTTP 客戶端初始化失敗");
+        free(stream);
+        return ESP_FAIL;
+    }
+    
+    esp_http_client_set_header(stream->client, "Content-Type", "audio/wav");
+    esp_http_client_set_header(stream->client, "X-API-KEY", api_key);
+    
+    // write_len < 0：esp_http_client 送出 Transfer-Encoding: chunked，chunk 格式由這裡自己組
+    ESP_LOGI(TAG, "🔌 開啟 HTTP 連線（chunked 串流）...");
+    esp_err_t err = esp_http_client_open(stream->client, -1);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 無法開啟 HTTP 連線: %s", esp_err_to_name(err));
+        esp_http_client_cleanup(stream->client);
+        free(stream);
+        return err;
+    }
+    
+    // 總長度未知：RIFF 與 data 長度填最大值（串流 WAV 的慣例，解碼器會讀到資料結束為止）
+    uint8_t wav_header[44];
+    create_wav_header(wav_header, 0xFFFFFFFF - 36, sample_rate);
+    err = stream_write_chunk(stream, wav_header, sizeof(wav_header));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ WAV 頭寫入失敗");
+        audio_upload_stream_abort(stream);
+        return err;
+    }
+    
+    ESP_LOGI(TAG, "✅ 連線已建立（%lld ms），開始串流 WAV",
+             (long long)((esp_timer_get_time() - stream->open_us) / 1000));
+    *out = stream;
+    return ESP_OK;
+}
+
+esp_err_t audio_upload_stream_write(audio_upload_stream_t* stream,
+                                    const int16_t* audio_data,
+                                    size_t audio_len)
+{
+    const uint8_t *data = (const uint8_t *)audio_data;
+    size_t bytes = audio_len * sizeof(int16_t);
+    
+    while (bytes > 0) {
+        size_t n = bytes > STREAM_CHUNK_BYTES ? STREAM_CHUNK_BYTES : bytes;
+        esp_err_t err = stream_write_chunk(stream, data, n);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "❌ 串流中斷（已發送 %zu bytes）", stream->pcm_bytes);
+            return err;
+        }
+        stream->pcm_bytes += n;
+        data += n;
+        bytes -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t audio_upload_stream_finish(audio_upload_stream_t* stream,
+                                     char* response_buffer,
+                                     size_t response_size)
+{
+    // 最後一個 chunk（長度 0）結束請求
+    esp_err_t err = stream_write_all(stream->client, "0\r\n\r\n", 5);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 結束 chunk 寫入失敗");
+        audio_upload_stream_abort(stream);
+        return err;
+    }
+    
+    ESP_LOGI(TAG, "✅ 已串流完整 WAV (%zu bytes，連線 %lld ms)", 44 + stream->pcm_bytes,
+             (long long)((esp_timer_get_time() - stream->open_us) / 1000));
+    ESP_LOGI(TAG, "⏳ 等待伺服器響應（可能需要 30-60 秒處理 AI...）");
+    
+    int status_code = stream_read_response(stream->client, response_buffer, response_size);
+    
+    esp_http_client_close(stream->client);
+    esp_http_client_cleanup(stream->client);
+    free(stream);
+    
+    if (status_code == 200 || status_code == 201) {
+        ESP_LOGI(TAG, "✅ 上傳成功");
+        return ESP_OK;
+    }
+    ESP_LOGE(TAG, "❌ 上傳失敗: status=%d", status_code);
+    return ESP_FAIL;
+}
+
+void audio_upload_stream_abort(audio_upload_stream_t* stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+    esp_http_client_close(stream->client);
+    esp_http_client_cleanup(stream->client);
+    free(stream);
+}
@@ -1,16 +1,186 @@
 #include "ei_wrapper.h"
 #include "edge-impulse-sdk/classifier/ei_run_classifier.h"
+#include "edge-impulse-sdk/porting/espressif/ei_esp_nn_stats.h"
+#if EI_CLASSIFIER_OP_PROFILE
+#include "edge-impulse-sdk/porting/espressif/ei_op_profile.h"
+#include <stdio.h>
+#endif
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <math.h>
+#include <string.h>
+#if LEMON_WAKE_MFE_VALIDATE
+#include <dirent.h>
+#include <stdio.h>
+#include <strings.h>
+#endif
 
 static const char *TAG = "EI_WRAPPER";
 
+#if (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW != 2) && (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW != 4) && \
+    (EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW != 8)
+#error "EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW 必須是 2、4 或 8"
+#endif
+
+#if !EIDSP_MFE_Q15
+// 連續推理時送入的切片（由 signal.get_data 讀取）
+static int16_t *s_slice_data = NULL;
+#endif
+
+// 模型實際執行的次數與累計耗時（算子耗時表的分母）
+static uint32_t s_nn_runs = 0;
+static int64_t s_nn_total_us = 0;
+static bool s_session_open = false; // 常駐模型是否建立成功
+
+static void account_nn_time(const ei_impulse_result_t *result) {
+    // 連續推理在窗口填滿前不會執行模型，classification_us 為 0
+    if (result->timing.classification_us > 0) {
+        s_nn_runs++;
+        s_nn_total_us += result->timing.classification_us;
+    }
+}
+
+#if !EIDSP_MFE_Q15
+static int slice_get_data(size_t offset, size_t length, float *out_ptr) {
+    for (size_t i = 0; i < length; i++) {
+        out_ptr[i] = (float)s_slice_data[offset + i];
+    }
+    return 0;
+}
+#endif
+
+// 編譯後 (EON) 模型的 learning block 設定
+static ei_learning_block_config_tflite_graph_t *eon_block_config(void) {
+    return (ei_learning_block_config_tflite_graph_t*)ei_default_impulse.impulse->learning_blocks[0].config;
+}
+
+#if EI_CLASSIFIER_LABEL_COUNT > EI_WRAPPER_MAX_LABELS
+#error "EI_WRAPPER_MAX_LABELS 小於模型的分類數"
+#endif
+
+// 判斷設定：目標分類與信心門檻（ei_wrapper_set_detection 可在執行時修改）
+static int s_target_idx = 0;
+static float s_threshold = 0.8f;
+
+// int8 輸出張量的量化參數，門檻在設定時就換算成 int8（分數 >= s_threshold_q 才算超過門檻）
+static float s_out_scale = 0.0f;
+static int32_t s_out_zero_point = 0;
+static int s_threshold_q = INT8_MAX + 1;
+static bool s_out_quantized = false;
+
+// 最近一次模型輸出的 int8 分數，只有要印出時才換算成 float
+static int8_t s_last_q[EI_CLASSIFIER_LABEL_COUNT];
+static bool s_has_scores = false;
+
+// 最小的 q 使 (q - zero_point) * scale > threshold，與 float 比較結果完全一致
+static int quantize_threshold(float threshold) {
+    for (int q = INT8_MIN; q <= INT8_MAX; q++) {
+        if ((float)(q - s_out_zero_point) * s_out_scale > threshold) {
+            return q;
+        }
+    }
+    return INT8_MAX + 1; // 門檻高於最大分數，永遠不觸發
+}
+
+// 取得最近一次推理的 int8 分數：常駐模型直接讀輸出張量，否則由 float 結果換回 int8
+static bool read_scores_q(const ei_impulse_result_t *result) {
+    TfLiteTensor output;
+    if (ei_tflite_eon_session_output(eon_block_config()->output_tensors_indices[0], &output) == EI_IMPULSE_OK &&
+        output.type == kTfLiteInt8) {
+        memcpy(s_last_q, output.data.int8, EI_CLASSIFIER_LABEL_COUNT);
+        return true;
+    }
+    if (!s_out_quantized) {
+        return false;
+    }
+    for (size_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
+        int32_t q = (int32_t)lroundf(result->classification[i].value / s_out_scale) + s_out_zero_point;
+        s_last_q[i] = (int8_t)(q < INT8_MIN ? INT8_MIN : (q > INT8_MAX ? INT8_MAX : q));
+    }
+    return true;
+}
+
+// 在 int8 上找出最高分的分類，只有目標分類且超過門檻時返回其索引，否則返回 -1
+static int pick_best_label(const ei_impulse_result_t *result) {
+    // 連續推理在窗口填滿前不會執行模型，沒有新的分數
+    if (result->timing.classification_us == 0) {
+        return -1;
+    }
+    s_has_scores = read_scores_q(result);
+    if (!s_has_scores) {
+        return -1;
+    }
+
+    int best_idx = -1;
+    int best_q = s_out_zero_point; // 相當於 float 分數 0
+    for (size_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
+        if (s_last_q[i] > best_q) {
+            best_q = s_last_q[i];
+            best_idx = i;
+        }
+    }
+
+    if (best_idx == s_target_idx && best_q >= s_threshold_q) {
+        return best_idx;
+    }
+
+    return -1; // 未偵測到、信心不足或最高分是其他分類（例如 noise）
+}
+
 void ei_wrapper_init(void) {
-    ESP_LOGI(TAG, "Edge Impulse 模型初始化完成");
+    run_classifier_init();
+#if EI_CLASSIFIER_OP_PROFILE
+    ei_op_profile_reset();
+#endif
+
+    // 建立常駐模型：arena 與每個算子的 prepare 結果在推理之間保留，
+    // 不再每次推理都 init → invoke → reset
+    // 先量一次 open（init + prepare）與 close（reset），即沒有常駐模型時每次推理的額外開銷
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    uint64_t start_us = ei_read_timer_us();
+    EI_IMPULSE_ERROR res = ei_tflite_eon_session_open(eon_block_config());
+    uint64_t init_us = ei_read_timer_us() - start_us;
+    size_t arena_bytes = free_before - heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    uint64_t reset_us = 0;
+    if (res == EI_IMPULSE_OK) {
+        start_us = ei_read_timer_us();
+        ei_tflite_eon_session_close();
+        reset_us = ei_read_timer_us() - start_us;
+        res = ei_tflite_eon_session_open(eon_block_config());
+    }
+    s_session_open = (res == EI_IMPULSE_OK);
+    if (res != EI_IMPULSE_OK) {
+        ESP_LOGE(TAG, "常駐模型初始化失敗: %d（改為每次推理重新初始化）", res);
+    } else {
+        ESP_LOGI(TAG, "常駐模型已建立: 無常駐模型時每次推理開銷 %llu us（init + prepare %llu us, reset %llu us）, 內部 RAM 使用 %zu bytes",
+                 (unsigned long long)(init_us + reset_us), (unsigned long long)init_us,
+                 (unsigned long long)reset_us, arena_bytes);
+    }
+
+    // 輸出張量的量化參數只讀模型描述，不需要常駐模型
+    s_out_quantized = ei_tflite_eon_output_quantization(eon_block_config(), eon_block_config()->output_tensors_indices[0],
+                                                        &s_out_scale, &s_out_zero_point) == EI_IMPULSE_OK;
+    if (!s_out_quantized) {
+        ESP_LOGE(TAG, "模型輸出不是 int8，無法判斷分類");
+    } else {
+        s_threshold_q = quantize_threshold(s_threshold);
+    }
+    s_has_scores = false;
+
+    ESP_LOGI(TAG, "Edge Impulse 模型初始化完成（連續推理: 每窗口 %d 切片, 每切片 %d 樣本）",
+             EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW, EI_CLASSIFIER_SLICE_SIZE);
+}
+
+void ei_wrapper_deinit(void) {
+    ei_tflite_eon_session_close();
+    s_session_open = false;
+    run_classifier_deinit();
+    ESP_LOGI(TAG, "Edge Impulse 模型已釋放");
 }
 
 int ei_wrapper_run_inference(int16_t *raw_data, size_t data_len) {
     if (data_len != EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE) {
-        ESP_LOGE(TAG, "輸入長度錯誤! 需要: %d, 收到: %d", 
+        ESP_LOGE(TAG, "輸入長度錯誤! 需要: %d, 收到: %d",
                  EI_CLASSIFIER_DSP_INPUT_FRAME_SIZE, data_len);
         return -1;
     }
@@ -33,26 +203,417 @@ int ei_wrapper_run_inference(int16_t *raw_data, size_t data_len) {
         ESP_LOGE(TAG, "推理錯誤: %d", res);
         return -1;
     }
+    account_nn_time(&result);
 
-    // 找出最高分的分類
-    int best_idx = -1;
-    float best_score = 0.0f;
+    return pick_best_label(&result);
+}
+
+int ei_wrapper_run_inference_slice(int16_t *slice_data, size_t data_len) {
+    if (data_len != EI_CLASSIFIER_SLICE_SIZE) {
+        ESP_LOGE(TAG, "切片長度錯誤! 需要: %d, 收到: %d",
+                 EI_CLASSIFIER_SLICE_SIZE, data_len);
+        return -1;
+    }
+
+    ei_impulse_result_t result = { 0 };
+
+    // 只對新切片做 DSP，滾動特徵矩陣填滿一個窗口後才會執行模型
+#if EIDSP_MFE_Q15
+    // 定點 MFE 前端直接讀 int16 樣本，不經過 float 轉換
+    EI_IMPULSE_ERROR res = run_classifier_continuous_i16(slice_data, data_len, &result, false);
+#else
+    s_slice_data = slice_data;
+
+    signal_t signal;
+    signal.total_length = EI_CLASSIFIER_SLICE_SIZE;
+    signal.get_data = &slice_get_data;
+
+    EI_IMPULSE_ERROR res = run_classifier_continuous(&signal, &result, false);
+    s_slice_data = NULL;
+#endif
+    if (res != EI_IMPULSE_OK) {
+        ESP_LOGE(TAG, "連續推理錯誤: %d", res);
+        return -1;
+    }
+    account_nn_time(&result);
+
+    ESP_LOGD(TAG, "切片耗時: DSP %lld us, 推理 %lld us",
+             (long long)result.timing.dsp_us, (long long)result.timing.classification_us);
+
+    return pick_best_label(&result);
+}
+
+void ei_wrapper_reset_stream(void) {
+    run_classifier_init();
+    s_has_scores = false;
+}
+
+int ei_wrapper_set_detection(const char *label, float threshold) {
+    if (label == NULL || threshold < 0.0f || threshold >= 1.0f) {
+        ESP_LOGE(TAG, "判斷設定錯誤: 門檻必須在 0 ~ 1 之間");
+        return -1;
+    }
+
+    int idx = -1;
     for (size_t i = 0; i < EI_CLASSIFIER_LABEL_COUNT; i++) {
-        // 如果您想看每個分類的分數，取消下面這行的註釋
-        // ESP_LOGI(TAG, "%s: %.2f", result.classification[i].label, result.classification[i].value);
-        if (result.classification[i].value > best_score) {
-            best_score = result.classification[i].value;
-            best_idx = i;
+        if (strcmp(ei_classifier_inferencing_categories[i], label) == 0) {
+            idx = i;
+            break;
         }
     }
+    if (idx < 0) {
+        ESP_LOGE(TAG, "判斷設定錯誤: 沒有分類 \"%s\"", label);
+        return -1;
+    }
 
-    // 設定信心門檻 (0.8 = 80%)
-    if (best_score > 0.8f) {
-        return best_idx;
+    s_target_idx = idx;
+    s_threshold = threshold;
+    if (s_out_quantized) {
+        s_threshold_q = quantize_threshold(threshold);
+        ESP_LOGI(TAG, "🎚️ 判斷設定: \"%s\" > %.2f（int8 門檻 %d）", label, threshold, s_threshold_q);
+    }
+    return 0;
+}
+
+size_t ei_wrapper_get_last_scores(float *scores, size_t max_scores) {
+    if (!s_has_scores || scores == NULL) {
+        return 0;
     }
+    size_t count = max_scores < EI_CLASSIFIER_LABEL_COUNT ? max_scores : EI_CLASSIFIER_LABEL_COUNT;
+    for (size_t i = 0; i < count; i++) {
+        scores[i] = (float)(s_last_q[i] - s_out_zero_point) * s_out_scale;
+    }
+    return count;
+}
 
-    return -1; // 未偵測到或信心不足
+size_t ei_wrapper_get_slice_size(void) {
+    return EI_CLASSIFIER_SLICE_SIZE;
+}
+
+size_t ei_wrapper_get_slices_per_window(void) {
+    return EI_CLASSIFIER_SLICES_PER_MODEL_WINDOW;
+}
+
+void ei_wrapper_log_kernel_stats(void) {
+    if (s_nn_runs == 0) {
+        ESP_LOGI(TAG, "模型尚未執行，沒有算子耗時資料");
+        return;
+    }
+
+    ESP_LOGI(TAG, "int8 算子耗時（核心: %s，模型執行 %lu 次，平均 %lld us/次）",
+             ei_esp_nn_kernel_name(), (unsigned long)s_nn_runs, (long long)(s_nn_total_us / s_nn_runs));
+    ESP_LOGI(TAG, "%-18s %10s %6s %8s %8s", "算子", "us/次", "佔比", "驗證", "不一致");
+    for (int op = 0; op < EI_ESP_NN_OP_COUNT; op++) {
+        const ei_esp_nn_op_stats_t *stats = ei_esp_nn_get_stats((ei_esp_nn_op_t)op);
+        ESP_LOGI(TAG, "%-18s %10lld %5lld%% %8lu %8lu",
+                 ei_esp_nn_op_name((ei_esp_nn_op_t)op),
+                 (long long)(stats->total_us / s_nn_runs),
+                 (long long)(stats->total_us * 100 / s_nn_total_us),
+                 (unsigned long)stats->verified, (unsigned long)stats->mismatches);
+    }
+
+    // 實測每次推理在 invoke 以外的開銷：有常駐模型時只剩張量查找
+    ei_tflite_eon_overhead_t overhead;
+    ei_tflite_eon_get_overhead(&overhead);
+    if (overhead.inferences > 0) {
+        ESP_LOGI(TAG, "⏱️ 每次推理額外開銷（%s，%lu 次）: setup %llu us, teardown %llu us",
+                 s_session_open ? "常駐模型" : "每次重新初始化",
+                 (unsigned long)overhead.inferences,
+                 (unsigned long long)(overhead.setup_us / overhead.inferences),
+                 (unsigned long long)(overhead.teardown_us / overhead.inferences));
+    }
+}
+
+size_t ei_wrapper_get_op_profile(ei_wrapper_op_profile_t *ops, size_t max_ops, uint32_t *inferences) {
+#if EI_CLASSIFIER_OP_PROFILE
+    const ei_op_profile_t *profile = ei_op_profile_get();
+    if (profile == NULL) {
+        if (inferences != NULL) {
+            *inferences = 0;
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < profile->op_count && i < max_ops; i++) {
+        const ei_op_profile_entry_t *entry = &profile->ops[i];
+        ei_wrapper_op_profile_t *out = &ops[i];
+        out->op = entry->op;
+        out->input_dims = entry->input_dims;
+        out->output_dims = entry->output_dims;
+        for (int d = 0; d < EI_WRAPPER_OP_MAX_DIMS; d++) {
+            out->input_shape[d] = d < entry->input_dims ? entry->input_shape[d] : 0;
+            out->output_shape[d] = d < entry->output_dims ? entry->output_shape[d] : 0;
+        }
+        out->min_cycles = entry->min_cycles;
+        out->avg_cycles = (uint32_t)(entry->total_cycles / profile->inferences);
+        out->max_cycles = entry->max_cycles;
+    }
+    if (inferences != NULL) {
+        *inferences = profile->inferences;
+    }
+    return profile->op_count;
+#else
+    if (inferences != NULL) {
+        *inferences = 0;
+    }
+    return 0;
+#endif
+}
+
+#if EI_CLASSIFIER_OP_PROFILE
+// 形狀寫成 "1x99x40x1"
+static void format_shape(char *buf, size_t size, const uint16_t *shape, int dims) {
+    int len = 0;
+    buf[0] = '\0';
+    for (int d = 0; d < dims && len < (int)size; d++) {
+        len += snprintf(buf + len, size - len, d == 0 ? "%u" : "x%u", (unsigned)shape[d]);
+    }
+}
+#endif
+
+void ei_wrapper_log_op_profile(void) {
+#if EI_CLASSIFIER_OP_PROFILE
+    static uint32_t s_logged_window = 0;
+    const ei_op_profile_t *profile = ei_op_profile_get();
+    if (profile == NULL || profile->window == s_logged_window) {
+        return;
+    }
+    s_logged_window = profile->window;
+
+    uint64_t avg_total = profile->total_cycles / profile->inferences;
+    ESP_LOGI(TAG, "逐算子 CPU 週期（第 %lu 個窗口，%lu 次推理）：整個模型 min %lu / avg %llu / max %lu",
+             (unsigned long)profile->window, (unsigned long)profile->inferences,
+             (unsigned long)profile->min_cycles, (unsigned long long)avg_total, (unsigned long)profile->max_cycles);
+    ESP_LOGI(TAG, "%3s %-18s %-12s %-12s %10s %10s %10s %6s", "#", "算子", "輸入", "輸出",
+             "min", "avg", "max", "佔比");
+    for (size_t i = 0; i < profile->op_count; i++) {
+        const ei_op_profile_entry_t *entry = &profile->ops[i];
+        char in[24];
+        char out[24];
+        format_shape(in, sizeof(in), entry->input_shape, entry->input_dims);
+        format_shape(out, sizeof(out), entry->output_shape, entry->output_dims);
+        uint64_t avg = entry->total_cycles / profile->inferences;
+        ESP_LOGI(TAG, "%3u %-18s %-12s %-12s %10lu %10llu %10lu %5.1f%%", (unsigned)i, entry->op, in, out,
+                 (unsigned long)entry->min_cycles, (unsigned long long)avg, (unsigned long)entry->max_cycles,
+                 avg_total > 0 ? (double)avg * 100.0 / (double)avg_total : 0.0);
+    }
+#endif
+}
+
+#if LEMON_WAKE_MFE_VALIDATE
+// 驗收標準：每個特徵與 float 前端最多差 2 個量化階（1/256），且至少 99% 完全相同
+#define MFE_VALIDATE_MAX_DELTA      2
+#define MFE_VALIDATE_MIN_EXACT_PCT  99.0
+
+// 比對結果（Δ = q15 − float，單位為 1/256 量化階）
+typedef struct {
+    uint32_t features;
+    uint32_t exact;
+    uint32_t delta_1;       // |Δ| = 1
+    uint32_t delta_2;       // |Δ| = 2
+    uint32_t delta_more;    // |Δ| > 2
+    int max_abs_delta;
+} mfe_compare_t;
+
+static const int16_t *s_wav_slice = NULL;
+
+static int wav_slice_get_data(size_t offset, size_t length, float *out_ptr) {
+    for (size_t i = 0; i < length; i++) {
+        out_ptr[i] = (float)s_wav_slice[offset + i];
+    }
+    return 0;
+}
+
+// 跳到 WAV 的 data 區塊，只接受 16 kHz、單聲道、16-bit PCM；返回樣本數，格式不符返回 0
+static size_t wav_seek_pcm16(FILE *f) {
+    uint8_t riff[12];
+    if (fread(riff, 1, sizeof(riff), f) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return 0;
+    }
+
+    bool format_ok = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, sizeof(chunk), f) == sizeof(chunk)) {
+        uint32_t chunk_size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16) {
+            uint8_t fmt[16];
+            if (fread(fmt, 1, sizeof(fmt), f) != sizeof(fmt)) {
+                return 0;
+            }
+            uint16_t audio_format = fmt[0] | (fmt[1] << 8);
+            uint16_t channels = fmt[2] | (fmt[3] << 8);
+            uint32_t sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            uint16_t bits = fmt[14] | (fmt[15] << 8);
+            format_ok = audio_format == 1 && channels == 1 && bits == 16 &&
+                        sample_rate == EI_CLASSIFIER_FREQUENCY;
+            chunk_size -= sizeof(fmt);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            return format_ok ? chunk_size / sizeof(int16_t) : 0;
+        }
+        // 區塊長度為奇數時有 1 byte 填充
+        if (fseek(f, chunk_size + (chunk_size & 1), SEEK_CUR) != 0) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// 同一段 WAV 分別送進 float 與 q15 前端，逐特徵比對正規化後的量化階
+static void mfe_compare_file(FILE *f, size_t samples, int16_t *slice,
+                             matrix_t *float_rows, matrix_t *q15_rows, mfe_compare_t *cmp) {
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)ei_default_impulse.impulse->dsp_blocks[0].config;
+    const float frequency = ei_default_impulse.impulse->frequency;
+    const size_t cols = config->num_filters;
+    const size_t matrix_size = float_rows->rows * float_rows->cols;
+
+    // 每個檔案都是新的串流
+    ei_dsp_clear_continuous_audio_state();
+
+    for (size_t done = 0; done + EI_CLASSIFIER_SLICE_SIZE <= samples; done += EI_CLASSIFIER_SLICE_SIZE) {
+        if (fread(slice, sizeof(int16_t), EI_CLASSIFIER_SLICE_SIZE, f) != EI_CLASSIFIER_SLICE_SIZE) {
+            return;
+        }
+        s_wav_slice = slice;
+
+        signal_t signal;
+        signal.total_length = EI_CLASSIFIER_SLICE_SIZE;
+        signal.get_data = &wav_slice_get_data;
+
+        matrix_size_t float_size = { 0, 0 };
+        matrix_size_t q15_size = { 0, 0 };
+        int ret = extract_mfe_per_slice_features(&signal, float_rows, config, frequency, &float_size);
+        if (ret == EIDSP_OK) {
+            ret = extract_mfe_per_slice_features_q15(&signal, q15_rows, config, frequency, &q15_size);
+        }
+        s_wav_slice = NULL;
+        if (ret != EIDSP_OK || float_size.rows != q15_size.rows) {
+            ESP_LOGE(TAG, "MFE 比對失敗: 錯誤 %d, 幀數 float %u / q15 %u",
+                     ret, (unsigned)float_size.rows, (unsigned)q15_size.rows);
+            return;
+        }
+
+        // 兩邊都把新幀寫在矩陣最後面；float 幀再做與模型相同的正規化
+        const size_t count = float_size.rows * cols;
+        matrix_t normalized(float_size.rows, cols, float_rows->buffer + matrix_size - count);
+        speechpy::processing::mfe_normalization(&normalized, config->noise_floor_db);
+
+        const float *q15 = q15_rows->buffer + matrix_size - count;
+        for (size_t i = 0; i < count; i++) {
+            int delta = (int)lrintf(q15[i] * 256.0f) - (int)lrintf(normalized.buffer[i] * 256.0f);
+            int abs_delta = delta < 0 ? -delta : delta;
+            cmp->features++;
+            if (abs_delta == 0) {
+                cmp->exact++;
+            } else if (abs_delta == 1) {
+                cmp->delta_1++;
+            } else if (abs_delta == 2) {
+                cmp->delta_2++;
+            } else {
+                cmp->delta_more++;
+            }
+            if (abs_delta > cmp->max_abs_delta) {
+                cmp->max_abs_delta = abs_delta;
+            }
+        }
+    }
+}
+
+int ei_wrapper_validate_mfe(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        ESP_LOGE(TAG, "❌ 無法開啟 MFE 驗證資料夾: %s", dir);
+        return -1;
+    }
+
+    ei_dsp_config_mfe_t *config = (ei_dsp_config_mfe_t*)ei_default_impulse.impulse->dsp_blocks[0].config;
+    const size_t frame_stride = (size_t)(ei_default_impulse.impulse->frequency * config->frame_stride);
+    const size_t rows = EI_CLASSIFIER_SLICE_SIZE / frame_stride + 1;
+
+    int16_t *slice = (int16_t*)heap_caps_malloc(EI_CLASSIFIER_SLICE_SIZE * sizeof(int16_t), MALLOC_CAP_DEFAULT);
+    matrix_t float_rows(rows, config->num_filters);
+    matrix_t q15_rows(rows, config->num_filters);
+    if (!slice || !float_rows.buffer || !q15_rows.buffer) {
+        ESP_LOGE(TAG, "❌ MFE 驗證記憶體不足");
+        heap_caps_free(slice);
+        closedir(d);
+        return -1;
+    }
+
+    mfe_compare_t total = { 0 };
+    int files = 0;
+    char path[300];
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *ext = strrchr(entry->d_name, '.');
+        if (!ext || strcasecmp(ext, ".wav") != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+            continue;
+        }
+
+        size_t samples = wav_seek_pcm16(f);
+        if (samples < EI_CLASSIFIER_SLICE_SIZE) {
+            ESP_LOGW(TAG, "⚠️ 略過 %s（需要 16 kHz 單聲道 16-bit PCM，且至少一個切片長）", entry->d_name);
+            fclose(f);
+            continue;
+        }
+
+        mfe_compare_t cmp = { 0 };
+        mfe_compare_file(f, samples, slice, &float_rows, &q15_rows, &cmp);
+        fclose(f);
+        if (cmp.features == 0) {
+            continue;
+        }
+
+        ESP_LOGI(TAG, "📄 %s: %lu 個特徵, 完全相同 %.2f%%, 最大 |Δ| %d",
+                 entry->d_name, (unsigned long)cmp.features, 100.0 * cmp.exact / cmp.features, cmp.max_abs_delta);
+
+        total.features += cmp.features;
+        total.exact += cmp.exact;
+        total.delta_1 += cmp.delta_1;
+        total.delta_2 += cmp.delta_2;
+        total.delta_more += cmp.delta_more;
+        if (cmp.max_abs_delta > total.max_abs_delta) {
+            total.max_abs_delta = cmp.max_abs_delta;
+        }
+        files++;
+    }
+    closedir(d);
+    heap_caps_free(slice);
+
+    // 比對用掉了連續推理的狀態，監聽前重新開始
+    ei_wrapper_reset_stream();
+
+    if (total.features == 0) {
+        ESP_LOGW(TAG, "⚠️ %s 中沒有可用的 WAV 檔", dir);
+        return -1;
+    }
+
+    const double exact_pct = 100.0 * total.exact / total.features;
+    ESP_LOGI(TAG, "MFE q15 vs float: %d 個檔案, %lu 個特徵（Δ 單位: 1/256）", files, (unsigned long)total.features);
+    ESP_LOGI(TAG, "  Δ = 0   %10lu (%.3f%%)", (unsigned long)total.exact, exact_pct);
+    ESP_LOGI(TAG, "  |Δ| = 1 %10lu (%.3f%%)", (unsigned long)total.delta_1, 100.0 * total.delta_1 / total.features);
+    ESP_LOGI(TAG, "  |Δ| = 2 %10lu (%.3f%%)", (unsigned long)total.delta_2, 100.0 * total.delta_2 / total.features);
+    ESP_LOGI(TAG, "  |Δ| > 2 %10lu (%.3f%%)", (unsigned long)total.delta_more, 100.0 * total.delta_more / total.features);
+
+    if (total.max_abs_delta > MFE_VALIDATE_MAX_DELTA || exact_pct < MFE_VALIDATE_MIN_EXACT_PCT) {
+        ESP_LOGE(TAG, "❌ 超出容許誤差（最大 |Δ| %d > %d 或完全相同 %.2f%% < %.0f%%）",
+                 total.max_abs_delta, MFE_VALIDATE_MAX_DELTA, exact_pct, MFE_VALIDATE_MIN_EXACT_PCT);
+        return -1;
+    }
+    ESP_LOGI(TAG, "✅ 在容許誤差內（最大 |Δ| %d, 完全相同 %.2f%%）", total.max_abs_delta, exact_pct);
+    return 0;
+}
+#else
+int ei_wrapper_validate_mfe(const char *dir) {
+    ESP_LOGW(TAG, "MFE 驗證未編入（需要 -DLEMON_WAKE_MFE=q15 -DLEMON_WAKE_MFE_VALIDATE=ON）");
+    return -1;
 }
+#endif
 
 const char* ei_wrapper_get_label(int label_index) {
     if (label_index >= 0 && label_index < EI_CLASSIFIER_LABEL_COUNT) {
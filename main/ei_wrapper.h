@@ -8,15 +8,77 @@
 extern "C" {
 #endif
 
-// 初始化模型
+// 初始化模型（建立常駐模型並重置連續推理狀態）
 void ei_wrapper_init(void);
 
+// 釋放常駐模型（tensor arena 與算子狀態）
+void ei_wrapper_deinit(void);
+
+// 判斷設定：只有最高分是 label 且信心超過 threshold 時，推理才返回該分類
+// 門檻在設定時換算成 int8，之後直接比對模型的 int8 輸出（預設 "hi lemon"、0.8）
+// 返回值: 0 = 成功, -1 = 沒有這個分類或門檻不在 0 ~ 1 之間
+int ei_wrapper_set_detection(const char *label, float threshold);
+
 // 執行推理
 // raw_data: 16-bit PCM 音訊數據
 // data_len: 樣本數 (不是字節數)
-// 返回值: 識別到的分類 ID (-1 表示未知/噪音)
+// 返回值: 識別到的分類 ID (-1 表示未偵測到/信心不足/噪音)
 int ei_wrapper_run_inference(int16_t *raw_data, size_t data_len);
 
+// 連續推理：送入一個新切片，只計算新切片的 MFE 幀，舊幀沿用滾動特徵矩陣
+// slice_data: 16-bit PCM 音訊數據
+// data_len: 必須等於 ei_wrapper_get_slice_size()
+// 返回值: 識別到的分類 ID (-1 表示未偵測到/信心不足/噪音/窗口尚未填滿)
+int ei_wrapper_run_inference_slice(int16_t *slice_data, size_t data_len);
+
+// 模型的分類數上限（ei_wrapper_get_last_scores 的陣列大小）
+#define EI_WRAPPER_MAX_LABELS   8
+
+// 取得最近一次模型輸出的各分類分數（0 ~ 1），只在需要印出時才由 int8 換算成 float
+// scores: 輸出陣列，索引即分類 ID；max_scores: 陣列大小
+// 返回值: 填入的分數數，模型還沒執行過（或串流剛重置）時為 0
+size_t ei_wrapper_get_last_scores(float *scores, size_t max_scores);
+
+// 重置連續推理狀態（音訊串流中斷後呼叫，例如錄音上傳結束）
+void ei_wrapper_reset_stream(void);
+
+// 每個切片的樣本數
+size_t ei_wrapper_get_slice_size(void);
+
+// 每個模型窗口的切片數（2 / 4 / 8）
+size_t ei_wrapper_get_slices_per_window(void);
+
+// 印出 int8 算子耗時表（CONV_2D / DEPTHWISE_CONV_2D / FULLY_CONNECTED / MEAN，
+// 每次推理平均耗時、佔模型時間比例，以及驗證模式下與參考核心不一致的次數）
+void ei_wrapper_log_kernel_stats(void);
+
+// 逐算子 CPU 週期統計（LEMON_WAKE_OP_PROFILE 建置），每個 LEMON_WAKE_OP_PROFILE_WINDOW 次推理彙整一次
+#define EI_WRAPPER_OP_MAX_DIMS  4
+
+typedef struct {
+    const char *op;                                 // 算子類型，例如 "CONV_2D"
+    int input_dims;
+    int output_dims;
+    int input_shape[EI_WRAPPER_OP_MAX_DIMS];        // 第一個輸入張量的形狀
+    int output_shape[EI_WRAPPER_OP_MAX_DIMS];       // 第一個輸出張量的形狀
+    uint32_t min_cycles;
+    uint32_t avg_cycles;
+    uint32_t max_cycles;
+} ei_wrapper_op_profile_t;
+
+// 取得最近一個完整窗口的逐算子統計（陣列索引即算子索引），只能在執行推理的任務呼叫
+// ops: 輸出陣列，max_ops: 陣列大小，inferences: 窗口內的推理次數（可為 NULL）
+// 返回值: 算子數（超過 max_ops 時只填前 max_ops 個），沒有啟用或第一個窗口尚未完成時為 0
+size_t ei_wrapper_get_op_profile(ei_wrapper_op_profile_t *ops, size_t max_ops, uint32_t *inferences);
+
+// 印出最近一個完整窗口的逐算子統計表（沒有新窗口時不重複印）
+void ei_wrapper_log_op_profile(void);
+
+// 以資料夾中的 WAV 檔（16 kHz、單聲道、16-bit PCM）比對定點 q15 與 float MFE 前端，
+// 印出誤差分佈；只在 LEMON_WAKE_MFE_VALIDATE 建置中有作用
+// 返回值: 0 = 在容許誤差內, -1 = 超出容許誤差或沒有可用檔案
+int ei_wrapper_validate_mfe(const char *dir);
+
 // 取得分類名稱 (例如 "hi_lemon")
 const char* ei_wrapper_get_label(int label_index);
 
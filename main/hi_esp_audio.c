@@ -1,14 +1,36 @@
 #include "hi_esp_audio.h"
-#include "driver/i2s.h"
+#include "driver/i2s_std.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 #include <math.h>
 #include <string.h>
 
 static const char *TAG = "AUDIO";
 
+// MAX98357A 發送通道（audio_stop 後為 NULL）
+static i2s_chan_handle_t s_tx_chan = NULL;
+
+// 播放監聽（中斷中呼叫）
+static volatile audio_sent_tap_t s_sent_tap = NULL;
+
+// DMA 區塊送完（中斷中執行）：自動清除在回呼之後才做，dma_buf 仍是剛送出的內容
+static IRAM_ATTR bool on_i2s_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    audio_sent_tap_t tap = s_sent_tap;
+    if (tap != NULL) {
+        tap((const int16_t *)event->dma_buf, event->size / sizeof(int16_t), esp_timer_get_time());
+    }
+    return false;
+}
+
+void audio_set_sent_tap(audio_sent_tap_t tap)
+{
+    s_sent_tap = tap;
+}
+
 esp_err_t audio_init(void)
 {
     ESP_LOGI(TAG, "初始化 MAX98357A 音頻輸出...");
@@ -29,41 +51,63 @@ esp_err_t audio_init(void)
     ESP_LOGI(TAG, "SD 引腳保持懸空（預設工作模式）");
 #endif
     
-    // 使用舊版 I2S API 配置
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-        .sample_rate = I2S_SPEAKER_SAMPLE_RATE,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = I2S_COMM_FORMAT_STAND_I2S,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 256,
-        .use_apll = false,
-        .tx_desc_auto_clear = true,
-        .fixed_mclk = 0
+    // I2S 標準模式發送通道（與麥克風共用新版 i2s_std 驅動）
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_SPEAKER_NUM, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = I2S_SPEAKER_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = I2S_SPEAKER_DMA_FRAME_SAMPLES;
+    chan_cfg.auto_clear = true;     // 沒有資料時送出靜音
+    
+    esp_err_t ret = i2s_new_channel(&chan_cfg, &s_tx_chan, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2S 通道建立失敗: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(I2S_SPEAKER_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_SPEAKER_BCK_PIN,
+            .ws = I2S_SPEAKER_WS_PIN,
+            .dout = I2S_SPEAKER_DATA_PIN,
+            .din = I2S_GPIO_UNUSED,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
     };
-
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_SPEAKER_BCK_PIN,
-        .ws_io_num = I2S_SPEAKER_WS_PIN,
-        .data_out_num = I2S_SPEAKER_DATA_PIN,
-        .data_in_num = I2S_PIN_NO_CHANGE
+    std_cfg.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;
+    
+    ret = i2s_channel_init_std_mode(s_tx_chan, &std_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2S 標準模式配置失敗: %s", esp_err_to_name(ret));
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
+        return ret;
+    }
+    
+    // 回呼必須在啟用通道前註冊
+    i2s_event_callbacks_t cbs = {
+        .on_sent = on_i2s_sent,
     };
-
-    esp_err_t ret = i2s_driver_install(I2S_SPEAKER_NUM, &i2s_config, 0, NULL);
+    ret = i2s_channel_register_event_callback(s_tx_chan, &cbs, NULL);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2S 驅動安裝失敗: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "I2S 回呼註冊失敗: %s", esp_err_to_name(ret));
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
         return ret;
     }
-
-    ret = i2s_set_pin(I2S_SPEAKER_NUM, &pin_config);
+    
+    ret = i2s_channel_enable(s_tx_chan);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2S 設置引腳失敗: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "I2S 通道啟用失敗: %s", esp_err_to_name(ret));
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
         return ret;
     }
-
-    i2s_zero_dma_buffer(I2S_SPEAKER_NUM);
     
     ESP_LOGI(TAG, "✅ MAX98357A 初始化成功");
     ESP_LOGI(TAG, "📌 引腳: BCLK=%d, LRC=%d, DIN=%d", 
@@ -79,13 +123,37 @@ esp_err_t audio_init(void)
 
 esp_err_t audio_play(const int16_t *data, size_t length)
 {
-    size_t bytes_written = 0;
-    esp_err_t ret = i2s_write(I2S_SPEAKER_NUM, data, length * sizeof(int16_t), 
-                              &bytes_written, portMAX_DELAY);
+    return audio_play_until(data, length, NULL, NULL);
+}
+
+esp_err_t audio_play_until(const int16_t *data, size_t length, audio_stop_check_t should_stop, void *ctx)
+{
+    if (s_tx_chan == NULL) {
+        ESP_LOGE(TAG, "音頻輸出尚未初始化");
+        return ESP_ERR_INVALID_STATE;
+    }
     
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "寫入音頻數據失敗: %s", esp_err_to_name(ret));
-        return ret;
+    // 每次寫一個 DMA 區塊，寫入前檢查是否要停止
+    size_t bytes_written = 0;
+    size_t done = 0;
+    while (done < length) {
+        if (should_stop != NULL && should_stop(ctx)) {
+            ESP_LOGI(TAG, "播放中止（已播放 %d/%d 樣本）", done, length);
+            return ESP_ERR_NOT_FINISHED;
+        }
+        size_t n = length - done;
+        if (n > I2S_SPEAKER_DMA_FRAME_SAMPLES) {
+            n = I2S_SPEAKER_DMA_FRAME_SAMPLES;
+        }
+        size_t written = 0;
+        esp_err_t ret = i2s_channel_write(s_tx_chan, data + done, n * sizeof(int16_t),
+                                          &written, portMAX_DELAY);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "寫入音頻數據失敗: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        bytes_written += written;
+        done += n;
     }
     
     ESP_LOGD(TAG, "播放 %d 字節音頻數據", bytes_written);
@@ -174,6 +242,12 @@ esp_err_t audio_play_wav_file(const char *file_path)
 }
 
 esp_err_t audio_play_wav_buffer(const uint8_t *wav_data, size_t wav_size)
+{
+    return audio_play_wav_buffer_until(wav_data, wav_size, NULL, NULL);
+}
+
+esp_err_t audio_play_wav_buffer_until(const uint8_t *wav_data, size_t wav_size,
+                                      audio_stop_check_t should_stop, void *ctx)
 {
     if (wav_size < 44) {
         ESP_LOGE(TAG, "WAV 數據太小");
@@ -192,12 +266,16 @@ esp_err_t audio_play_wav_buffer(const uint8_t *wav_data, size_t wav_size)
     
     ESP_LOGI(TAG, "播放 WAV 數據: %d 樣本", audio_samples);
     
-    return audio_play(audio_data, audio_samples);
+    return audio_play_until(audio_data, audio_samples, should_stop, ctx);
 }
 
 void audio_stop(void)
 {
-    i2s_driver_uninstall(I2S_SPEAKER_NUM);
+    if (s_tx_chan != NULL) {
+        i2s_channel_disable(s_tx_chan);
+        i2s_del_channel(s_tx_chan);
+        s_tx_chan = NULL;
+    }
     
 #ifdef USE_SD_PIN_CONTROL
     // 關閉放大器以節省電力
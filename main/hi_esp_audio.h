@@ -3,6 +3,8 @@
 
 #include "esp_err.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,10 +18,27 @@ extern "C" {
 #define I2S_SPEAKER_SD_PIN      GPIO_NUM_17  // SD (原 19)
 #define I2S_SPEAKER_SAMPLE_RATE 16000
 
+// 播放 DMA：區塊小一點，回音消除的參考訊號延遲較短，中止播放時剩下的音訊也較少
+#define I2S_SPEAKER_DMA_DESC_NUM        16
+#define I2S_SPEAKER_DMA_FRAME_SAMPLES   80      // 5 ms
+
 // SD 引腳控制選項
 // 如果不想用 GPIO 控制，註釋掉下面這行，SD 引腳保持懸空
 #define USE_SD_PIN_CONTROL
 
+/**
+ * @brief 播放監聽：每個 DMA 區塊送到喇叭後在中斷中呼叫（例如回音消除的參考訊號）
+ * @param samples 剛送出的樣本（沒有播放時是靜音）
+ * @param count 樣本數
+ * @param timestamp_us 區塊送完的時間（最後一個樣本之後）
+ */
+typedef void (*audio_sent_tap_t)(const int16_t *samples, size_t count, int64_t timestamp_us);
+
+/**
+ * @brief 播放中止條件：每寫入一個 DMA 區塊前呼叫，返回 true 就停止播放
+ */
+typedef bool (*audio_stop_check_t)(void *ctx);
+
 /**
  * @brief 初始化 MAX98357A 音頻輸出
  * @return ESP_OK 成功，其他值失敗
@@ -34,6 +53,21 @@ esp_err_t audio_init(void);
  */
 esp_err_t audio_play(const int16_t *data, size_t length);
 
+/**
+ * @brief 播放音頻數據，可中途停止
+ * @param data 音頻數據指針
+ * @param length 樣本數
+ * @param should_stop 中止條件（NULL = 播完為止）
+ * @param ctx 傳給 should_stop 的參數
+ * @return ESP_OK 播放完成，ESP_ERR_NOT_FINISHED 被中止（已送進 DMA 的部分仍會播完），其他值失敗
+ */
+esp_err_t audio_play_until(const int16_t *data, size_t length, audio_stop_check_t should_stop, void *ctx);
+
+/**
+ * @brief 設定播放監聽（NULL = 取消），可以在 audio_init 之前或之後呼叫
+ */
+void audio_set_sent_tap(audio_sent_tap_t tap);
+
 /**
  * @brief 播放簡單的提示音（嗶聲）
  * @param frequency 頻率 (Hz)
@@ -57,6 +91,13 @@ esp_err_t audio_play_wav_file(const char *file_path);
  */
 esp_err_t audio_play_wav_buffer(const uint8_t *wav_data, size_t wav_size);
 
+/**
+ * @brief 播放內存中的 WAV 數據，可中途停止（例如播放中偵測到喚醒詞）
+ * @return ESP_OK 播放完成，ESP_ERR_NOT_FINISHED 被中止，其他值失敗
+ */
+esp_err_t audio_play_wav_buffer_until(const uint8_t *wav_data, size_t wav_size,
+                                      audio_stop_check_t should_stop, void *ctx);
+
 /**
  * @brief 停止音頻播放
  */
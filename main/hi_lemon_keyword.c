@@ -8,7 +8,10 @@
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2s.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <stdatomic.h>
+#include "driver/i2s_std.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
@@ -20,6 +23,16 @@
 #include "location_service.h"
 #include "esp_http_client.h"
 #include "ei_wrapper.h"
+#include "audio_ring.h"
+#include "audio_stats.h"
+#include "audio_filter.h"
+#include "audio_agc.h"
+#include "audio_ns.h"
+#include "audio_aec.h"
+#include "vad.h"
+#include "wake_gate.h"
+#include "power_manager.h"
+#include "esp_timer.h"
 
 static const char *TAG = "HI_LEMON";
 
@@ -41,132 +54,172 @@ static const char *TAG = "HI_LEMON";
 
 // 音頻配置
 #define AUDIO_BUFFER_SIZE       1024
-#define RECORD_TIME_MS          3000
-#define TOTAL_SAMPLES           (I2S_SAMPLE_RATE * RECORD_TIME_MS / 1000)
 
-// Edge Impulse 檢測配置
-#define EI_WINDOW_SIZE          16000   // 1 秒窗口（Edge Impulse 模型需求）
-#define EI_SLIDE_SIZE           8000    // 滑動 0.5 秒
-#define ENERGY_THRESHOLD        100000  // 能量閾值（避免處理靜音）
-#define DETECTION_CONFIDENCE    0.7     // 檢測信心閾值（70%）
+// 指令錄音：VAD 端點偵測，說完就停，不再固定錄 3 秒
+#define RECORD_MIN_MS           1500    // 最短錄音（從觸發切片開頭算，涵蓋喚醒詞後的停頓）
+#define RECORD_MAX_MS           8000    // 最長錄音（長問題不會被截斷）
+#define RECORD_END_SILENCE_MS   800     // 語音後連續靜音這麼久就結束錄音
+#define RECORD_KEEP_SILENCE_MS  200     // 結尾保留的靜音，其餘裁掉不上傳
+#define RECORD_MAX_SAMPLES      (I2S_SAMPLE_RATE * RECORD_MAX_MS / 1000)
 
-// 初始化 INMP441（24-bit 原生模式）
-static esp_err_t init_inmp441(void) {
-    ESP_LOGI(TAG, "🎤 初始化 INMP441 麥克風（24-bit 原生模式）...");
-    
-    gpio_set_pull_mode(I2S_WS_PIN, GPIO_PULLUP_ONLY);
-    gpio_set_pull_mode(I2S_BCK_PIN, GPIO_PULLUP_ONLY);
-    gpio_set_pull_mode(I2S_DATA_PIN, GPIO_PULLUP_ONLY);
-    
-    i2s_config_t i2s_config = {
-        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX),
-        .sample_rate = I2S_SAMPLE_RATE,
-        .bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT,  // 使用 32-bit 容器存儲 24-bit 數據
-        .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
-        .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_STAND_I2S),
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 8,
-        .dma_buf_len = 256,
-        .use_apll = false,
-        .tx_desc_auto_clear = false,
-        .fixed_mclk = 0
-    };
+// 雙核心管線：擷取任務只把 I2S DMA 資料搬進環形緩衝區，檢測任務在另一個核心消費切片
+#define CAPTURE_DMA_FRAME_SAMPLES 160   // 每個 DMA 區塊的樣本數（10 ms，等於 MFE 幀移）
+#define CAPTURE_DMA_DESC_NUM    8       // DMA 區塊數（80 ms）：區塊被 DMA 覆寫前必須處理完
+#define CAPTURE_QUEUE_LEN       (CAPTURE_DMA_DESC_NUM - 3)  // 排隊中與延後處理（回音消除）的區塊都還沒被 DMA 覆寫
+#define AUDIO_RING_SAMPLES      16384   // 環形緩衝區容量（約 1 秒，必須是 2 的次方）
+#define AUDIO_HISTORY_SAMPLES   65536   // PSRAM 預錄環形緩衝區（約 4 秒，必須是 2 的次方），也涵蓋串流上傳建立連線的時間
+#define CAPTURE_TASK_CORE       0
+#define CAPTURE_TASK_PRIORITY   10      // 高於檢測任務，推理再慢也不會漏掉麥克風資料
+#define CAPTURE_TASK_STACK      4096
+#define DETECTOR_TASK_CORE      1
+#define DETECTOR_TASK_PRIORITY  5
+#define DETECTOR_TASK_STACK     16384   // Edge Impulse 推理（TTS 下載已移到播放任務）
+#define UPLOAD_TASK_CORE        1
+#define UPLOAD_TASK_PRIORITY    4       // 低於檢測任務，網路再慢也不會拖住端點偵測
+#define UPLOAD_TASK_STACK       12288   // HTTPS（TLS 握手）
+#define UPLOAD_RESPONSE_SIZE    2048
+#define PLAYER_TASK_CORE        0
+#define PLAYER_TASK_PRIORITY    6       // 高於檢測任務，播放不會斷斷續續
+#define PLAYER_TASK_STACK       12288   // 下載 TTS（HTTPS）
+#define AUDIO_WAIT_TIMEOUT_MS   500     // 等這麼久還沒有資料就記為 underrun
 
-    i2s_pin_config_t pin_config = {
-        .bck_io_num = I2S_BCK_PIN,
-        .ws_io_num = I2S_WS_PIN,
-        .data_out_num = I2S_PIN_NO_CHANGE,
-        .data_in_num = I2S_DATA_PIN
-    };
+// 省電：CPU 平常降頻，推理、上傳（TLS）、下載與播放（回音消除）期間才跑全速；WiFi 平常 modem sleep
+// 需要 sdkconfig 啟用 CONFIG_PM_ENABLE（見 sdkconfig.defaults），如果想一直全速，註釋掉下面這行
+#define USE_POWER_SAVE
+#define POWER_LIGHT_SLEEP       true    // 沒有任何頻率鎖時自動 light sleep（麥克風 I2S 啟用期間驅動持有鎖，監聽時不會睡）
 
-    esp_err_t ret = i2s_driver_install(I2S_NUM, &i2s_config, 0, NULL);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "❌ I2S 驅動安裝失敗: %s", esp_err_to_name(ret));
-        return ret;
-    }
+// 擷取端前處理（直流阻隔 → 高通 → 柔性擴展器，見 audio_filter.h），取代上傳前的高通與噪音門限
+// 在擷取任務中逐區塊執行，喚醒詞模型、VAD 與上傳看到同一個濾波後的串流；區塊統計仍是濾波前的原始音訊
+// 如果要讓模型看到原始音訊（例如比對漏報率），註釋掉下面這行
+#define USE_CAPTURE_FILTER
+#define CAPTURE_HPF_CUTOFF_HZ   80.0f   // 高通截止頻率
+#define CAPTURE_HPF_ORDER       2       // 高通階數（2、4、6、8）
+#define CAPTURE_EXPANDER_THRESHOLD_DB -56.0f    // 低於這個電平（dBFS）開始衰減
 
-    ret = i2s_set_pin(I2S_NUM, &pin_config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "❌ I2S 引腳配置失敗: %s", esp_err_to_name(ret));
-        return ret;
-    }
+// 上傳前的頻譜降噪（STFT Wiener，見 audio_ns.h）：只處理上傳的指令，不影響喚醒詞模型
+// 輸出延遲 16 ms（開頭多 16 ms 靜音，結尾保留的靜音少 16 ms）；不需要時註釋掉下面這行
+#define USE_UPLOAD_NS
 
-    vTaskDelay(pdMS_TO_TICKS(100));
-    i2s_zero_dma_buffer(I2S_NUM);
-    
-    ESP_LOGI(TAG, "✅ INMP441 初始化成功");
-    return ESP_OK;
-}
+// 播放中喚醒（barge-in）：TTS 由播放任務在背景下載與播放，檢測任務照常監聽，偵測到喚醒詞就中止播放並開始錄音
+// 回音消除（NLMS，見 audio_aec.h）以喇叭實際送出的訊號為參考，在擷取任務中處理，模型、VAD 與上傳看到的都是消除回音後的訊號
+// 參考訊號在播放 DMA 區塊送完後才寫入，擷取處理因此晚一個 DMA 區塊（10 ms）
+// 不需要時註釋掉下面這行（TTS 仍在背景播放，但麥克風訊號含回音，可能被 TTS 自己喚醒）
+#define USE_ECHO_CANCEL
+#define AEC_REF_HISTORY_SAMPLES 2048    // 喇叭參考環形緩衝區（128 ms，內部 RAM，必須是 2 的次方）
+#define AEC_REF_LEAD_SAMPLES    32      // 參考訊號提前 2 ms，涵蓋時間戳誤差（回音路徑的延遲由濾波器補上）
+#define AEC_RESYNC_SAMPLES      16      // 依時間戳推算的對齊位置偏離超過 1 ms 才重新對齊
 
-// 將 32-bit I2S 數據（24-bit 有效位）轉換為 16-bit
-// INMP441 輸出 24-bit 數據，存儲在 32-bit 容器的高 24 位
-static void convert_32bit_to_16bit(int32_t *input, int16_t *output, size_t length) {
-    for (size_t i = 0; i < length; i++) {
-        // 右移 16 位，將 24-bit 數據轉換為 16-bit
-        // 這樣可以保留最高有效位，獲得更好的動態範圍
-        output[i] = (int16_t)(input[i] >> 16);
-    }
-}
+// Edge Impulse 檢測配置
+// 連續推理：1 秒窗口切成 N 個切片（由 LEMON_WAKE_SLICES_PER_WINDOW 設定），每個切片推理一次
+// 語音活動偵測：靜音時不做 MFE 與推理（參數見 vad.h）
+// 如果只想統計 VAD 而不略過推理，註釋掉下面這行
+#define USE_VAD_GATE
+// 級聯檢測：每 10 ms 先跑便宜的第一級（模板比對，見 wake_gate.h），只有候選才送進模型；
+// 還沒有模板時（第一次使用）退回只用 VAD 把關，喚醒後指令上傳成功才登錄模板
+// 門檻還沒有用實際錄音量過漏掉率，預設不啟用：第一級漏掉的喚醒詞模型完全看不到
+// 調整門檻時先啟用並把 CASCADE_AUDIT_ONSETS 設為 1（每段語音都直接送進模型，第一級只記分數），
+// 依統計印出的門檻 / 召回表選定門檻後再改回稽核間隔
+// #define USE_CASCADE
+#define CASCADE_THRESHOLD_DB    4.5f    // 第一級門檻（每幀每維的平均距離）：越大越不會漏掉，送進模型的也越多
+#define CASCADE_AUDIT_ONSETS    10      // 每 N 次語音起點有一次不經第一級直接送進模型，統計第一級漏掉的比例
+#define CASCADE_TABLE_MIN_DB    2.0f    // 門檻 / 召回表：從 2.0 dB 起每 0.5 dB 一列
+#define CASCADE_TABLE_STEP_DB   0.5f
+#define CASCADE_TABLE_ROWS      9
+#define DETECTION_LABEL         "hi lemon"  // 喚醒詞分類（模型標籤名稱）
+#define DETECTION_CONFIDENCE    0.8f    // 檢測信心閾值（80%），啟動時換算成 int8 門檻
+#define KERNEL_STATS_INTERVAL   400     // 每 N 個切片印一次 int8 算子耗時表與擷取統計
+#define MFE_VALIDATE_DIR        "/sdcard/mfe"   // LEMON_WAKE_MFE_VALIDATE: 比對用的 WAV 檔資料夾
+
+// INMP441 接收通道；DMA 區塊收滿時由 on_recv 回呼送到擷取任務
+static i2s_chan_handle_t s_rx_chan = NULL;
+
+// 一個 DMA 區塊：data 直接指向 DMA 緩衝區（零複製），在 DMA 繞回來覆寫前有效
+typedef struct {
+    const int32_t *data;
+    size_t samples;
+    int64_t timestamp_us;       // 區塊收滿的時間（最後一個樣本之後）
+} capture_block_t;
+
+static QueueHandle_t s_capture_queue = NULL;
+static atomic_uint s_dma_dropped_blocks = 0;    // 擷取任務來不及處理而丟棄的 DMA 區塊
 
-// 計算音頻能量
-static int64_t calculate_energy(int16_t *buffer, size_t length) {
-    int64_t energy = 0;
-    for (size_t i = 0; i < length; i++) {
-        energy += (int64_t)buffer[i] * buffer[i];
+// DMA 區塊收滿（中斷中執行）：只記下時間並把指標送給擷取任務
+// 驅動內部的訊息佇列不會有人讀取，滿了會自行丟掉最舊的項目，不影響這裡
+static IRAM_ATTR bool on_i2s_recv(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+    capture_block_t block = {
+        .data = (const int32_t *)event->dma_buf,
+        .samples = event->size / sizeof(int32_t),
+        .timestamp_us = esp_timer_get_time(),
+    };
+    BaseType_t woken = pdFALSE;
+    if (xQueueSendFromISR(s_capture_queue, &block, &woken) != pdTRUE) {
+        atomic_fetch_add_explicit(&s_dma_dropped_blocks, 1, memory_order_relaxed);
     }
-    return energy / length;
+    return woken == pdTRUE;
 }
 
-// 輕度降噪處理
-static void apply_noise_reduction(int16_t *audio_data, size_t length) {
-    // 高通濾波器（去除極低頻雜訊）
-    const float alpha = 0.99;
-    float prev_output = 0;
-    int16_t prev_input = 0;
+// 初始化 INMP441（24-bit 原生模式）
+// 通道在這裡建立並註冊回呼，由 start_audio_pipeline 在任務建立後啟用
+static esp_err_t init_inmp441(void) {
+    ESP_LOGI(TAG, "🎤 初始化 INMP441 麥克風（24-bit 原生模式）...");
     
-    for (size_t i = 0; i < length; i++) {
-        float filtered = alpha * (prev_output + audio_data[i] - prev_input);
-        prev_output = filtered;
-        prev_input = audio_data[i];
-        audio_data[i] = (int16_t)filtered;
+    s_capture_queue = xQueueCreate(CAPTURE_QUEUE_LEN, sizeof(capture_block_t));
+    if (s_capture_queue == NULL) {
+        ESP_LOGE(TAG, "❌ 無法建立擷取佇列");
+        return ESP_ERR_NO_MEM;
     }
     
-    // 噪音門限
-    const int16_t threshold = 50;
-    for (size_t i = 0; i < length; i++) {
-        if (abs(audio_data[i]) < threshold) {
-            audio_data[i] = 0;
-        }
-    }
-}
-
-// 自動增益控制
-static void apply_auto_gain(int16_t *audio_data, size_t length) {
-    float rms = 0.0f;
-    for (size_t i = 0; i < length; i++) {
-        rms += (float)(audio_data[i] * audio_data[i]);
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM, I2S_ROLE_MASTER);
+    chan_cfg.dma_desc_num = CAPTURE_DMA_DESC_NUM;
+    chan_cfg.dma_frame_num = CAPTURE_DMA_FRAME_SAMPLES;
+    
+    esp_err_t ret = i2s_new_channel(&chan_cfg, NULL, &s_rx_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ I2S 通道建立失敗: %s", esp_err_to_name(ret));
+        return ret;
     }
-    rms = sqrtf(rms / length);
     
-    const float target_rms = 8192.0f;
-    float gain = 1.0f;
+    // 使用 32-bit 容器存儲 24-bit 數據，L/R 接地 → 左聲道
+    i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(I2S_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_32BIT, I2S_SLOT_MODE_MONO),
+        .gpio_cfg = {
+            .mclk = I2S_GPIO_UNUSED,
+            .bclk = I2S_BCK_PIN,
+            .ws = I2S_WS_PIN,
+            .dout = I2S_GPIO_UNUSED,
+            .din = I2S_DATA_PIN,
+            .invert_flags = {
+                .mclk_inv = false,
+                .bclk_inv = false,
+                .ws_inv = false,
+            },
+        },
+    };
+    std_cfg.slot_cfg.slot_mask = I2S_STD_SLOT_LEFT;
     
-    if (rms > 100.0f) {
-        gain = target_rms / rms;
-        if (gain < 1.0f) gain = 1.0f;
-        if (gain > 8.0f) gain = 8.0f;
-    } else {
-        gain = 4.0f;
+    ret = i2s_channel_init_std_mode(s_rx_chan, &std_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ I2S 標準模式配置失敗: %s", esp_err_to_name(ret));
+        return ret;
     }
     
-    ESP_LOGI(TAG, "🎚️  自動增益: %.2fx (RMS: %.0f → %.0f)", gain, rms, rms * gain);
+    gpio_set_pull_mode(I2S_WS_PIN, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode(I2S_BCK_PIN, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode(I2S_DATA_PIN, GPIO_PULLUP_ONLY);
     
-    for (size_t i = 0; i < length; i++) {
-        int32_t amplified = (int32_t)(audio_data[i] * gain);
-        if (amplified > 32767) amplified = 32767;
-        if (amplified < -32768) amplified = -32768;
-        audio_data[i] = (int16_t)amplified;
+    i2s_event_callbacks_t cbs = {
+        .on_recv = on_i2s_recv,
+    };
+    ret = i2s_channel_register_event_callback(s_rx_chan, &cbs, NULL);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ I2S 回呼註冊失敗: %s", esp_err_to_name(ret));
+        return ret;
     }
+    
+    ESP_LOGI(TAG, "✅ INMP441 初始化成功（DMA %d × %d 樣本）",
+             CAPTURE_DMA_DESC_NUM, CAPTURE_DMA_FRAME_SAMPLES);
+    return ESP_OK;
 }
 
 // HTTP 事件處理器
@@ -174,8 +227,24 @@ static esp_err_t tts_http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-// 下載並播放 TTS
-static esp_err_t download_and_play_tts(const char* url) {
+// TTS 播放任務：下載與播放都在背景進行，檢測任務照常監聽
+// 偵測到喚醒詞時遞增 s_tts_generation，正在進行的下載與播放看到世代改變就中止
+typedef struct {
+    char url[256];
+    uint32_t generation;        // 送出請求時的世代
+} tts_request_t;
+
+static QueueHandle_t s_tts_queue = NULL;        // 長度 1，新的請求覆蓋還沒開始的舊請求
+static atomic_uint s_tts_generation = 0;
+static atomic_bool s_tts_playing = false;
+
+// 中止條件（audio_play_wav_buffer_until 每寫一個 DMA 區塊前呼叫）
+static bool tts_cancelled(void *ctx) {
+    return atomic_load(&s_tts_generation) != *(const uint32_t *)ctx;
+}
+
+// 下載並播放 TTS（播放任務）
+static esp_err_t download_and_play_tts(const char* url, uint32_t generation) {
     ESP_LOGI(TAG, "📥 下載 TTS: %s", url);
     
     esp_http_client_config_t config = {
@@ -225,6 +294,9 @@ static esp_err_t download_and_play_tts(const char* url) {
                                             content_length - total_read);
         if (read_len <= 0) break;
         total_read += read_len;
+        if (tts_cancelled(&generation)) {
+            break;
+        }
         
         if (total_read % 10000 == 0 || total_read == content_length) {
             ESP_LOGI(TAG, "📥 下載進度: %d%% (%d/%d bytes)", 
@@ -234,6 +306,12 @@ static esp_err_t download_and_play_tts(const char* url) {
     
     esp_http_client_cleanup(client);
     
+    if (tts_cancelled(&generation)) {
+        ESP_LOGI(TAG, "⏹️ 已重新喚醒，放棄下載的 TTS");
+        heap_caps_free(wav_buffer);
+        return ESP_ERR_NOT_FINISHED;
+    }
+    
     if (total_read != content_length) {
         ESP_LOGE(TAG, "❌ 下載不完整: %d/%d bytes", total_read, content_length);
         heap_caps_free(wav_buffer);
@@ -243,12 +321,18 @@ static esp_err_t download_and_play_tts(const char* url) {
     ESP_LOGI(TAG, "✅ 下載完成: %d bytes", total_read);
     ESP_LOGI(TAG, "🔊 開始播放 TTS...");
     
-    audio_play_wav_buffer(wav_buffer, content_length);
+    atomic_store(&s_tts_playing, true);
+    esp_err_t ret = audio_play_wav_buffer_until(wav_buffer, content_length, tts_cancelled, &generation);
+    atomic_store(&s_tts_playing, false);
     
     heap_caps_free(wav_buffer);
-    ESP_LOGI(TAG, "✅ TTS 播放完成");
+    if (ret == ESP_ERR_NOT_FINISHED) {
+        ESP_LOGI(TAG, "⏹️ TTS 播放被喚醒詞打斷");
+    } else {
+        ESP_LOGI(TAG, "✅ TTS 播放完成");
+    }
     
-    return ESP_OK;
+    return ret;
 }
 
 // 從 JSON 響應中提取 TTS URL
@@ -264,82 +348,409 @@ static bool extract_tts_url(const char* json_response, char* url_buffer, size_t
     return true;
 }
 
-// 錄音並上傳
-static esp_err_t record_and_upload(void) {
-    ESP_LOGI(TAG, "🎙️  開始錄音 %d 秒...", RECORD_TIME_MS / 1000);
+// 擷取任務 → 檢測任務的音訊環形緩衝區（SPSC，無鎖）
+static audio_ring_t s_audio_ring;
+// 每個 DMA 區塊的能量 / 峰值 / 直流，在轉換時順便算好，檢測任務不必再掃一次樣本
+static audio_stats_history_t s_block_stats;
+// 最近約 4 秒的音訊（PSRAM），寫入計數與環形緩衝區相同；指令錄音直接從這裡取，不必另開擷取迴圈
+static audio_history_t s_audio_history;
+static TaskHandle_t s_detector_task = NULL;
+
+// 等待上傳響應期間不需要音訊：擷取任務照常接收 DMA 區塊，但不寫入環形緩衝區與預錄緩衝區
+static atomic_bool s_capture_paused = false;
+
+#ifdef USE_ECHO_CANCEL
+// 喇叭參考訊號：播放 DMA 區塊送完時在中斷中寫入（沒有播放時是靜音），寫入計數就是喇叭的樣本序號
+static audio_history_t s_speaker_ref;
+static portMUX_TYPE s_ref_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_ref_clock_count = 0;      // 已送到喇叭的樣本數
+static int64_t s_ref_clock_us = 0;          // 最後一個樣本送完的時間
+static audio_aec_t s_echo_canceller;        // 只有擷取任務使用
+static uint32_t s_aec_ref_next = 0;         // 下一個麥克風樣本對應的參考序號（擷取任務）
+static bool s_aec_synced = false;
+static atomic_uint s_aec_resyncs = 0;       // 重新對齊的次數
+static atomic_uint s_aec_ref_missing = 0;   // 參考訊號還沒到（或已被覆蓋）而略過的區塊數
+// 擷取任務每個區塊更新一次，播放任務在播放結束後印出
+static portMUX_TYPE s_aec_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static audio_aec_stats_t s_aec_stats;
+
+// 播放 DMA 區塊送完（中斷中執行）
+static IRAM_ATTR void on_speaker_sent(const int16_t *samples, size_t count, int64_t timestamp_us) {
+    audio_history_write(&s_speaker_ref, samples, count);
+    taskENTER_CRITICAL_ISR(&s_ref_clock_lock);
+    s_ref_clock_count += count;
+    s_ref_clock_us = timestamp_us;
+    taskEXIT_CRITICAL_ISR(&s_ref_clock_lock);
+}
+
+// 取出與麥克風區塊同一時間送到喇叭的參考訊號（end_us: 區塊最後一個樣本之後的時間）
+// 兩個 I2S 用同一個時鐘源，參考序號隨麥克風樣本連續遞增；依時間戳推算的位置偏離太多才重新對齊
+// （例如暫停擷取之後，或中斷被延遲），避免每個區塊的時間戳抖動讓參考訊號重複或跳過樣本
+static bool read_speaker_ref(int64_t end_us, size_t samples, int16_t *ref) {
+    taskENTER_CRITICAL(&s_ref_clock_lock);
+    uint32_t clock_count = s_ref_clock_count;
+    int64_t clock_us = s_ref_clock_us;
+    taskEXIT_CRITICAL(&s_ref_clock_lock);
     
-    size_t buffer_size = TOTAL_SAMPLES * sizeof(int16_t);
-    ESP_LOGI(TAG, "📊 需要分配 %zu KB 緩衝區...", buffer_size / 1024);
-    ESP_LOGI(TAG, "💾 當前可用: %zu KB", heap_caps_get_free_size(MALLOC_CAP_8BIT) / 1024);
+    int32_t behind = (int32_t)((clock_us - end_us) * I2S_SAMPLE_RATE / 1000000);
+    uint32_t expected = clock_count - behind - samples + AEC_REF_LEAD_SAMPLES;
+    int32_t offset = (int32_t)(expected - s_aec_ref_next);
+    if (!s_aec_synced || offset > AEC_RESYNC_SAMPLES || offset < -AEC_RESYNC_SAMPLES) {
+        if (s_aec_synced) {
+            atomic_fetch_add(&s_aec_resyncs, 1);
+        }
+        s_aec_ref_next = expected;
+        s_aec_synced = true;
+    }
     
-    int16_t *audio_buffer = (int16_t*)malloc(buffer_size);
-    if (audio_buffer == NULL) {
-        ESP_LOGE(TAG, "❌ 記憶體分配失敗");
-        return ESP_ERR_NO_MEM;
+    esp_err_t err = audio_history_read(&s_speaker_ref, s_aec_ref_next, ref, samples);
+    s_aec_ref_next += samples;
+    return err == ESP_OK;
+}
+
+// 印出回音消除統計（播放結束後）
+static void log_echo_cancel_stats(void) {
+    audio_aec_stats_t stats;
+    taskENTER_CRITICAL(&s_aec_stats_lock);
+    stats = s_aec_stats;
+    taskEXIT_CRITICAL(&s_aec_stats_lock);
+    ESP_LOGI(TAG, "🔁 回音消除: ERLE %.1f dB，播放 %lu 區塊（更新 %lu，雙講暫停 %lu），重新對齊 %u 次，缺參考 %u 區塊",
+             stats.erle_db, (unsigned long)stats.blocks, (unsigned long)stats.adapted_blocks,
+             (unsigned long)stats.double_talk_blocks, atomic_load(&s_aec_resyncs), atomic_load(&s_aec_ref_missing));
+}
+#endif
+
+#ifdef USE_CAPTURE_FILTER
+static audio_filter_t s_capture_filter;     // 只有擷取任務使用
+#endif
+
+// 等到環形緩衝區至少有 count 個樣本（擷取任務每寫入一次就通知一次）
+// 逾時返回，之後的 audio_ring_read 會記為 underrun
+static void wait_for_audio(size_t count) {
+    while (audio_ring_available(&s_audio_ring) < count) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AUDIO_WAIT_TIMEOUT_MS)) == 0) {
+            ESP_LOGW(TAG, "⚠️ %d ms 內沒有收到音訊", AUDIO_WAIT_TIMEOUT_MS);
+            return;
+        }
+    }
+}
+
+// 等到預錄環形緩衝區寫到 end_count（寫入計數）
+// 錄音期間檢測任務不消費環形緩衝區，順便清空，避免被填滿而記為 overflow
+static bool wait_for_history(uint32_t end_count) {
+    while ((int32_t)(audio_history_write_count(&s_audio_history) - end_count) < 0) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AUDIO_WAIT_TIMEOUT_MS)) == 0) {
+            ESP_LOGW(TAG, "⚠️ %d ms 內沒有收到音訊", AUDIO_WAIT_TIMEOUT_MS);
+            return false;
+        }
+        audio_ring_flush(&s_audio_ring);
+    }
+    return true;
+}
+
+// 指令錄音的串流上傳：檢測任務做端點偵測並推進 send_limit，上傳任務把預錄環形緩衝區中
+// send_limit 之前的音訊邊錄邊送出；結尾可能被裁掉的靜音先留著，端點確定後才決定送多少
+typedef struct {
+    atomic_bool active;         // 檢測任務開始一段錄音時設定，上傳任務結束時清除
+    uint32_t start_count;       // 指令錄音的第一個樣本（寫入計數）
+    atomic_uint send_limit;     // 可以送出的寫入計數上限（只會往後推）
+    atomic_bool finished;       // 錄音結束，send_limit 就是最後長度
+    atomic_bool failed;         // 上傳失敗，檢測任務不必再錄
+    int64_t endpoint_us;        // 錄音結束的時間
+    char *response;             // 伺服器響應（檢測任務配置）
+    esp_err_t result;
+} upload_session_t;
+
+static upload_session_t s_upload;
+
+#ifdef USE_POWER_SAVE
+static power_burst_t s_model_burst;         // 檢測任務：MFE 與推理
+static power_burst_t s_upload_burst;        // 上傳任務：TLS、降噪、自動增益
+static power_burst_t s_player_burst;        // 播放任務：下載 TTS，播放期間擷取任務的回音消除也跟著全速
+#endif
+static audio_agc_t s_upload_agc;            // 只有上傳任務使用，每段錄音重新開始
+#ifdef USE_UPLOAD_NS
+static audio_ns_t s_upload_ns;              // 只有上傳任務使用，噪音估計跨錄音保留
+#endif
+static TaskHandle_t s_upload_task = NULL;
+static SemaphoreHandle_t s_upload_done = NULL;
+
+// 上傳任務：送出 [start_count, send_limit) 的音訊，錄音結束後送出剩下的部分並等待響應
+static esp_err_t stream_command(int16_t *chunk) {
+    audio_agc_reset(&s_upload_agc);
+#ifdef USE_UPLOAD_NS
+    audio_ns_reset_stream(&s_upload_ns);
+#endif
+    audio_upload_stream_t *stream = NULL;
+    esp_err_t ret = audio_upload_stream_begin(SERVER_URL, API_KEY, I2S_SAMPLE_RATE, &stream);
+    if (ret != ESP_OK) {
+        return ret;
     }
     
-    ESP_LOGI(TAG, "✅ 緩衝區分配成功");
+    uint32_t sent = s_upload.start_count;
+    while (1) {
+        // 先讀 finished 再讀 send_limit：看到結束時 send_limit 一定是最後長度
+        bool finished = atomic_load(&s_upload.finished);
+        uint32_t limit = atomic_load(&s_upload.send_limit);
+        while ((int32_t)(limit - sent) > 0) {
+            size_t n = limit - sent;
+            if (n > AUDIO_BUFFER_SIZE) {
+                n = AUDIO_BUFFER_SIZE;
+            }
+            if (audio_history_read(&s_audio_history, sent, chunk, n) != ESP_OK) {
+                ESP_LOGE(TAG, "❌ 預錄音訊已被覆蓋（上傳跟不上，或 AUDIO_HISTORY_SAMPLES 太小）");
+                audio_upload_stream_abort(stream);
+                return ESP_FAIL;
+            }
+#ifdef USE_UPLOAD_NS
+            audio_ns_process(&s_upload_ns, chunk, n);
+#endif
+            audio_agc_process(&s_upload_agc, chunk, n);
+            ret = audio_upload_stream_write(stream, chunk, n);
+            if (ret != ESP_OK) {
+                audio_upload_stream_abort(stream);
+                return ret;
+            }
+            sent += n;
+        }
+        if (finished) {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(AUDIO_WAIT_TIMEOUT_MS));
+    }
     
-    size_t bytes_read = 0;
-    size_t total_samples = 0;
-    int32_t temp_buffer_32[AUDIO_BUFFER_SIZE];
-    int16_t temp_buffer_16[AUDIO_BUFFER_SIZE];
+    uint32_t total = sent - s_upload.start_count;
+#ifdef USE_UPLOAD_NS
+    audio_ns_stats_t ns_stats;
+    audio_ns_get_stats(&s_upload_ns, I2S_SAMPLE_RATE, &ns_stats);
+    ESP_LOGI(TAG, "🔉 頻譜降噪: %lu 幀，平均增益 %.1f dB，%lu cycles / 10 ms（預算 %d）",
+             (unsigned long)ns_stats.frames, ns_stats.mean_gain_db,
+             (unsigned long)ns_stats.cycles_per_10ms, AUDIO_NS_CYCLE_BUDGET);
+    if (ns_stats.cycles_per_10ms > AUDIO_NS_CYCLE_BUDGET) {
+        ESP_LOGW(TAG, "⚠️ 頻譜降噪超出 CPU 預算");
+    }
+#endif
+    audio_agc_stats_t agc_stats;
+    audio_agc_get_stats(&s_upload_agc, &agc_stats);
+    ESP_LOGI(TAG, "🎚️  自動增益: 結尾 %+.1f dB（包絡 %.1f dBFS），限幅 %lu/%lu 區塊，靜音維持 %lu 區塊",
+             agc_stats.gain_db, agc_stats.envelope_dbfs, (unsigned long)agc_stats.limited_blocks,
+             (unsigned long)agc_stats.blocks, (unsigned long)agc_stats.silent_blocks);
+    ESP_LOGI(TAG, "📤 已串流 %lu 樣本（%lu KB），語音結束後 %lld ms 送完",
+             (unsigned long)total, (unsigned long)(total * sizeof(int16_t) / 1024),
+             (long long)((esp_timer_get_time() - s_upload.endpoint_us) / 1000));
     
-    while (total_samples < TOTAL_SAMPLES) {
-        i2s_read(I2S_NUM, temp_buffer_32, sizeof(temp_buffer_32), &bytes_read, portMAX_DELAY);
-        size_t samples_read = bytes_read / sizeof(int32_t);
-        
-        // 轉換 32-bit 到 16-bit
-        convert_32bit_to_16bit(temp_buffer_32, temp_buffer_16, samples_read);
-        
-        size_t samples_to_copy = (total_samples + samples_read <= TOTAL_SAMPLES) ? 
-                                 samples_read : (TOTAL_SAMPLES - total_samples);
-        
-        memcpy(audio_buffer + total_samples, temp_buffer_16, 
-               samples_to_copy * sizeof(int16_t));
-        total_samples += samples_to_copy;
-        
-        int progress = (total_samples * 100) / TOTAL_SAMPLES;
-        if (progress % 20 == 0 || total_samples >= TOTAL_SAMPLES) {
-            ESP_LOGI(TAG, "錄音進度: %d%% (%d 秒)", progress, 
-                     (int)total_samples / I2S_SAMPLE_RATE);
-        }
+    ret = audio_upload_stream_finish(stream, s_upload.response, UPLOAD_RESPONSE_SIZE);
+    ESP_LOGI(TAG, "⏱️  語音結束 → 伺服器響應: %lld ms",
+             (long long)((esp_timer_get_time() - s_upload.endpoint_us) / 1000));
+    return ret;
+}
+
+static void upload_task(void *arg) {
+    // 16-byte 對齊：自動增益的 Q15 乘法才能用 PIE 向量指令
+    int16_t *chunk = (int16_t*)heap_caps_aligned_alloc(16, AUDIO_BUFFER_SIZE * sizeof(int16_t),
+                                                       MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (chunk == NULL) {
+        ESP_LOGE(TAG, "❌ 無法分配上傳緩衝區");
+        vTaskDelete(NULL);
+        return;
     }
     
-    ESP_LOGI(TAG, "✅ 錄音完成: %zu 樣本 (%.1f 秒)", 
-             total_samples, 
-             (float)total_samples / I2S_SAMPLE_RATE);
+    ESP_LOGI(TAG, "📤 上傳任務啟動（核心 %d）", xPortGetCoreID());
     
-    int64_t energy = calculate_energy(audio_buffer, TOTAL_SAMPLES);
-    ESP_LOGI(TAG, "原始音頻能量: %lld", energy);
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!atomic_load(&s_upload.active)) {
+            continue;       // 上一段錄音殘留的通知
+        }
+#ifdef USE_POWER_SAVE
+        power_burst_begin(&s_upload_burst);
+        wifi_hold_awake(true);
+#endif
+        s_upload.result = stream_command(chunk);
+#ifdef USE_POWER_SAVE
+        wifi_hold_awake(false);
+        power_burst_end(&s_upload_burst);
+#endif
+        if (s_upload.result != ESP_OK) {
+            atomic_store(&s_upload.failed, true);
+        }
+        atomic_store(&s_upload.active, false);
+        xSemaphoreGive(s_upload_done);
+    }
+}
+
+// 播放任務：依序處理 TTS 請求（下載到 PSRAM 後播放），被新的喚醒打斷就放棄
+static void player_task(void *arg) {
+    tts_request_t request;
     
-    ESP_LOGI(TAG, "🔧 輕度降噪...");
-    apply_noise_reduction(audio_buffer, TOTAL_SAMPLES);
-    apply_auto_gain(audio_buffer, TOTAL_SAMPLES);
+    ESP_LOGI(TAG, "🔊 播放任務啟動（核心 %d）", xPortGetCoreID());
     
-    ESP_LOGI(TAG, "📤 上傳音頻到服務器...");
+    while (1) {
+        xQueueReceive(s_tts_queue, &request, portMAX_DELAY);
+        if (tts_cancelled(&request.generation)) {
+            continue;
+        }
+#ifdef USE_POWER_SAVE
+        // 頻率鎖是全系統的：播放期間擷取任務的回音消除也跑全速
+        power_burst_begin(&s_player_burst);
+        wifi_hold_awake(true);
+#endif
+        download_and_play_tts(request.url, request.generation);
+#ifdef USE_POWER_SAVE
+        wifi_hold_awake(false);
+        power_burst_end(&s_player_burst);
+#endif
+#ifdef USE_ECHO_CANCEL
+        log_echo_cancel_stats();
+#endif
+    }
+}
+
+// 目前可以放心送出的樣本數：之後裁掉的結尾靜音，最早從目前這段靜音的開頭 + 保留長度開始
+// 還沒湊滿一幀的樣本（最多一幀）也可能是靜音；裁切後不會短於最短錄音
+static size_t sendable_samples(size_t total, size_t trailing, size_t keep, size_t min_samples) {
+    size_t hold = trailing + VAD_FRAME_SAMPLES;
+    size_t safe = total;
+    if (hold > keep) {
+        safe = hold - keep < total ? total - (hold - keep) : 0;
+    }
+    if (safe < min_samples) {
+        safe = min_samples < total ? min_samples : total;
+    }
+    return safe;
+}
+
+// 錄音並上傳（邊錄邊送）
+// start_count: 指令錄音的第一個樣本（寫入計數），可以早於現在，只要還在預錄環形緩衝區內
+// vad: 檢測任務的 VAD（沿用已追蹤的噪音底），用來判斷指令何時說完
+static esp_err_t record_and_upload(uint32_t start_count, vad_t *vad) {
+    uint32_t preroll = audio_history_write_count(&s_audio_history) - start_count;
+    ESP_LOGI(TAG, "🎙️  開始錄音（%d ~ %d 秒，靜音 %d ms 結束，其中 %lu ms 已在預錄緩衝區）...",
+             RECORD_MIN_MS / 1000, RECORD_MAX_MS / 1000, RECORD_END_SILENCE_MS,
+             (unsigned long)(preroll * 1000 / I2S_SAMPLE_RATE));
     
     // 分配響應緩衝區
-    char* response_buffer = (char*)malloc(2048);
+    char* response_buffer = (char*)malloc(UPLOAD_RESPONSE_SIZE);
     if (response_buffer == NULL) {
         ESP_LOGE(TAG, "❌ 無法分配響應緩衝區");
-        free(audio_buffer);
         return ESP_ERR_NO_MEM;
     }
+    response_buffer[0] = '\0';
+    
+    static int16_t audio_buffer[AUDIO_BUFFER_SIZE];     // 只給端點偵測用，音訊由上傳任務從預錄緩衝區讀取
+    const size_t min_samples = I2S_SAMPLE_RATE * RECORD_MIN_MS / 1000;
+    const size_t keep = I2S_SAMPLE_RATE * RECORD_KEEP_SILENCE_MS / 1000;
+    const uint32_t end_silence_frames = RECORD_END_SILENCE_MS * I2S_SAMPLE_RATE / 1000 / VAD_FRAME_SAMPLES;
+    int64_t record_start_us = esp_timer_get_time();
+    
+    // 上傳任務立刻開始建立連線，連線期間的音訊留在預錄環形緩衝區
+    s_upload.start_count = start_count;
+    s_upload.response = response_buffer;
+    s_upload.endpoint_us = 0;
+    atomic_store(&s_upload.send_limit, start_count);
+    atomic_store(&s_upload.finished, false);
+    atomic_store(&s_upload.failed, false);
+    atomic_store(&s_upload.active, true);
+    xTaskNotifyGive(s_upload_task);
+    
+    // 結尾靜音只從錄音開頭算（不含喚醒詞之前）
+    vad_reset_activity(vad);
+    
+    // 擷取任務持續寫入預錄環形緩衝區，這裡依樣本序號逐段取出，中間不會有缺口
+    // 原始音訊的統計由擷取任務算好，逐段合併
+    size_t total_samples = 0;
+    audio_stats_t raw_stats = { 0 };
+    bool endpoint = false;
+    uint32_t next_progress_ms = 1000;
+    
+    while (total_samples < RECORD_MAX_SAMPLES && !atomic_load(&s_upload.failed)) {
+        size_t samples_to_copy = RECORD_MAX_SAMPLES - total_samples;
+        if (samples_to_copy > AUDIO_BUFFER_SIZE) {
+            samples_to_copy = AUDIO_BUFFER_SIZE;
+        }
+        uint32_t chunk_start = start_count + total_samples;
+        if (!wait_for_history(chunk_start + samples_to_copy)) {
+            continue;
+        }
+        esp_err_t err = audio_history_read(&s_audio_history, chunk_start, audio_buffer, samples_to_copy);
+        if (err == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "❌ 預錄音訊已被覆蓋（AUDIO_HISTORY_SAMPLES 太小）");
+            break;
+        }
+        if (err != ESP_OK) {
+            continue;
+        }
+        vad_process(vad, audio_buffer, samples_to_copy);
+        total_samples += samples_to_copy;
+        
+        audio_stats_t chunk_stats;
+        audio_stats_history_range(&s_block_stats, chunk_start, chunk_start + samples_to_copy, &chunk_stats);
+        audio_stats_merge(&raw_stats, &chunk_stats);
+        
+        uint32_t recorded_ms = total_samples * 1000 / I2S_SAMPLE_RATE;
+        if (recorded_ms >= next_progress_ms) {
+            ESP_LOGI(TAG, "錄音進度: %lu 秒", (unsigned long)(recorded_ms / 1000));
+            next_progress_ms += 1000;
+        }
+        
+        // 端點：錄滿最短長度，且最後一段語音之後已經靜音夠久
+        if (total_samples >= min_samples && vad_trailing_silence_frames(vad) >= end_silence_frames) {
+            endpoint = true;
+            break;
+        }
+        
+        // 語音中的音訊立刻交給上傳任務；可能被裁掉的結尾靜音先留著
+        size_t trailing = (size_t)vad_trailing_silence_frames(vad) * VAD_FRAME_SAMPLES;
+        atomic_store(&s_upload.send_limit,
+                     start_count + sendable_samples(total_samples, trailing, keep, min_samples));
+        xTaskNotifyGive(s_upload_task);
+    }
+    
+    // 裁掉結尾的靜音，只保留一小段
+    size_t trailing = (size_t)vad_trailing_silence_frames(vad) * VAD_FRAME_SAMPLES;
+    size_t upload_samples = total_samples;
+    if (endpoint && trailing > keep) {
+        upload_samples = total_samples - (trailing - keep);
+        if (upload_samples < min_samples) {
+            upload_samples = min_samples;
+        }
+    }
+    
+    // 通知上傳任務送出剩下的部分並結束請求
+    s_upload.endpoint_us = esp_timer_get_time();
+    atomic_store(&s_upload.send_limit, start_count + upload_samples);
+    atomic_store(&s_upload.finished, true);
+    xTaskNotifyGive(s_upload_task);
     
-    esp_err_t ret = upload_audio_json(SERVER_URL, API_KEY, audio_buffer, TOTAL_SAMPLES, 
-                                      I2S_SAMPLE_RATE, response_buffer, 2048);
+    // 等待響應期間不需要音訊，避免環形緩衝區被填滿而記為 overflow
+    // 預錄緩衝區也跟著停止寫入，上傳任務還沒送出的結尾不會被覆蓋；收到響應後立刻恢復（TTS 在背景播放）
+    atomic_store(&s_capture_paused, true);
     
-    free(audio_buffer);
+    ESP_LOGI(TAG, "✅ 錄音完成: %zu 樣本 (%.1f 秒)，%s", 
+             upload_samples, 
+             (float)upload_samples / I2S_SAMPLE_RATE,
+             endpoint ? "偵測到語音結束" : (atomic_load(&s_upload.failed) ? "上傳失敗" : "達到最長錄音"));
+    ESP_LOGI(TAG, "⏱️  端點偵測: 錄音 %lld ms（含預錄 %lu ms），結尾靜音 %lu ms，裁掉 %lu ms",
+             (long long)((s_upload.endpoint_us - record_start_us) / 1000),
+             (unsigned long)(preroll * 1000 / I2S_SAMPLE_RATE),
+             (unsigned long)(trailing * 1000 / I2S_SAMPLE_RATE),
+             (unsigned long)((total_samples - upload_samples) * 1000 / I2S_SAMPLE_RATE));
+    ESP_LOGI(TAG, "原始音頻能量: %lld（峰值 %ld, 直流 %ld）", audio_stats_mean_energy(&raw_stats),
+             (long)raw_stats.peak, (long)audio_stats_dc(&raw_stats));
+    
+    xSemaphoreTake(s_upload_done, portMAX_DELAY);
+    esp_err_t ret = s_upload.result;
     
     if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "✅ 音頻上傳成功");
+        ESP_LOGI(TAG, "✅ 音頻上傳成功（%zu KB，語音結束後 %lld ms 收到響應）",
+                 upload_samples * sizeof(int16_t) / 1024,
+                 (long long)((esp_timer_get_time() - s_upload.endpoint_us) / 1000));
         ESP_LOGI(TAG, "");
         
-        // 提取並播放 TTS
-        char tts_url[256];
-        if (extract_tts_url(response_buffer, tts_url, sizeof(tts_url))) {
-            download_and_play_tts(tts_url);
+        // 提取 TTS 並交給播放任務，這裡立刻返回繼續監聽
+        tts_request_t request = { .generation = atomic_load(&s_tts_generation) };
+        if (extract_tts_url(response_buffer, request.url, sizeof(request.url))) {
+            xQueueOverwrite(s_tts_queue, &request);
         }
     } else {
         ESP_LOGE(TAG, "❌ 音頻上傳失敗");
@@ -349,79 +760,570 @@ static esp_err_t record_and_upload(void) {
     return ret;
 }
 
-// 主監聽循環（使用 Edge Impulse）
-static void listen_for_hi_lemon(void) {
-    ESP_LOGI(TAG, "🎤 開始監聽 'Hi Lemon'...");
+// 樣本時鐘：最近寫入環形緩衝區的 DMA 區塊結尾（寫入計數）對應的時間
+// 往回推算即可得到任何較新樣本的擷取時間（暫停或 overflow 造成的缺口之前的樣本不準）
+static portMUX_TYPE s_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_clock_count = 0;
+static int64_t s_clock_us = 0;
+
+// 環形緩衝區第 sample_count 個樣本（寫入計數）的擷取時間
+static int64_t capture_sample_time_us(uint32_t sample_count) {
+    taskENTER_CRITICAL(&s_clock_lock);
+    uint32_t clock_count = s_clock_count;
+    int64_t clock_us = s_clock_us;
+    taskEXIT_CRITICAL(&s_clock_lock);
+    int32_t behind = (int32_t)(clock_count - sample_count);
+    return clock_us - (int64_t)behind * 1000000 / I2S_SAMPLE_RATE;
+}
+
+// 擷取任務：把 DMA 區塊直接轉成 16-bit 寫進環形緩衝區（不經過中間緩衝區）
+static void capture_task(void *arg) {
+    capture_block_t block;
+#ifdef USE_ECHO_CANCEL
+    capture_block_t pending = { 0 };
+    static int16_t ref[CAPTURE_DMA_FRAME_SAMPLES];
+#endif
+    
+    ESP_LOGI(TAG, "🎙️  擷取任務啟動（核心 %d）", xPortGetCoreID());
+    
+    while (1) {
+        xQueueReceive(s_capture_queue, &block, portMAX_DELAY);
+#ifdef USE_ECHO_CANCEL
+        // 晚一個區塊處理：這時喇叭在這個區塊期間送出的參考訊號已經寫入（播放 DMA 區塊 5 ms）
+        capture_block_t next = block;
+        block = pending;
+        pending = next;
+        if (block.data == NULL) {
+            continue;
+        }
+#endif
+        if (atomic_load(&s_capture_paused)) {
+#ifdef USE_ECHO_CANCEL
+            s_aec_synced = false;
+#endif
+            continue;
+        }
+#ifdef USE_ECHO_CANCEL
+        bool have_ref = block.samples <= CAPTURE_DMA_FRAME_SAMPLES &&
+                        read_speaker_ref(block.timestamp_us, block.samples, ref);
+        if (!have_ref) {
+            atomic_fetch_add(&s_aec_ref_missing, 1);
+        }
+#endif
+        
+        // 跨過環形緩衝區結尾時分兩段寫入；轉換時同時累計區塊統計
+        audio_stats_t block_stats = { 0 };
+        size_t done = 0;
+        while (done < block.samples) {
+            int16_t *dst;
+            size_t n = audio_ring_reserve(&s_audio_ring, block.samples - done, &dst);
+            if (n == 0) {
+                audio_ring_commit(&s_audio_ring, 0, block.samples - done);
+                break;
+            }
+            audio_convert_i2s32(block.data + done, dst, n, &block_stats);
+#ifdef USE_ECHO_CANCEL
+            // 回音消除在高通與擴展器之前：擴展器的增益會變，放在後面回音路徑就不是線性非時變
+            if (have_ref) {
+                audio_aec_process(&s_echo_canceller, dst, ref + done, n);
+            }
+#endif
+#ifdef USE_CAPTURE_FILTER
+            audio_filter_process(&s_capture_filter, dst, n);
+#endif
+            audio_history_write(&s_audio_history, dst, n);
+            done += n;
+            if (done == block.samples) {
+                // 先記統計再發布樣本，檢測任務讀到這些樣本時一定查得到統計
+                audio_stats_history_push(&s_block_stats, audio_ring_write_count(&s_audio_ring) + n,
+                                         &block_stats);
+            }
+            audio_ring_commit(&s_audio_ring, n, 0);
+        }
+        
+        if (done == block.samples) {
+            taskENTER_CRITICAL(&s_clock_lock);
+            s_clock_count = audio_ring_write_count(&s_audio_ring);
+            s_clock_us = block.timestamp_us;
+            taskEXIT_CRITICAL(&s_clock_lock);
+        }
+#ifdef USE_ECHO_CANCEL
+        if (have_ref) {
+            audio_aec_stats_t aec_stats;
+            audio_aec_get_stats(&s_echo_canceller, &aec_stats);
+            taskENTER_CRITICAL(&s_aec_stats_lock);
+            s_aec_stats = aec_stats;
+            taskEXIT_CRITICAL(&s_aec_stats_lock);
+        }
+#endif
+        xTaskNotifyGive(s_detector_task);
+    }
+}
+
+// 印出環形緩衝區統計與檢測任務負載（每切片處理時間 / 切片長度）
+// latency_us: 切片最後一個樣本被擷取到推理完成的時間總和
+static void log_pipeline_stats(int64_t busy_us, int64_t latency_us, uint32_t slices, size_t slice_size) {
+    audio_ring_stats_t stats;
+    audio_ring_get_stats(&s_audio_ring, &stats);
+    int64_t slice_us = (int64_t)slice_size * 1000000 / I2S_SAMPLE_RATE;
+    ESP_LOGI(TAG, "🧵 環形緩衝區: 填充 %lu/%lu, 最高 %lu, overflow %lu 次 (%lu 樣本), underrun %lu 次, DMA 丟棄 %u 區塊",
+             (unsigned long)stats.fill, (unsigned long)stats.size, (unsigned long)stats.high_water,
+             (unsigned long)stats.overflows, (unsigned long)stats.overflow_samples,
+             (unsigned long)stats.underruns, atomic_load(&s_dma_dropped_blocks));
+    ESP_LOGI(TAG, "🧵 檢測任務: 平均 %lld us/切片（切片長度 %lld us, 負載 %lld%%），平均延遲 %lld us",
+             (long long)(busy_us / slices), (long long)slice_us,
+             (long long)(busy_us * 100 / ((int64_t)slices * slice_us)),
+             (long long)(latency_us / slices));
+}
+
+// 印出 VAD 統計：略過的推理比例、語音起點次數、各頻帶噪音底
+static void log_vad_stats(vad_t *vad, uint32_t inferences, uint32_t suppressed) {
+    vad_stats_t stats;
+    vad_get_stats(vad, &stats);
+    uint32_t slices = inferences + suppressed;
+    ESP_LOGI(TAG, "🔇 VAD: 推理 %lu 次, 略過 %lu 切片 (%lu%%), 語音起點 %lu 次, 語音幀 %lu/%lu",
+             (unsigned long)inferences, (unsigned long)suppressed,
+             (unsigned long)(slices > 0 ? (uint64_t)suppressed * 100 / slices : 0),
+             (unsigned long)stats.onsets, (unsigned long)stats.speech_frames, (unsigned long)stats.frames);
+    ESP_LOGI(TAG, "🔇 VAD 噪音底: %.1f / %.1f / %.1f / %.1f dB（<250 Hz / 250-1k / 1k-4k / 4k-8k）",
+             stats.noise_floor_db[0], stats.noise_floor_db[1], stats.noise_floor_db[2], stats.noise_floor_db[3]);
+}
+
+#ifdef USE_CASCADE
+// 稽核時（模型看到整段語音）第一級分數的分佈，換算成各門檻的操作點（開機以來累計）
+// hits: 模型確認的喚醒詞，分數 <= 門檻就是第一級會送進模型（召回）
+// segments: 所有語音段（含喚醒詞），分數 <= 門檻的比例約等於第二級的工作量
+typedef struct {
+    uint32_t hits;
+    uint32_t hits_passed[CASCADE_TABLE_ROWS];
+    uint32_t segments;
+    uint32_t segments_passed[CASCADE_TABLE_ROWS];
+} cascade_table_t;
+
+static void cascade_table_add(uint32_t *total, uint32_t *passed, float score_db) {
+    (*total)++;
+    for (int i = 0; i < CASCADE_TABLE_ROWS; i++) {
+        if (score_db <= CASCADE_TABLE_MIN_DB + i * CASCADE_TABLE_STEP_DB) {
+            passed[i]++;
+        }
+    }
+}
+
+static void log_cascade_table(const cascade_table_t *table) {
+    if (table->segments == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "🪜 門檻 / 召回表（稽核的 %lu 段語音，其中喚醒詞 %lu 次）:",
+             (unsigned long)table->segments, (unsigned long)table->hits);
+    for (int i = 0; i < CASCADE_TABLE_ROWS; i++) {
+        ESP_LOGI(TAG, "🪜   %.1f dB: 召回 %lu/%lu (%lu%%)，送進模型的語音段 %lu%%",
+                 CASCADE_TABLE_MIN_DB + i * CASCADE_TABLE_STEP_DB,
+                 (unsigned long)table->hits_passed[i], (unsigned long)table->hits,
+                 (unsigned long)(table->hits > 0 ? table->hits_passed[i] * 100 / table->hits : 0),
+                 (unsigned long)(table->segments_passed[i] * 100 / table->segments));
+    }
+}
+
+// 印出級聯統計：兩級各自的 CPU 佔用（處理時間 / 音訊時間），送進模型的切片比例，稽核時第一級漏掉的次數
+// forwarded: 送進模型的切片數（不含補送的切片），model_us: 模型的處理時間（含補送）
+static void log_cascade_stats(wake_gate_t *gate, int64_t gate_us, int64_t model_us, uint32_t forwarded,
+                              uint32_t slices, size_t slice_size, uint32_t audit_hits, uint32_t audit_missed) {
+    wake_gate_stats_t stats;
+    wake_gate_get_stats(gate, &stats);
+    int64_t audio_us = (int64_t)slices * slice_size * 1000000 / I2S_SAMPLE_RATE;
+    ESP_LOGI(TAG, "🪜 第一級: %lld us/切片（CPU %.2f%%，%lu cycles/10 ms），候選 %lu 次，模板 %lu 個（登錄 %lu 次）",
+             (long long)(gate_us / slices), gate_us * 100.0 / audio_us, (unsigned long)stats.cycles_per_10ms,
+             (unsigned long)stats.candidates, (unsigned long)stats.templates, (unsigned long)stats.enrolled);
+    ESP_LOGI(TAG, "🪜 第二級: 送進模型 %lu/%lu 切片 (%lu%%)，CPU %.2f%%；檢測任務共 %.2f%%",
+             (unsigned long)forwarded, (unsigned long)slices, (unsigned long)(forwarded * 100 / slices),
+             model_us * 100.0 / audio_us, (gate_us + model_us) * 100.0 / audio_us);
+    ESP_LOGI(TAG, "🪜 稽核: 模型確認 %lu 次，其中第一級漏掉 %lu 次",
+             (unsigned long)audit_hits, (unsigned long)audit_missed);
+}
+#endif
+
+// 從預錄環形緩衝區補送 start 之前最多 count 個切片給模型（不早於 origin：更早的音訊不連續）
+// 返回補送的切片數
+static uint32_t prime_stream(uint32_t start, uint32_t origin, size_t count, int16_t *buffer, size_t slice_size) {
+    size_t available = (start - origin) / slice_size;
+    if (count > available) {
+        count = available;
+    }
+    uint32_t fed = 0;
+    for (size_t i = count; i > 0; i--) {
+        if (audio_history_read(&s_audio_history, start - i * slice_size, buffer, slice_size) != ESP_OK) {
+            continue;
+        }
+        ei_wrapper_run_inference_slice(buffer, slice_size);
+        fed++;
+    }
+    return fed;
+}
+
+// 檢測任務（使用 Edge Impulse 連續推理）：從環形緩衝區取出切片並推理
+static void detector_task(void *arg) {
+    ESP_LOGI(TAG, "🎤 開始監聽 'Hi Lemon'（檢測任務在核心 %d）...", xPortGetCoreID());
     ESP_LOGI(TAG, "💡 使用 Edge Impulse 模型進行檢測（24-bit 音質）");
     
-    int16_t *window_buffer = (int16_t*)malloc(EI_WINDOW_SIZE * sizeof(int16_t));
-    if (window_buffer == NULL) {
+    const size_t slice_size = ei_wrapper_get_slice_size();
+    const size_t slices_per_window = ei_wrapper_get_slices_per_window();
+    ESP_LOGI(TAG, "🧩 連續推理: 每窗口 %zu 切片，每切片 %zu 樣本 (%d ms)",
+             slices_per_window, slice_size, (int)(slice_size * 1000 / I2S_SAMPLE_RATE));
+    
+    // 目前的切片，與補送前面切片（從預錄環形緩衝區讀出）用的緩衝區
+    int16_t *slice_buffer = (int16_t*)malloc(slice_size * sizeof(int16_t));
+    int16_t *prime_buffer = (int16_t*)malloc(slice_size * sizeof(int16_t));
+    if (slice_buffer == NULL || prime_buffer == NULL) {
         ESP_LOGE(TAG, "❌ 無法分配檢測緩衝區");
+        vTaskDelete(NULL);
         return;
     }
     
-    // 32-bit 緩衝區用於接收 I2S 數據
-    int32_t temp_buffer_32[AUDIO_BUFFER_SIZE];
-    int16_t temp_buffer_16[AUDIO_BUFFER_SIZE];
-    size_t window_pos = 0;
+    static vad_t vad;
+    esp_err_t vad_ret = vad_init(&vad);
+    if (vad_ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ VAD 初始化失敗: %s", esp_err_to_name(vad_ret));
+        vTaskDelete(NULL);
+        return;
+    }
+    
+#ifdef USE_CASCADE
+    static wake_gate_t gate;
+    wake_gate_config_t gate_cfg;
+    wake_gate_default_config(&gate_cfg);
+    gate_cfg.threshold_db = CASCADE_THRESHOLD_DB;
+    esp_err_t gate_ret = wake_gate_init(&gate, &gate_cfg);
+    if (gate_ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 第一級檢測初始化失敗: %s", esp_err_to_name(gate_ret));
+        vTaskDelete(NULL);
+        return;
+    }
+    gate_ret = wake_gate_load(&gate);
+    if (gate_ret == ESP_OK) {
+        ESP_LOGI(TAG, "🪜 級聯檢測: 從 NVS 載入 %lu 個模板，門檻 %.1f dB",
+                 (unsigned long)wake_gate_template_count(&gate), gate_cfg.threshold_db);
+    } else {
+        ESP_LOGI(TAG, "🪜 級聯檢測: 還沒有模板（%s），先只用 VAD 把關，模型確認喚醒詞後自動登錄",
+                 esp_err_to_name(gate_ret));
+    }
+    // 登錄用的特徵：一個模型窗口
+    const uint32_t window_frames = slices_per_window * slice_size / WAKE_GATE_FRAME_SAMPLES;
+    bool in_speech = false;
+    bool learning = true;           // 這段語音開始時還沒有模板
+    bool audit = true;              // 這段語音不經第一級，直接送進模型
+    bool run_candidate = false;     // 這段語音中第一級出現過候選
+    uint32_t hold = 0;              // 候選之後還要送進模型的切片數
+    uint32_t onsets = 0;
+    uint32_t forwarded = 0;
+    uint32_t audit_hits = 0;
+    uint32_t audit_missed = 0;
+    static cascade_table_t table;
+    int64_t gate_us = 0;
+    int64_t model_us = 0;
+#endif
+    
+    bool stream_live = false;       // 滾動特徵是否連續（略過推理或錄音後就中斷）
+    uint32_t stream_origin = audio_ring_read_count(&s_audio_ring);  // 連續音訊的起點（錄音後重新開始）
+    uint32_t slice_count = 0;
+    uint32_t inferences = 0;
+    uint32_t suppressed = 0;
+    int64_t busy_us = 0;
+    int64_t latency_us = 0;
     
     while (1) {
-        size_t bytes_read = 0;
-        i2s_read(I2S_NUM, temp_buffer_32, sizeof(temp_buffer_32), &bytes_read, portMAX_DELAY);
-        size_t samples_read = bytes_read / sizeof(int32_t);
+        wait_for_audio(slice_size);
+        if (audio_ring_read(&s_audio_ring, slice_buffer, slice_size) == 0) {
+            continue;
+        }
+        int64_t start_us = esp_timer_get_time();
+        uint32_t slice_end = audio_ring_read_count(&s_audio_ring);
+        int64_t slice_end_us = capture_sample_time_us(slice_end);
+        
+        // 切片統計由擷取任務算好，O(區塊數)
+        audio_stats_t slice_stats;
+        audio_stats_history_range(&s_block_stats, slice_end - slice_size, slice_end, &slice_stats);
+        
+        bool speech = vad_process(&vad, slice_buffer, slice_size);
+#ifndef USE_VAD_GATE
+        speech = true;      // 只統計，不略過推理
+#endif
+        bool forward = speech;
+        size_t prime = 1;   // 語音起點：補送前一個切片當作起點前的上下文
+#ifdef USE_CASCADE
+        int64_t gate_start_us = esp_timer_get_time();
+        bool candidate = wake_gate_process(&gate, slice_buffer, slice_size);
+        gate_us += esp_timer_get_time() - gate_start_us;
+        
+        if (!speech && in_speech && audit && !learning) {
+            // 稽核的語音段結束：記下第一級在整段的最佳分數
+            float score_db = wake_gate_take_best(&gate);
+            cascade_table_add(&table.segments, table.segments_passed, score_db);
+        }
+        if (speech && !in_speech) {
+            // 新的一段語音：還沒有模板或輪到稽核時，整段直接送進模型
+            learning = wake_gate_template_count(&gate) == 0;
+            audit = learning || ++onsets % CASCADE_AUDIT_ONSETS == 0;
+            run_candidate = false;
+        }
+        in_speech = speech;
+        run_candidate |= candidate;
+        if (candidate) {
+            hold = slices_per_window;
+        }
+        if (!audit) {
+            // 候選出現時喚醒詞剛說完：補送整個窗口，再讓模型看接下來的幾個切片
+            forward = hold > 0;
+            prime = slices_per_window - 1;
+        }
+        if (hold > 0) {
+            hold--;
+        }
+        if (!forward) {
+            wake_gate_take_best(&gate);     // 檢測時印出的分數只算送進模型的這一段
+        }
+#endif
+        int label_idx = -1;
+        if (!forward) {
+            suppressed++;
+            stream_live = false;
+        } else {
+#ifdef USE_POWER_SAVE
+            power_burst_begin(&s_model_burst);
+#endif
+#ifdef USE_CASCADE
+            int64_t model_start_us = esp_timer_get_time();
+            forwarded++;
+#endif
+            if (!stream_live) {
+                // 滾動特徵已中斷：清空後先補送前面的切片，再送目前的切片
+                ei_wrapper_reset_stream();
+                inferences += prime_stream(slice_end - slice_size, stream_origin, prime, prime_buffer, slice_size);
+                stream_live = true;
+            }
+            // 送入模型期間每個切片都必須送入，滾動特徵矩陣才能保持連續
+            label_idx = ei_wrapper_run_inference_slice(slice_buffer, slice_size);
+            inferences++;
+#ifdef USE_CASCADE
+            model_us += esp_timer_get_time() - model_start_us;
+#endif
+#ifdef USE_POWER_SAVE
+            power_burst_end(&s_model_burst);
+#endif
+        }
+        
+        int64_t done_us = esp_timer_get_time();
+        busy_us += done_us - start_us;
+        latency_us += done_us - slice_end_us;
+        
+        if (++slice_count % KERNEL_STATS_INTERVAL == 0) {
+            ei_wrapper_log_kernel_stats();
+            ei_wrapper_log_op_profile();     // 只有 LEMON_WAKE_OP_PROFILE 建置會印
+            log_pipeline_stats(busy_us, latency_us, KERNEL_STATS_INTERVAL, slice_size);
+            log_vad_stats(&vad, inferences, suppressed);
+#ifdef USE_CASCADE
+            log_cascade_stats(&gate, gate_us, model_us, forwarded, KERNEL_STATS_INTERVAL, slice_size,
+                              audit_hits, audit_missed);
+            log_cascade_table(&table);
+            wake_gate_save(&gate);          // 寫入之前因為間隔太近而延後的模板
+            gate_us = 0;
+            model_us = 0;
+            forwarded = 0;
+#endif
+#ifdef USE_POWER_SAVE
+            power_manager_log_stats();
+#endif
+            busy_us = 0;
+            latency_us = 0;
+        }
+        
+        if (label_idx < 0) {
+            continue;
+        }
         
-        // 轉換 32-bit 到 16-bit
-        convert_32bit_to_16bit(temp_buffer_32, temp_buffer_16, samples_read);
+        const char* label = ei_wrapper_get_label(label_idx);
+        float scores[EI_WRAPPER_MAX_LABELS];
+        size_t score_count = ei_wrapper_get_last_scores(scores, EI_WRAPPER_MAX_LABELS);
+        ESP_LOGI(TAG, "📊 切片能量: %lld（峰值 %ld, 直流 %ld）", audio_stats_mean_energy(&slice_stats),
+                 (long)slice_stats.peak, (long)audio_stats_dc(&slice_stats));
+        ESP_LOGI(TAG, "🎯 檢測到: %s（信心 %.2f, 延遲 %lld ms）", label,
+                 (size_t)label_idx < score_count ? scores[label_idx] : 0.0f,
+                 (long long)((done_us - slice_end_us) / 1000));
         
-        // 填充滑動窗口
-        for (size_t i = 0; i < samples_read; i++) {
-            window_buffer[window_pos] = temp_buffer_16[i];
-            window_pos++;
+        // ei_wrapper 只返回設定的喚醒詞分類
+        if (strcmp(label, DETECTION_LABEL) == 0) {
+            ESP_LOGI(TAG, "🔊 檢測到 'Hi Lemon'！");
             
-            // 當窗口填滿時，執行檢測
-            if (window_pos >= EI_WINDOW_SIZE) {
-                // 檢查能量（避免處理靜音）
-                int64_t energy = calculate_energy(window_buffer, EI_WINDOW_SIZE);
-                
-                if (energy > ENERGY_THRESHOLD) {
-                    ESP_LOGI(TAG, "📊 檢測語音能量: %lld", energy);
-                    
-                    // 執行 Edge Impulse 推理
-                    int label_idx = ei_wrapper_run_inference(window_buffer, EI_WINDOW_SIZE);
-                    
-                    if (label_idx >= 0) {
-                        const char* label = ei_wrapper_get_label(label_idx);
-                        ESP_LOGI(TAG, "🎯 檢測到: %s", label);
-                        
-                        // 檢查是否為 "hi lemon" (索引 0)
-                        if (label_idx == 0 || strstr(label, "hi lemon") != NULL) {
-                            ESP_LOGI(TAG, "🔊 檢測到 'Hi Lemon'！");
-                            
-                            // 錄音並上傳
-                            record_and_upload();
-                            
-                            // 清空緩衝區，避免重複觸發
-                            window_pos = 0;
-                            memset(window_buffer, 0, EI_WINDOW_SIZE * sizeof(int16_t));
-                            
-                            ESP_LOGI(TAG, "🔄 繼續監聽...");
-                            vTaskDelay(pdMS_TO_TICKS(1000));
-                            continue;
-                        }
-                    }
+#ifdef USE_CASCADE
+            // 第一級在這段的最佳分數，用來調整門檻；稽核時沒有候選就是第一級漏掉
+            float score_db = wake_gate_take_best(&gate);
+            ESP_LOGI(TAG, "🪜 第一級最佳分數 %.2f dB（門檻 %.1f dB）%s", score_db,
+                     gate_cfg.threshold_db, learning ? "，登錄中" : (audit ? "，稽核" : ""));
+            if (audit && !learning) {
+                audit_hits++;
+                if (!run_candidate) {
+                    audit_missed++;
                 }
-                
-                // 滑動窗口
-                memmove(window_buffer, window_buffer + EI_SLIDE_SIZE, 
-                       (EI_WINDOW_SIZE - EI_SLIDE_SIZE) * sizeof(int16_t));
-                window_pos = EI_WINDOW_SIZE - EI_SLIDE_SIZE;
+                cascade_table_add(&table.hits, table.hits_passed, score_db);
+                cascade_table_add(&table.segments, table.segments_passed, score_db);
             }
+#endif
+            
+            // 播放中喚醒：中止 TTS 播放（DMA 中剩下的 80 ms 會播完）與還沒完成的下載
+            if (atomic_load(&s_tts_playing)) {
+                ESP_LOGI(TAG, "⏹️ 打斷 TTS 播放");
+            }
+            atomic_fetch_add(&s_tts_generation, 1);
+            
+            // 錄音並上傳：從觸發切片的開頭開始錄（喚醒詞結尾落在這個切片內），
+            // 判定期間已經說出的指令在預錄環形緩衝區裡，不會漏掉；錄完後暫停寫入
+            esp_err_t upload_ret = record_and_upload(slice_end - slice_size, &vad);
+#ifdef USE_CASCADE
+            // 模型確認之外，還要指令上傳成功（伺服器有響應）才把這次的喚醒詞登錄為模板；
+            // 錄音期間第一級沒有送入音訊，特徵歷史的結尾仍是觸發的模型窗口
+            if (upload_ret == ESP_OK && wake_gate_template_count(&gate) < WAKE_GATE_MAX_TEMPLATES &&
+                wake_gate_enroll(&gate, window_frames) == ESP_OK) {
+                esp_err_t save_ret = wake_gate_save(&gate);
+                ESP_LOGI(TAG, "🧬 第一級登錄模板（%lu/%d）%s", (unsigned long)wake_gate_template_count(&gate),
+                         WAKE_GATE_MAX_TEMPLATES,
+                         save_ret == ESP_OK ? "" : (save_ret == ESP_ERR_NOT_FINISHED ? "，稍後寫入 NVS" : "，NVS 寫入失敗"));
+            }
+#else
+            (void)upload_ret;
+#endif
+            
+            // 丟掉暫停前殘留的音訊，恢復擷取
+            audio_ring_flush(&s_audio_ring);
+            stream_origin = audio_ring_read_count(&s_audio_ring);
+            atomic_store(&s_capture_paused, false);
+            
+            // 串流已中斷：下一個語音切片會重新開始滾動特徵，避免重複觸發
+            stream_live = false;
+            vad_reset_activity(&vad);
+#ifdef USE_CASCADE
+            wake_gate_reset_stream(&gate);
+            in_speech = false;
+            hold = 0;
+#endif
+            
+            ESP_LOGI(TAG, "🔄 繼續監聽...");
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+// 建立環形緩衝區與兩個任務：擷取在核心 0，檢測在核心 1
+static esp_err_t start_audio_pipeline(void) {
+    esp_err_t ret = audio_ring_init(&s_audio_ring, AUDIO_RING_SAMPLES);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 環形緩衝區配置失敗: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = audio_history_init(&s_audio_history, AUDIO_HISTORY_SAMPLES);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 預錄環形緩衝區配置失敗（需要 PSRAM）: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    audio_agc_config_t agc_cfg;
+    audio_agc_default_config(&agc_cfg, I2S_SAMPLE_RATE);
+    ret = audio_agc_init(&s_upload_agc, &agc_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 自動增益參數錯誤: %s", esp_err_to_name(ret));
+        return ret;
+    }
+#ifdef USE_UPLOAD_NS
+    audio_ns_config_t ns_cfg;
+    audio_ns_default_config(&ns_cfg);
+    ret = audio_ns_init(&s_upload_ns, &ns_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 頻譜降噪初始化失敗: %s", esp_err_to_name(ret));
+        return ret;
+    }
+#endif
+    
+#ifdef USE_ECHO_CANCEL
+    ret = audio_history_init_internal(&s_speaker_ref, AEC_REF_HISTORY_SAMPLES);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 喇叭參考環形緩衝區配置失敗: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    audio_aec_config_t aec_cfg;
+    audio_aec_default_config(&aec_cfg);
+    ret = audio_aec_init(&s_echo_canceller, &aec_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 回音消除參數錯誤: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    audio_set_sent_tap(on_speaker_sent);
+    ESP_LOGI(TAG, "🔁 回音消除: NLMS %d taps（%d ms），μ = %.2f，參考提前 %d 樣本",
+             aec_cfg.taps, aec_cfg.taps * 1000 / I2S_SAMPLE_RATE, aec_cfg.step, AEC_REF_LEAD_SAMPLES);
+#endif
+    
+#ifdef USE_CAPTURE_FILTER
+    audio_filter_config_t filter_cfg;
+    audio_filter_default_config(&filter_cfg, I2S_SAMPLE_RATE);
+    filter_cfg.hpf_cutoff_hz = CAPTURE_HPF_CUTOFF_HZ;
+    filter_cfg.hpf_order = CAPTURE_HPF_ORDER;
+    filter_cfg.expander_threshold_db = CAPTURE_EXPANDER_THRESHOLD_DB;
+    ret = audio_filter_init(&s_capture_filter, &filter_cfg);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ 擷取前處理參數錯誤: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "🎛️  擷取前處理: 直流阻隔 %.0f Hz，高通 %.0f Hz %d 階，擴展器 %.0f dBFS 以下 1:%.0f",
+             filter_cfg.dc_cutoff_hz, filter_cfg.hpf_cutoff_hz, filter_cfg.hpf_order,
+             filter_cfg.expander_threshold_db, filter_cfg.expander_ratio);
+#endif
+    
+#ifdef USE_POWER_SAVE
+    power_burst_init(&s_model_burst, "model");
+    power_burst_init(&s_upload_burst, "upload");
+    power_burst_init(&s_player_burst, "player");
+#endif
+    
+    s_upload_done = xSemaphoreCreateBinary();
+    if (s_upload_done == NULL) {
+        ESP_LOGE(TAG, "❌ 無法建立上傳信號量");
+        return ESP_ERR_NO_MEM;
+    }
+    s_tts_queue = xQueueCreate(1, sizeof(tts_request_t));
+    if (s_tts_queue == NULL) {
+        ESP_LOGE(TAG, "❌ 無法建立播放佇列");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // 檢測任務與上傳任務先建立，擷取任務一開始寫入就能通知檢測任務
+    if (xTaskCreatePinnedToCore(detector_task, "detector", DETECTOR_TASK_STACK, NULL,
+                                DETECTOR_TASK_PRIORITY, &s_detector_task, DETECTOR_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "❌ 無法建立檢測任務");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(upload_task, "upload", UPLOAD_TASK_STACK, NULL,
+                                UPLOAD_TASK_PRIORITY, &s_upload_task, UPLOAD_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "❌ 無法建立上傳任務");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(player_task, "player", PLAYER_TASK_STACK, NULL,
+                                PLAYER_TASK_PRIORITY, NULL, PLAYER_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "❌ 無法建立播放任務");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(capture_task, "capture", CAPTURE_TASK_STACK, NULL,
+                                CAPTURE_TASK_PRIORITY, NULL, CAPTURE_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "❌ 無法建立擷取任務");
+        return ESP_ERR_NO_MEM;
     }
     
-    free(window_buffer);
+    // 兩個任務都就緒後才開始 DMA，第一個區塊就有人接收
+    ret = i2s_channel_enable(s_rx_chan);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "❌ I2S 通道啟用失敗: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "🧵 音訊管線: 擷取任務（核心 %d）→ 環形緩衝區 %d 樣本 → 檢測任務（核心 %d）",
+             CAPTURE_TASK_CORE, AUDIO_RING_SAMPLES, DETECTOR_TASK_CORE);
+    ESP_LOGI(TAG, "🧵 預錄環形緩衝區: %d 樣本（%d ms，PSRAM）",
+             AUDIO_HISTORY_SAMPLES, AUDIO_HISTORY_SAMPLES * 1000 / I2S_SAMPLE_RATE);
+    return ESP_OK;
 }
 
 void app_main(void) {
@@ -443,6 +1345,9 @@ void app_main(void) {
     // 初始化 Edge Impulse
     ESP_LOGI(TAG, "🤖 初始化 Edge Impulse 模型...");
     ei_wrapper_init();
+    if (ei_wrapper_set_detection(DETECTION_LABEL, DETECTION_CONFIDENCE) != 0) {
+        ESP_LOGE(TAG, "❌ 喚醒詞判斷設定失敗，沿用預設");
+    }
     
     // 連接 WiFi
     ESP_LOGI(TAG, "📡 連接 WiFi...");
@@ -468,6 +1373,14 @@ void app_main(void) {
     if (sd_card_init() != ESP_OK) {
         ESP_LOGW(TAG, "⚠️ SD 卡初始化失敗（將無法保存音檔）");
     }
+
+#if LEMON_WAKE_MFE_VALIDATE
+    // 比對定點與浮點 MFE 前端（需要 SD 卡）
+    if (sd_is_mounted()) {
+        ESP_LOGI(TAG, "🔬 比對 MFE 前端: %s", MFE_VALIDATE_DIR);
+        ei_wrapper_validate_mfe(MFE_VALIDATE_DIR);
+    }
+#endif
     
     // 初始化音頻輸出
     ESP_LOGI(TAG, "🔊 初始化音頻輸出...");
@@ -488,12 +1401,22 @@ void app_main(void) {
     ESP_LOGI(TAG, "   SD  → GPIO %d", I2S_DATA_PIN);
     ESP_LOGI(TAG, "");
     ESP_LOGI(TAG, "🗣️  請清楚地說 'Hi Lemon' 來觸發錄音");
-    ESP_LOGI(TAG, "📤 檢測到關鍵詞後會錄音 %d 秒並上傳", RECORD_TIME_MS / 1000);
+    ESP_LOGI(TAG, "📤 檢測到關鍵詞後會錄音（說完靜音 %d ms 即停止，最長 %d 秒）並上傳",
+             RECORD_END_SILENCE_MS, RECORD_MAX_MS / 1000);
     ESP_LOGI(TAG, "🎵 音訊品質: %d kHz, 24-bit (INMP441 原生), 單聲道", I2S_SAMPLE_RATE / 1000);
     ESP_LOGI(TAG, "🤖 使用 Edge Impulse 模型檢測");
     ESP_LOGI(TAG, "💡 24-bit 模式提供更好的動態範圍和音質");
     ESP_LOGI(TAG, "");
     
-    // 開始監聽
-    listen_for_hi_lemon();
+#ifdef USE_POWER_SAVE
+    // 開機時的連線與位置查詢都完成了，之後只有運算密集的區段跑全速
+    ret = power_manager_init(POWER_LIGHT_SLEEP);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "⚠️ 動態調頻未啟用（需要 CONFIG_PM_ENABLE）: %s", esp_err_to_name(ret));
+    }
+    wifi_set_power_save(true);
+#endif
+    
+    // 開始監聽（擷取與檢測各自在一個核心上執行）
+    start_audio_pipeline();
 }
@@ -0,0 +1,146 @@
+#include "power_manager.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "POWER";
+
+static power_burst_t *s_bursts[POWER_MAX_BURSTS];
+static int s_burst_count = 0;
+static int64_t s_stats_start_us = 0;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static configRUN_TIME_COUNTER_TYPE s_idle_start[CONFIG_FREERTOS_NUMBER_OF_CORES];
+#endif
+
+// 各核心 idle 任務到目前為止的執行時間（runtime stats 以 esp_timer 計時，單位 us）
+static void snapshot_idle(void) {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    for (int core = 0; core < CONFIG_FREERTOS_NUMBER_OF_CORES; core++) {
+        s_idle_start[core] = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+    }
+#endif
+}
+
+esp_err_t power_manager_init(bool light_sleep)
+{
+    s_stats_start_us = esp_timer_get_time();
+    snapshot_idle();
+
+    esp_pm_config_t config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = POWER_MIN_CPU_FREQ_MHZ,
+        .light_sleep_enable = light_sleep,
+    };
+    esp_err_t ret = esp_pm_configure(&config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "🔋 動態調頻: %d ~ %d MHz，light sleep %s", POWER_MIN_CPU_FREQ_MHZ,
+             CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, light_sleep ? "開啟" : "關閉");
+    return ESP_OK;
+}
+
+esp_err_t power_burst_init(power_burst_t *burst, const char *name)
+{
+    if (s_burst_count >= POWER_MAX_BURSTS) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(burst, 0, sizeof(*burst));
+    burst->name = name;
+    portMUX_INITIALIZE(&burst->stats_lock);
+
+    // 沒有啟用 CONFIG_PM_ENABLE 時返回 ESP_ERR_NOT_SUPPORTED：本來就是全速，照樣統計
+    esp_err_t ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, name, &burst->lock);
+    if (ret != ESP_OK) {
+        burst->lock = NULL;
+        if (ret != ESP_ERR_NOT_SUPPORTED) {
+            return ret;
+        }
+    }
+    s_bursts[s_burst_count++] = burst;
+    return ESP_OK;
+}
+
+void power_burst_begin(power_burst_t *burst)
+{
+    int64_t start_us = esp_timer_get_time();
+    if (burst->lock != NULL) {
+        esp_pm_lock_acquire(burst->lock);
+    }
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&burst->stats_lock);
+    burst->begin_us = now_us;
+    burst->count++;
+    burst->switch_us += now_us - start_us;
+    if (now_us - start_us > burst->switch_max_us) {
+        burst->switch_max_us = now_us - start_us;
+    }
+    taskEXIT_CRITICAL(&burst->stats_lock);
+}
+
+void power_burst_end(power_burst_t *burst)
+{
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&burst->stats_lock);
+    if (burst->begin_us != 0) {
+        burst->held_us += now_us - burst->begin_us;
+        burst->begin_us = 0;
+    }
+    taskEXIT_CRITICAL(&burst->stats_lock);
+
+    if (burst->lock != NULL) {
+        esp_pm_lock_release(burst->lock);
+    }
+}
+
+void power_manager_log_stats(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    int64_t elapsed_us = now_us - s_stats_start_us;
+    if (elapsed_us <= 0) {
+        return;
+    }
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // 活躍時間 = 1 - idle 任務的時間比例（light sleep 也算在 idle 裡）
+    char line[96];
+    int len = 0;
+    for (int core = 0; core < CONFIG_FREERTOS_NUMBER_OF_CORES; core++) {
+        configRUN_TIME_COUNTER_TYPE idle = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+        int64_t idle_us = (int64_t)(configRUN_TIME_COUNTER_TYPE)(idle - s_idle_start[core]);
+        float active = 100.0f - (float)idle_us * 100.0f / elapsed_us;
+        len += snprintf(line + len, sizeof(line) - len, "%s核心 %d %.1f%%", core > 0 ? "，" : "",
+                        core, active < 0.0f ? 0.0f : active);
+    }
+    ESP_LOGI(TAG, "🔋 活躍時間: %s（%lld 秒內）", line, (long long)(elapsed_us / 1000000));
+#endif
+    snapshot_idle();
+    s_stats_start_us = now_us;
+
+    for (int i = 0; i < s_burst_count; i++) {
+        power_burst_t *burst = s_bursts[i];
+        taskENTER_CRITICAL(&burst->stats_lock);
+        // 進行中的 burst 算到現在為止
+        if (burst->begin_us != 0) {
+            burst->held_us += now_us - burst->begin_us;
+            burst->begin_us = now_us;
+        }
+        int64_t held_us = burst->held_us;
+        uint32_t count = burst->count;
+        int64_t switch_us = burst->switch_us;
+        int64_t switch_max_us = burst->switch_max_us;
+        burst->held_us = 0;
+        burst->count = 0;
+        burst->switch_us = 0;
+        burst->switch_max_us = 0;
+        taskEXIT_CRITICAL(&burst->stats_lock);
+
+        ESP_LOGI(TAG, "🔋 %s: 全速 %.2f%% 的時間（%lu 次），切換到全速平均 %lld us、最長 %lld us",
+                 burst->name, (float)held_us * 100.0f / elapsed_us, (unsigned long)count,
+                 (long long)(count > 0 ? switch_us / count : 0), (long long)switch_max_us);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include "esp_err.h"
+#include "esp_pm.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 電源管理：以 esp_pm 做動態調頻，平常 CPU 降到 POWER_MIN_CPU_FREQ_MHZ，
+// 只有推理、TLS、回音消除等運算密集的區段（burst）拿 ESP_PM_CPU_FREQ_MAX 鎖跑全速。
+// 沒有任何鎖時自動進入 light sleep（麥克風的 I2S 通道啟用期間驅動會持有 APB 鎖，持續監聽時不會睡）。
+// 統計各 burst 的全速時間與切換頻率的等待時間，以及各核心的活躍時間（非 idle 任務的比例）。
+
+#define POWER_MIN_CPU_FREQ_MHZ  80      // I2S 持有 APB 鎖時 CPU 最低就是 80 MHz
+#define POWER_MAX_BURSTS        4
+
+// 一個運算區段的頻率鎖（每個任務各用一個，才能分開統計）
+typedef struct {
+    const char *name;
+    esp_pm_lock_handle_t lock;      // 沒有啟用 CONFIG_PM_ENABLE 時是 NULL，只統計不鎖頻率
+    portMUX_TYPE stats_lock;
+    int64_t begin_us;               // 這次 burst 開始的時間
+    int64_t held_us;                // 上次統計之後全速的時間總和
+    uint32_t count;                 // 上次統計之後的 burst 次數
+    int64_t switch_us;              // 取得鎖（切換到全速）花的時間總和
+    int64_t switch_max_us;
+} power_burst_t;
+
+// 設定動態調頻與 light sleep（需要 CONFIG_PM_ENABLE；light sleep 需要 CONFIG_FREERTOS_USE_TICKLESS_IDLE）
+// 返回 ESP_ERR_NOT_SUPPORTED 時維持全速，burst 只統計
+esp_err_t power_manager_init(bool light_sleep);
+
+// 建立 burst 的頻率鎖並登記到統計（最多 POWER_MAX_BURSTS 個）
+esp_err_t power_burst_init(power_burst_t *burst, const char *name);
+
+// 開始 / 結束運算區段（只能由同一個任務呼叫，不能巢狀）
+void power_burst_begin(power_burst_t *burst);
+void power_burst_end(power_burst_t *burst);
+
+// 印出上次呼叫之後各核心的活躍時間、各 burst 的全速時間比例與切換時間，然後歸零
+void power_manager_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_MANAGER_H
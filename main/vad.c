@@ -0,0 +1,200 @@
+#include "vad.h"
+#include "dsps_fft2r.h"
+#include "esp_heap_caps.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define VAD_MIN_ENERGY          1e-2f   // 噪音底下限（數位靜音時避免除以 0）
+#define VAD_FLOOR_DOWN_RATE     0.1f    // 能量低於噪音底時快速跟下去
+#define VAD_FLOOR_UP_RATE       0.02f   // 非語音時每幀最多上升 2%（約 8.6 dB/秒）
+#define VAD_FLOOR_ACTIVE_RATE   0.005f  // 語音狀態中慢很多（約 2 dB/秒），開了風扇等持續的新噪音幾秒後仍會被吸收
+
+// 頻帶範圍（FFT bin，125 Hz / bin，不含直流 bin 0）
+static const uint8_t s_band_start[VAD_BANDS] = { 1, 2, 8, 32 };
+static const uint8_t s_band_end[VAD_BANDS] = { 2, 8, 32, VAD_FFT_SIZE / 2 };
+
+// 只有檢測任務使用 VAD，FFT 工作區與窗函數放在靜態記憶體
+static int16_t s_window[VAD_FFT_SIZE];                              // Hann，Q15
+static int16_t s_fft[VAD_FFT_SIZE * 2] __attribute__((aligned(16)));  // 交錯的實部 / 虛部
+static float s_snr_ratio;
+static float s_high_snr_ratio;
+
+// sc16 FFT 只有一份全域旋轉因子表，與 MFE 定點前端共用（同樣是 128 點複數 FFT）
+static esp_err_t init_fft(void) {
+    if (dsps_fft2r_sc16_initialized) {
+        return dsps_fft_w_table_sc16_size >= VAD_FFT_SIZE ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+    int16_t *table = (int16_t *)heap_caps_aligned_calloc(16, VAD_FFT_SIZE, sizeof(int16_t),
+                                                         MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (table == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = dsps_fft2r_init_sc16(table, VAD_FFT_SIZE);
+    if (ret != ESP_OK) {
+        heap_caps_free(table);
+    }
+    return ret;
+}
+
+esp_err_t vad_init(vad_t *vad)
+{
+    memset(vad, 0, sizeof(*vad));
+
+    esp_err_t ret = init_fft();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    for (int i = 0; i < VAD_FFT_SIZE; i++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / VAD_FFT_SIZE);
+        s_window[i] = (int16_t)lrintf(w * 32767.0f);
+    }
+    s_snr_ratio = powf(10.0f, VAD_SNR_THRESHOLD_DB / 10.0f);
+    s_high_snr_ratio = powf(10.0f, VAD_HIGH_SNR_THRESHOLD_DB / 10.0f);
+    return ESP_OK;
+}
+
+// 各頻帶能量（FFT 單位，與幀的音量成正比，不受區塊縮放影響）
+static void frame_band_energy(const int16_t *frame, float *energy) {
+    const int16_t *x = frame + VAD_FRAME_SAMPLES - VAD_FFT_SIZE;
+
+    // 區塊浮點：先左移到接近滿刻度，安靜的房間也不會被 FFT 每級除以 2 量化掉
+    int32_t peak = 0;
+    for (int i = 0; i < VAD_FFT_SIZE; i++) {
+        peak = MAX(peak, abs(x[i]));
+    }
+    int shift = 0;
+    while (peak > 0 && (peak << (shift + 1)) < 32768 && shift < 12) {
+        shift++;
+    }
+
+    for (int i = 0; i < VAD_FFT_SIZE; i++) {
+        s_fft[2 * i] = (int16_t)((x[i] * (1 << shift) * s_window[i]) >> 15);
+        s_fft[2 * i + 1] = 0;
+    }
+    dsps_fft2r_sc16(s_fft, VAD_FFT_SIZE);
+    dsps_bit_rev_sc16_ansi(s_fft, VAD_FFT_SIZE);
+
+    const float scale = ldexpf(1.0f, -2 * shift);
+    for (int b = 0; b < VAD_BANDS; b++) {
+        uint64_t sum = 0;
+        for (int k = s_band_start[b]; k < s_band_end[b]; k++) {
+            int32_t re = s_fft[2 * k];
+            int32_t im = s_fft[2 * k + 1];
+            sum += (uint32_t)(re * re) + (uint32_t)(im * im);
+        }
+        energy[b] = (float)sum * scale;
+    }
+}
+
+static bool process_frame(vad_t *vad, const int16_t *frame) {
+    float *energy = vad->last_energy;
+    float *noise = vad->noise_floor;
+    frame_band_energy(frame, energy);
+
+    uint32_t n = vad->stats.frames++;
+    if (n < VAD_INIT_FRAMES) {
+        // 噪音底 = 前幾幀的平均
+        for (int b = 0; b < VAD_BANDS; b++) {
+            noise[b] = MAX(noise[b] + (energy[b] - noise[b]) / (float)(n + 1), VAD_MIN_ENERGY);
+        }
+        return false;
+    }
+
+    // 哼聲頻帶（<250 Hz）只統計，不參與判定
+    bool speech = (energy[1] + energy[2]) > (noise[1] + noise[2]) * s_snr_ratio ||
+                  energy[3] > noise[3] * s_high_snr_ratio;
+
+    // 往下線性跟隨；往上每幀最多乘上 (1 + rate)，語音再大聲也只能慢慢抬高噪音底
+    for (int b = 0; b < VAD_BANDS; b++) {
+        if (energy[b] < noise[b]) {
+            noise[b] = MAX(noise[b] + (energy[b] - noise[b]) * VAD_FLOOR_DOWN_RATE, VAD_MIN_ENERGY);
+        } else {
+            float rate = vad->active ? VAD_FLOOR_ACTIVE_RATE : VAD_FLOOR_UP_RATE;
+            noise[b] = MIN(energy[b], noise[b] * (1.0f + rate));
+        }
+    }
+
+    if (speech) {
+        vad->silence_run = 0;
+        vad->stats.speech_frames++;
+        if (!vad->active && ++vad->speech_run >= VAD_ONSET_FRAMES) {
+            vad->active = true;
+            vad->stats.onsets++;
+        }
+        if (vad->active) {
+            vad->hangover = VAD_HANGOVER_FRAMES;
+        }
+    } else {
+        vad->silence_run++;
+        vad->speech_run = 0;
+        if (vad->active && --vad->hangover == 0) {
+            vad->active = false;
+        }
+    }
+
+    if (vad->active) {
+        vad->stats.active_frames++;
+    }
+    return vad->active;
+}
+
+bool vad_process(vad_t *vad, const int16_t *samples, size_t length)
+{
+    bool any_active = vad->active;
+
+    while (length > 0) {
+        // 沒有殘留樣本時直接處理輸入，不必複製
+        if (vad->pending_count == 0 && length >= VAD_FRAME_SAMPLES) {
+            any_active |= process_frame(vad, samples);
+            samples += VAD_FRAME_SAMPLES;
+            length -= VAD_FRAME_SAMPLES;
+            continue;
+        }
+
+        size_t n = VAD_FRAME_SAMPLES - vad->pending_count;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(vad->pending + vad->pending_count, samples, n * sizeof(int16_t));
+        vad->pending_count += n;
+        samples += n;
+        length -= n;
+        if (vad->pending_count == VAD_FRAME_SAMPLES) {
+            any_active |= process_frame(vad, vad->pending);
+            vad->pending_count = 0;
+        }
+    }
+    return any_active;
+}
+
+uint32_t vad_trailing_silence_frames(const vad_t *vad)
+{
+    return vad->silence_run;
+}
+
+void vad_reset_activity(vad_t *vad)
+{
+    vad->pending_count = 0;
+    vad->speech_run = 0;
+    vad->silence_run = 0;
+    vad->hangover = 0;
+    vad->active = false;
+}
+
+void vad_get_stats(const vad_t *vad, vad_stats_t *stats)
+{
+    *stats = vad->stats;
+    for (int b = 0; b < VAD_BANDS; b++) {
+        stats->noise_floor_db[b] = 10.0f * log10f(vad->noise_floor[b]);
+        stats->snr_db[b] = 10.0f * log10f(MAX(vad->last_energy[b], VAD_MIN_ENERGY) / vad->noise_floor[b]);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 語音活動偵測（VAD）：每 10 ms 一幀，用 FFT 算各頻帶能量，追蹤各頻帶的噪音底，
+// 語音頻帶的 SNR 超過門檻就判定為語音。連續 VAD_ONSET_FRAMES 幀語音才算開始，
+// 最後一幀語音之後再維持 VAD_HANGOVER_FRAMES 幀，讓整個關鍵詞都留在模型的 1 秒窗口內。
+
+#define VAD_FRAME_SAMPLES       160     // 幀移（10 ms，與 MFE 相同）
+#define VAD_FFT_SIZE            128     // 取每幀最後 128 個樣本做 FFT（125 Hz / bin）
+#define VAD_BANDS               4       // 0: 哼聲 <250 Hz, 1: 250-1000 Hz, 2: 1-4 kHz, 3: 4-8 kHz
+
+#define VAD_SNR_THRESHOLD_DB    6.0f    // 語音頻帶（1 + 2）SNR 門檻
+#define VAD_HIGH_SNR_THRESHOLD_DB 12.0f // 高頻帶單獨的門檻（擦音，如 "h"）
+#define VAD_ONSET_FRAMES        2       // 連續幾幀語音才算開始（20 ms）
+#define VAD_HANGOVER_FRAMES     100     // 語音結束後維持幾幀（1 秒，等於模型窗口）
+#define VAD_INIT_FRAMES         20      // 開機後前幾幀只用來初始化噪音底（200 ms）
+
+typedef struct {
+    uint32_t frames;            // 處理過的幀數
+    uint32_t speech_frames;     // 判定為語音的幀數（不含 hangover）
+    uint32_t active_frames;     // 處於語音狀態的幀數（含 hangover）
+    uint32_t onsets;            // 語音開始次數
+    float noise_floor_db[VAD_BANDS];
+    float snr_db[VAD_BANDS];    // 最近一幀各頻帶的 SNR
+} vad_stats_t;
+
+typedef struct {
+    int16_t pending[VAD_FRAME_SAMPLES];     // 不滿一幀的樣本留到下次
+    size_t pending_count;
+    float noise_floor[VAD_BANDS];
+    float last_energy[VAD_BANDS];
+    uint32_t speech_run;        // 連續語音幀數
+    uint32_t silence_run;       // 最後一幀語音之後的連續非語音幀數
+    uint32_t hangover;          // 剩餘 hangover 幀數
+    bool active;
+    vad_stats_t stats;
+} vad_t;
+
+/**
+ * @brief 初始化 VAD（FFT 表與 MFE 定點前端共用，大小相同）
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 記憶體不足，ESP_ERR_INVALID_STATE FFT 表已用較小的大小初始化
+ */
+esp_err_t vad_init(vad_t *vad);
+
+/**
+ * @brief 處理一段音訊（長度不限，內部分幀）
+ * @return 這段音訊中任何一幀處於語音狀態（含 hangover）就返回 true
+ */
+bool vad_process(vad_t *vad, const int16_t *samples, size_t length);
+
+/**
+ * @brief 最後一幀語音之後連續的非語音幀數（端點偵測用，不受 hangover 影響）
+ */
+uint32_t vad_trailing_silence_frames(const vad_t *vad);
+
+/**
+ * @brief 音訊中斷後（例如錄音上傳期間）清除語音狀態，保留噪音底
+ */
+void vad_reset_activity(vad_t *vad);
+
+/**
+ * @brief 取得統計數據（噪音底與 SNR 以 dB 表示）
+ */
+void vad_get_stats(const vad_t *vad, vad_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VAD_H
@@ -0,0 +1,445 @@
+#include "wake_gate.h"
+#include "dsps_fft2r.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define GATE_BANDS              (WAKE_GATE_DIMS - 1)
+#define GATE_SNR_DIM            GATE_BANDS
+#define GATE_MIN_ENERGY         1e-2f   // 數位靜音時避免 log(0)
+#define GATE_FLOOR_DOWN_RATE    0.1f    // 與 VAD 相同：往下快速跟隨
+#define GATE_FLOOR_UP_RATE      0.02f   // 往上每幀最多 2%
+#define GATE_MAX_SNR_DB         20.0f   // SNR 上限：超過就當作語音，同一句話大聲小聲的特徵相同
+#define GATE_DYNAMIC_RANGE      0.01f   // 頻帶形狀只看最強頻帶以下 20 dB
+#define GATE_ENROLL_MARGIN      2       // 語音段前後多留的幀數
+#define GATE_NO_PATH            UINT32_MAX
+
+#define GATE_NVS_NAMESPACE      "wake_gate"
+#define GATE_NVS_KEY            "templates"
+#define GATE_NVS_VERSION        2       // 2: 模板滿了不再輪流取代（版本 1 的模板可能含誤觸發，不沿用）
+
+// 頻帶範圍（FFT bin，125 Hz / bin）：250 Hz ~ 7 kHz，大致依 mel 間距
+static const uint8_t s_band_start[GATE_BANDS] = { 2, 4, 7, 11, 17, 26, 38 };
+static const uint8_t s_band_end[GATE_BANDS] = { 4, 7, 11, 17, 26, 38, 56 };
+
+// 只有檢測任務使用，FFT 工作區與窗函數放在靜態記憶體
+static int16_t s_window[WAKE_GATE_FFT_SIZE];                                // Hann，Q15
+static int16_t s_fft[WAKE_GATE_FFT_SIZE * 2] __attribute__((aligned(16)));  // 交錯的實部 / 虛部
+
+typedef struct {
+    uint32_t version;
+    uint32_t count;
+    wake_gate_template_t templates[WAKE_GATE_MAX_TEMPLATES];
+} gate_nvs_blob_t;
+
+// sc16 FFT 只有一份全域旋轉因子表，與 VAD、MFE 定點前端共用
+static esp_err_t init_fft(void) {
+    if (dsps_fft2r_sc16_initialized) {
+        return dsps_fft_w_table_sc16_size >= WAKE_GATE_FFT_SIZE ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+    int16_t *table = (int16_t *)heap_caps_aligned_calloc(16, WAKE_GATE_FFT_SIZE, sizeof(int16_t),
+                                                         MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (table == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = dsps_fft2r_init_sc16(table, WAKE_GATE_FFT_SIZE);
+    if (ret != ESP_OK) {
+        heap_caps_free(table);
+    }
+    return ret;
+}
+
+void wake_gate_default_config(wake_gate_config_t *config)
+{
+    config->threshold_db = 4.5f;
+    config->enroll_snr_db = 6.0f;
+    config->snr_weight = 2;
+}
+
+esp_err_t wake_gate_init(wake_gate_t *gate, const wake_gate_config_t *config)
+{
+    if (config->threshold_db <= 0.0f || config->enroll_snr_db < 0.0f || config->snr_weight > 16) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = init_fft();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    memset(gate, 0, sizeof(*gate));
+    gate->config = *config;
+    gate->dim_weight = GATE_BANDS + config->snr_weight;
+    gate->threshold = (uint32_t)lrintf(config->threshold_db * 2.0f * gate->dim_weight);
+    for (int i = 0; i < WAKE_GATE_FFT_SIZE; i++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / WAKE_GATE_FFT_SIZE);
+        s_window[i] = (int16_t)lrintf(w * 32767.0f);
+    }
+    wake_gate_reset_stream(gate);
+    gate->best = GATE_NO_PATH;
+    return ESP_OK;
+}
+
+void wake_gate_reset_stream(wake_gate_t *gate)
+{
+    gate->pending_count = 0;
+    gate->stream_frames = 0;
+    gate->below = false;
+    for (int t = 0; t < WAKE_GATE_MAX_TEMPLATES; t++) {
+        for (int j = 0; j < WAKE_GATE_MAX_FRAMES; j++) {
+            gate->cells[t][j].cost = GATE_NO_PATH;
+        }
+    }
+}
+
+static inline int8_t quantize(float db) {
+    return (int8_t)lrintf(fminf(fmaxf(db * 2.0f, -127.0f), 127.0f));
+}
+
+// 一幀的特徵：減掉噪音底後的頻帶 log 能量減掉平均（頻譜形狀）+ 整幀相對噪音底的 SNR
+static void frame_features(wake_gate_t *gate, const int16_t *frame, int8_t *feat) {
+    const int16_t *x = frame + WAKE_GATE_FRAME_SAMPLES - WAKE_GATE_FFT_SIZE;
+
+    // 區塊浮點：先左移到接近滿刻度，安靜的房間也不會被 FFT 每級除以 2 量化掉
+    int32_t peak = 0;
+    for (int i = 0; i < WAKE_GATE_FFT_SIZE; i++) {
+        peak = MAX(peak, abs(x[i]));
+    }
+    int shift = 0;
+    while (peak > 0 && (peak << (shift + 1)) < 32768 && shift < 12) {
+        shift++;
+    }
+
+    for (int i = 0; i < WAKE_GATE_FFT_SIZE; i++) {
+        s_fft[2 * i] = (int16_t)((x[i] * (1 << shift) * s_window[i]) >> 15);
+        s_fft[2 * i + 1] = 0;
+    }
+    dsps_fft2r_sc16(s_fft, WAKE_GATE_FFT_SIZE);
+    dsps_bit_rev_sc16_ansi(s_fft, WAKE_GATE_FFT_SIZE);
+
+    const float scale = ldexpf(1.0f, -2 * shift);
+    float energy[GATE_BANDS];
+    float speech[GATE_BANDS];
+    float total = 0.0f;
+    float noise_total = 0.0f;
+    float peak_energy = GATE_MIN_ENERGY;
+    for (int b = 0; b < GATE_BANDS; b++) {
+        uint64_t sum = 0;
+        for (int k = s_band_start[b]; k < s_band_end[b]; k++) {
+            int32_t re = s_fft[2 * k];
+            int32_t im = s_fft[2 * k + 1];
+            sum += (uint32_t)(re * re) + (uint32_t)(im * im);
+        }
+        energy[b] = MAX((float)sum * scale, GATE_MIN_ENERGY);
+        total += energy[b];
+        noise_total += gate->noise[b];
+        // 減掉噪音底，頻譜形狀只反映語音本身，安靜和大聲時一樣
+        speech[b] = energy[b] - gate->noise[b];
+        peak_energy = MAX(peak_energy, speech[b]);
+    }
+
+    // 比最強頻帶低太多的頻帶（被噪音蓋住或本來就弱）一律墊到同一個下限，再減掉平均
+    const float floor_energy = peak_energy * GATE_DYNAMIC_RANGE;
+    float db[GATE_BANDS];
+    float mean = 0.0f;
+    for (int b = 0; b < GATE_BANDS; b++) {
+        db[b] = 10.0f * log10f(MAX(speech[b], floor_energy));
+        mean += db[b];
+    }
+    mean /= GATE_BANDS;
+    for (int b = 0; b < GATE_BANDS; b++) {
+        feat[b] = quantize(db[b] - mean);
+    }
+    float snr = noise_total > 0.0f ? fminf(fmaxf(10.0f * log10f(total / noise_total), 0.0f), GATE_MAX_SNR_DB) : 0.0f;
+
+    // 各頻帶的噪音底：第一幀直接當作初值，之後往下快速、往上慢慢跟隨（同 VAD）
+    for (int b = 0; b < GATE_BANDS; b++) {
+        float *noise = &gate->noise[b];
+        if (*noise <= 0.0f) {
+            *noise = energy[b];
+        } else if (energy[b] < *noise) {
+            *noise = MAX(*noise + (energy[b] - *noise) * GATE_FLOOR_DOWN_RATE, GATE_MIN_ENERGY);
+        } else {
+            *noise = MIN(energy[b], *noise * (1.0f + GATE_FLOOR_UP_RATE));
+        }
+    }
+    feat[GATE_SNR_DIM] = quantize(snr);
+}
+
+static inline uint32_t frame_distance(const int8_t *a, const int8_t *b, uint32_t snr_weight) {
+    uint32_t d = 0;
+    for (int i = 0; i < GATE_BANDS; i++) {
+        d += (uint32_t)abs(a[i] - b[i]);
+    }
+    return d + snr_weight * (uint32_t)abs(a[GATE_SNR_DIM] - b[GATE_SNR_DIM]);
+}
+
+// subsequence DTW 的一欄：路徑可以從任何一幀開始，每幀在模板上前進 0、1 或 2 格，
+// 不能連續兩幀停在同一格（斜率在 1/2 ~ 2 之間，路徑長度 = 經過的幀數，最多是模板的兩倍）。
+// 從模板結尾往前就地更新，用到的都是上一欄的值。
+// 返回走到模板結尾的路徑的每幀平均距離，沒有路徑時返回 GATE_NO_PATH
+static uint32_t dtw_step(wake_gate_cell_t *cells, const wake_gate_template_t *tmpl,
+                         const int8_t *feat, uint32_t frame, uint32_t snr_weight) {
+    const int length = tmpl->length;
+    for (int j = length - 1; j >= 0; j--) {
+        wake_gate_cell_t best = { .cost = 0, .start = frame, .stay = false };
+        if (j > 0) {
+            best.cost = GATE_NO_PATH;
+            if (!cells[j].stay) {
+                best = cells[j];
+                best.stay = true;
+            }
+            if (cells[j - 1].cost < best.cost) {
+                best = cells[j - 1];
+                best.stay = false;
+            }
+            if (j > 1 && cells[j - 2].cost < best.cost) {
+                best = cells[j - 2];
+                best.stay = false;
+            }
+        }
+        if (best.cost == GATE_NO_PATH) {
+            cells[j] = best;
+            continue;
+        }
+        uint32_t d = frame_distance(feat, tmpl->frames[j], snr_weight);
+        best.cost += MIN(d, GATE_NO_PATH - 1 - best.cost);
+        cells[j] = best;
+    }
+
+    const wake_gate_cell_t *end = &cells[length - 1];
+    if (end->cost == GATE_NO_PATH) {
+        return GATE_NO_PATH;
+    }
+    return end->cost / (frame - end->start + 1);
+}
+
+static bool process_frame(wake_gate_t *gate, const int16_t *frame) {
+    uint32_t start = esp_cpu_get_cycle_count();
+    int8_t *feat = gate->history[gate->history_count++ & (WAKE_GATE_HISTORY_FRAMES - 1)];
+    frame_features(gate, frame, feat);
+
+    uint32_t best = GATE_NO_PATH;
+    for (uint32_t t = 0; t < gate->stats.templates; t++) {
+        uint32_t score = dtw_step(gate->cells[t], &gate->templates[t], feat,
+                                  gate->stream_frames, gate->config.snr_weight);
+        best = MIN(best, score);
+    }
+    gate->stream_frames++;
+    gate->best = MIN(gate->best, best);
+
+    bool below = best <= gate->threshold;
+    if (below && !gate->below) {
+        gate->stats.candidates++;
+    }
+    gate->below = below;
+
+    gate->stats.frames++;
+    gate->stats.cycles += esp_cpu_get_cycle_count() - start;
+    return below;
+}
+
+bool wake_gate_process(wake_gate_t *gate, const int16_t *samples, size_t length)
+{
+    bool candidate = false;
+
+    while (length > 0) {
+        // 沒有殘留樣本時直接處理輸入，不必複製
+        if (gate->pending_count == 0 && length >= WAKE_GATE_FRAME_SAMPLES) {
+            candidate |= process_frame(gate, samples);
+            samples += WAKE_GATE_FRAME_SAMPLES;
+            length -= WAKE_GATE_FRAME_SAMPLES;
+            continue;
+        }
+
+        size_t n = WAKE_GATE_FRAME_SAMPLES - gate->pending_count;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(gate->pending + gate->pending_count, samples, n * sizeof(int16_t));
+        gate->pending_count += n;
+        samples += n;
+        length -= n;
+        if (gate->pending_count == WAKE_GATE_FRAME_SAMPLES) {
+            candidate |= process_frame(gate, gate->pending);
+            gate->pending_count = 0;
+        }
+    }
+    return candidate;
+}
+
+uint32_t wake_gate_template_count(const wake_gate_t *gate)
+{
+    return gate->stats.templates;
+}
+
+// 整段特徵與模板的最佳 subsequence DTW 距離（登錄時檢查是否重複）
+static uint32_t match_sequence(const wake_gate_t *gate, const wake_gate_template_t *seq,
+                               const wake_gate_template_t *tmpl) {
+    wake_gate_cell_t cells[WAKE_GATE_MAX_FRAMES];
+    for (int j = 0; j < WAKE_GATE_MAX_FRAMES; j++) {
+        cells[j].cost = GATE_NO_PATH;
+    }
+    uint32_t best = GATE_NO_PATH;
+    for (uint32_t i = 0; i < seq->length; i++) {
+        best = MIN(best, dtw_step(cells, tmpl, seq->frames[i], i, gate->config.snr_weight));
+    }
+    return best;
+}
+
+esp_err_t wake_gate_enroll(wake_gate_t *gate, uint32_t frames)
+{
+    // 模板滿了就不再登錄：不取代舊模板，一次誤觸發不會擠掉好的模板
+    if (gate->stats.templates >= WAKE_GATE_MAX_TEMPLATES) {
+        return ESP_ERR_NO_MEM;
+    }
+    frames = MIN(frames, MIN(gate->history_count, (uint32_t)WAKE_GATE_HISTORY_FRAMES));
+    const uint32_t first = gate->history_count - frames;
+    const int8_t speech = quantize(gate->config.enroll_snr_db);
+
+    // 找出語音段（SNR 超過門檻的第一幀到最後一幀），前後各多留幾幀
+    uint32_t begin = frames;
+    uint32_t end = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        const int8_t *feat = gate->history[(first + i) & (WAKE_GATE_HISTORY_FRAMES - 1)];
+        if (feat[GATE_SNR_DIM] >= speech) {
+            begin = MIN(begin, i);
+            end = i + 1;
+        }
+    }
+    if (begin >= end) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    begin = begin > GATE_ENROLL_MARGIN ? begin - GATE_ENROLL_MARGIN : 0;
+    end = MIN(end + GATE_ENROLL_MARGIN, frames);
+    if (end - begin < WAKE_GATE_MIN_FRAMES) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // 太長時保留結尾：第二級確認時喚醒詞剛說完
+    if (end - begin > WAKE_GATE_MAX_FRAMES) {
+        begin = end - WAKE_GATE_MAX_FRAMES;
+    }
+
+    wake_gate_template_t candidate = { .length = (uint16_t)(end - begin) };
+    for (uint32_t i = begin; i < end; i++) {
+        memcpy(candidate.frames[i - begin], gate->history[(first + i) & (WAKE_GATE_HISTORY_FRAMES - 1)],
+               WAKE_GATE_DIMS);
+    }
+
+    for (uint32_t t = 0; t < gate->stats.templates; t++) {
+        if (match_sequence(gate, &candidate, &gate->templates[t]) <= gate->threshold / 2) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    uint32_t slot = gate->stats.templates++;
+    gate->templates[slot] = candidate;
+    for (int j = 0; j < WAKE_GATE_MAX_FRAMES; j++) {
+        gate->cells[slot][j].cost = GATE_NO_PATH;
+    }
+    gate->stats.enrolled++;
+    gate->dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t wake_gate_load(wake_gate_t *gate)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(GATE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    gate_nvs_blob_t *blob = (gate_nvs_blob_t *)malloc(sizeof(gate_nvs_blob_t));
+    if (blob == NULL) {
+        nvs_close(handle);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t size = sizeof(*blob);
+    ret = nvs_get_blob(handle, GATE_NVS_KEY, blob, &size);
+    nvs_close(handle);
+    if (ret == ESP_OK && (size != sizeof(*blob) || blob->version != GATE_NVS_VERSION ||
+                          blob->count > WAKE_GATE_MAX_TEMPLATES)) {
+        ret = ESP_ERR_INVALID_VERSION;
+    }
+    for (uint32_t t = 0; ret == ESP_OK && t < blob->count; t++) {
+        uint16_t length = blob->templates[t].length;
+        if (length < WAKE_GATE_MIN_FRAMES || length > WAKE_GATE_MAX_FRAMES) {
+            ret = ESP_ERR_INVALID_VERSION;
+        }
+    }
+    if (ret == ESP_OK) {
+        memcpy(gate->templates, blob->templates, sizeof(gate->templates));
+        gate->stats.templates = blob->count;
+        gate->dirty = false;
+        wake_gate_reset_stream(gate);
+    }
+    free(blob);
+    return ret;
+}
+
+esp_err_t wake_gate_save(wake_gate_t *gate)
+{
+    if (!gate->dirty) {
+        return ESP_OK;
+    }
+    int64_t now_us = esp_timer_get_time();
+    if (gate->saved && now_us - gate->save_us < (int64_t)WAKE_GATE_SAVE_INTERVAL_S * 1000000) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    gate_nvs_blob_t *blob = (gate_nvs_blob_t *)calloc(1, sizeof(gate_nvs_blob_t));
+    if (blob == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    blob->version = GATE_NVS_VERSION;
+    blob->count = gate->stats.templates;
+    memcpy(blob->templates, gate->templates, sizeof(blob->templates));
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(GATE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(handle, GATE_NVS_KEY, blob, sizeof(*blob));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    free(blob);
+    // 寫入失敗也算一次，NVS 出問題時不會每次都重試
+    gate->saved = true;
+    gate->save_us = now_us;
+    if (ret == ESP_OK) {
+        gate->dirty = false;
+    }
+    return ret;
+}
+
+float wake_gate_take_best(wake_gate_t *gate)
+{
+    uint32_t best = gate->best;
+    gate->best = GATE_NO_PATH;
+    if (best == GATE_NO_PATH) {
+        return INFINITY;
+    }
+    return (float)best / (2.0f * gate->dim_weight);
+}
+
+void wake_gate_get_stats(const wake_gate_t *gate, wake_gate_stats_t *stats)
+{
+    *stats = gate->stats;
+    if (stats->frames > 0) {
+        // 每幀 10 ms
+        stats->cycles_per_10ms = (uint32_t)(stats->cycles / stats->frames);
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef WAKE_GATE_H
+#define WAKE_GATE_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 喚醒詞第一級檢測（級聯的前級）：每 10 ms 一幀，128 點定點 FFT 算 7 個 mel 間距頻帶的 log 能量，
+// 減掉頻帶平均（只留頻譜形狀，不受音量影響）再加上一維 SNR，量化成 int8（0.5 dB / 單位）。
+// 以串流 subsequence DTW 與模板比對：每幀每個模板只更新一欄，O(模板幀數 × 8)，
+// 路徑走到模板結尾且平均距離低於門檻時成為候選，交給 Edge Impulse 模型確認。
+// 模板不用事先訓練：喚醒後的互動確認成功（呼叫端決定，例如指令上傳成功）時，從最近一個模型窗口的特徵
+// 裁出語音段登錄，存在 NVS。模板滿了就不再登錄，不取代舊模板。
+
+#define WAKE_GATE_FRAME_SAMPLES     160     // 幀移（10 ms，與 VAD、MFE 相同）
+#define WAKE_GATE_FFT_SIZE          128     // 取每幀最後 128 個樣本做 FFT（與 VAD 共用 sc16 旋轉因子表）
+#define WAKE_GATE_DIMS              8       // 7 個頻帶形狀 + 1 維 SNR
+#define WAKE_GATE_MAX_TEMPLATES     4
+#define WAKE_GATE_MIN_FRAMES        20      // 模板長度下限（200 ms，太短的語音段不登錄）
+#define WAKE_GATE_MAX_FRAMES        80      // 模板長度上限（800 ms）
+#define WAKE_GATE_HISTORY_FRAMES    128     // 登錄用的特徵歷史（必須是 2 的次方，需涵蓋模型窗口）
+#define WAKE_GATE_SAVE_INTERVAL_S   600     // 兩次 NVS 寫入的最短間隔（秒）
+
+typedef struct {
+    float threshold_db;         // 候選門檻：路徑上每幀每維的平均距離（dB），越大召回越高、送進第二級的越多
+    float enroll_snr_db;        // 登錄時 SNR 超過這個值的幀才算語音，前後的靜音裁掉
+    uint32_t snr_weight;        // SNR 維度的權重（區分語音與靜音）
+} wake_gate_config_t;
+
+typedef struct {
+    uint32_t frames;            // 處理過的幀數
+    uint32_t candidates;        // 候選次數（連續幾幀都低於門檻只算一次）
+    uint32_t templates;         // 目前的模板數
+    uint32_t enrolled;          // 登錄次數
+    uint64_t cycles;            // 幀處理的 CPU 週期總和
+    uint32_t cycles_per_10ms;   // 換算成每 10 ms 音訊
+} wake_gate_stats_t;
+
+typedef struct {
+    int8_t frames[WAKE_GATE_MAX_FRAMES][WAKE_GATE_DIMS];
+    uint16_t length;
+} wake_gate_template_t;
+
+typedef struct {
+    uint32_t cost;              // 路徑累積距離
+    uint32_t start;             // 路徑起點的幀序號
+    bool stay;                  // 上一步停在同一格
+} wake_gate_cell_t;
+
+typedef struct {
+    wake_gate_config_t config;
+    uint32_t threshold;         // 門檻（每幀距離的量化單位：0.5 dB × 加權維度數）
+    uint32_t dim_weight;        // 加權後的維度數（7 + snr_weight），距離換算 dB 用
+    int16_t pending[WAKE_GATE_FRAME_SAMPLES];   // 不滿一幀的樣本留到下次
+    size_t pending_count;
+    float noise[WAKE_GATE_DIMS - 1];    // 各頻帶的噪音底
+    uint32_t stream_frames;     // 這段串流的幀數（路徑起點序號）
+    bool below;                 // 上一幀是否低於門檻（候選只在進入時計一次）
+    uint32_t best;              // 上次 wake_gate_take_best 之後最佳的每幀距離
+    uint32_t history_count;     // 已寫入歷史的幀數
+    int8_t history[WAKE_GATE_HISTORY_FRAMES][WAKE_GATE_DIMS];
+    bool dirty;                 // 模板有變更還沒寫入 NVS
+    bool saved;                 // 這次開機寫過 NVS（save_us 有效）
+    int64_t save_us;            // 上次寫入 NVS 的時間
+    wake_gate_template_t templates[WAKE_GATE_MAX_TEMPLATES];
+    wake_gate_cell_t cells[WAKE_GATE_MAX_TEMPLATES][WAKE_GATE_MAX_FRAMES];
+    wake_gate_stats_t stats;
+} wake_gate_t;
+
+/**
+ * @brief 預設參數：門檻 4.5 dB、登錄 SNR 6 dB、SNR 權重 2
+ */
+void wake_gate_default_config(wake_gate_config_t *config);
+
+/**
+ * @brief 初始化（沒有模板，FFT 表與 VAD 共用）
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 參數超出範圍，ESP_ERR_NO_MEM 記憶體不足，
+ *         ESP_ERR_INVALID_STATE FFT 表已用較小的大小初始化
+ */
+esp_err_t wake_gate_init(wake_gate_t *gate, const wake_gate_config_t *config);
+
+/**
+ * @brief 開始新的一段串流（音訊中斷後呼叫）：清除 DTW 路徑，保留模板與噪音底
+ */
+void wake_gate_reset_stream(wake_gate_t *gate);
+
+/**
+ * @brief 處理一段音訊（長度不限，內部分幀）
+ * @return 這段音訊中出現候選（某個模板的路徑剛走到結尾且低於門檻）就返回 true；沒有模板時永遠是 false
+ */
+bool wake_gate_process(wake_gate_t *gate, const int16_t *samples, size_t length);
+
+/**
+ * @brief 目前的模板數（0 表示還沒登錄，呼叫端應改用其他方式送進第二級）
+ */
+uint32_t wake_gate_template_count(const wake_gate_t *gate);
+
+/**
+ * @brief 以最近 frames 幀的特徵登錄模板（喚醒確認成功後呼叫，中間不要再送音訊進來）
+ *        裁掉前後 SNR 不足的幀；已經有模板很像（距離低於門檻的一半）時不登錄，保留模板的多樣性
+ * @return ESP_OK 已登錄，ESP_ERR_NO_MEM 模板已滿，ESP_ERR_INVALID_SIZE 語音段太短，
+ *         ESP_ERR_INVALID_STATE 與現有模板重複
+ */
+esp_err_t wake_gate_enroll(wake_gate_t *gate, uint32_t frames);
+
+/**
+ * @brief 從 NVS 載入模板（沒有存過時返回 ESP_ERR_NVS_NOT_FOUND）
+ */
+esp_err_t wake_gate_load(wake_gate_t *gate);
+
+/**
+ * @brief 把模板存到 NVS：只有模板有變更時才寫，且距離上次寫入至少 WAKE_GATE_SAVE_INTERVAL_S 秒
+ *        （寫入失敗也算一次）；延後的變更在之後的呼叫寫入，呼叫端可以定期呼叫
+ * @return ESP_OK 已寫入或沒有變更，ESP_ERR_NOT_FINISHED 離上次寫入太近、延後寫入，其他為 NVS 錯誤
+ */
+esp_err_t wake_gate_save(wake_gate_t *gate);
+
+/**
+ * @brief 取出上次呼叫之後的最佳分數（dB，沒有模板時是 INFINITY），用來調整門檻
+ */
+float wake_gate_take_best(wake_gate_t *gate);
+
+/**
+ * @brief 取得統計數據（包含實測的每 10 ms CPU 週期）
+ */
+void wake_gate_get_stats(const wake_gate_t *gate, wake_gate_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WAKE_GATE_H
@@ -3,6 +3,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -18,6 +19,17 @@ static const char *TAG = "WIFI_MANAGER";
 static EventGroupHandle_t s_wifi_event_group;
 static int s_retry_num = 0;
 
+// 省電模式：平常 modem sleep（每個 DTIM 醒來收 beacon），上傳 / 下載期間暫時關閉
+static SemaphoreHandle_t s_ps_mutex = NULL;
+static bool s_power_save = false;
+static int s_awake_holds = 0;       // 要求暫時關閉省電的呼叫者數
+
+// 依目前的設定套用省電模式（呼叫端持有 s_ps_mutex）
+static esp_err_t apply_power_save(void)
+{
+    return esp_wifi_set_ps(s_power_save && s_awake_holds == 0 ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE);
+}
+
 static void event_handler(void* arg, esp_event_base_t event_base,
                          int32_t event_id, void* event_data)
 {
@@ -47,6 +59,7 @@ static void event_handler(void* arg, esp_event_base_t event_base,
 esp_err_t wifi_init_sta(const char* ssid, const char* password)
 {
     s_wifi_event_group = xEventGroupCreate();
+    s_ps_mutex = xSemaphoreCreateMutex();
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
@@ -86,7 +99,7 @@ esp_err_t wifi_init_sta(const char* ssid, const char* password)
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     
-    // 關閉省電模式以提高穩定性
+    // 連線期間關閉省電模式以提高穩定性，之後由 wifi_set_power_save 開啟
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
     
     // 設置主機名
@@ -139,6 +152,36 @@ bool wifi_is_connected(void)
     return false;
 }
 
+esp_err_t wifi_set_power_save(bool enable)
+{
+    if (s_ps_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_ps_mutex, portMAX_DELAY);
+    s_power_save = enable;
+    esp_err_t ret = apply_power_save();
+    xSemaphoreGive(s_ps_mutex);
+    
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "🔋 WiFi 省電模式: %s", enable ? "modem sleep" : "關閉");
+    }
+    return ret;
+}
+
+void wifi_hold_awake(bool hold)
+{
+    if (s_ps_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_ps_mutex, portMAX_DELAY);
+    s_awake_holds += hold ? 1 : -1;
+    // 只有從 0 變 1、從 1 變 0 時才需要切換
+    if (s_power_save && s_awake_holds == (hold ? 1 : 0)) {
+        apply_power_save();
+    }
+    xSemaphoreGive(s_ps_mutex);
+}
+
 void wifi_disconnect(void)
 {
     esp_wifi_disconnect();
@@ -7,6 +7,12 @@
 // WiFi連接函數
 esp_err_t wifi_init_sta(const char* ssid, const char* password);
 bool wifi_is_connected(void);
+
+// 開啟 / 關閉省電模式（modem sleep，收發延遲最多一個 DTIM 間隔）
+esp_err_t wifi_set_power_save(bool enable);
+
+// 需要低延遲時（上傳、下載 TTS）暫時關閉省電，hold = false 時釋放；所有呼叫者都釋放後恢復
+void wifi_hold_awake(bool hold);
 void wifi_disconnect(void);
 
 #endif // WIFI_MANAGER_H